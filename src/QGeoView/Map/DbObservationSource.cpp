@@ -0,0 +1,160 @@
+#include "DbObservationSource.h"
+#include "asyncdb.h"
+#include "sqlqueries.h"
+#include "statusmapper.h"
+
+#include <QJsonDocument>
+#include <QPointer>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+
+// Ответ потока БД: точки и признак прореживания
+struct FetchResult
+{
+    QVector<ObservationRecord> records;
+    bool thinned = false;
+};
+
+// Последний ML результат каждой точки (по наблюдениям этой точки)
+StatusCode loadMlResults(SQLiteDb& db, QVector<ObservationRecord>& records)
+{
+    if (records.isEmpty()) {
+        return StatusCode::SUCCESS;
+    }
+
+    QHash<qint64, int> byId;
+    QStringList ids;
+    for (int i = 0; i < records.size(); ++i) {
+        byId.insert(records[i].id, i);
+        ids.append(QString::number(records[i].id));
+    }
+
+    // id — числа из самой БД, в текст запроса их можно подставить
+    return db.forEachRow(
+        SqlQueries::ML_RESULTS_OF_POINTS.arg(ids.join(',')),
+        [&](const SqlCursor& row) {
+            auto it = byId.constFind(row.toInt64(0));
+            if (it != byId.constEnd()) {
+                records[it.value()].mlResults = QJsonDocument::fromJson(row.toBytes(1)).object();
+            }
+            return true;
+        });
+}
+
+
+// Рядом с каждым "<name>_blob" — "<name>_thumbs": {"64": файл, ..., "full": файл}.
+// Окно точки и карта открывают файл нужного размера, не разбирая полный кадр
+void attachThumbnails(QJsonObject& json, const QHash<QString, QVector<ThumbnailRow>>& thumbs, BlobStore& blobs)
+{
+    const QJsonObject source = json;
+    for (auto it = source.constBegin(); it != source.constEnd(); ++it) {
+        if (!it.key().endsWith("_blob") || !it.value().isString()) continue;
+
+        const QString hash = it.value().toString();
+        QJsonObject files;
+        for (const ThumbnailRow& thumb : thumbs.value(hash)) {
+            files.insert(QString::number(thumb.size), blobs.path(thumb.hash));
+        }
+        files.insert("full", blobs.path(hash));
+
+        json.insert(it.key().chopped(5) + "_thumbs", files);
+    }
+}
+
+StatusCode loadThumbnails(SQLiteDb& db, QVector<ObservationRecord>& records)
+{
+    if (!db.blobStore().isOpen()) {
+        return StatusCode::SUCCESS;
+    }
+
+    QStringList hashes;
+    auto collect = [&hashes](const QJsonObject& json) {
+        for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+            if (it.key().endsWith("_blob") && it.value().isString()) hashes.append(it.value().toString());
+        }
+    };
+    for (const ObservationRecord& rec : std::as_const(records)) {
+        collect(rec.robotData);
+        collect(rec.mlResults);
+    }
+    if (hashes.isEmpty()) {
+        return StatusCode::SUCCESS;
+    }
+
+    QHash<QString, QVector<ThumbnailRow>> thumbs;
+    const StatusCode st = db.thumbnails(hashes, thumbs);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    for (ObservationRecord& rec : records) {
+        attachThumbnails(rec.robotData, thumbs, db.blobStore());
+        attachThumbnails(rec.mlResults, thumbs, db.blobStore());
+    }
+    return StatusCode::SUCCESS;
+}
+
+}
+
+DbObservationSource::DbObservationSource(AsyncDb* db, int sessionId, QObject* parent)
+    : ObservationSource(parent), mDb(db), mSessionId(sessionId)
+{}
+
+void DbObservationSource::fetch(quint64 requestId, const QGV::GeoRect& rect, int limit, double cellDeg, bool prefetch)
+{
+    if (!mDb) return;
+
+    GeoRect area;
+    area.latMin = rect.latBottom();
+    area.latMax = rect.latTop();
+    area.lonMin = rect.lonLeft();
+    area.lonMax = rect.lonRight();
+
+    const int sessionId = mSessionId;
+
+    const StatusCode st = mDb->submitLatest<FetchResult>(
+        prefetch ? "observations_prefetch" : "observations",
+        [sessionId, area, limit, cellDeg](SQLiteDb& db, FetchResult& result) {
+            QVector<PointRecord> points;
+            StatusCode st = db.pointsInRect(sessionId, area, points, limit);
+
+            // Всё не поместилось: вместо случайной части (порядок R*Tree) — по точке на ячейку
+            if (st == StatusCode::SUCCESS && limit > 0 && points.size() >= limit && cellDeg > 0) {
+                st = db.pointsInRectThinned(sessionId, area, cellDeg, points, limit);
+                result.thinned = true;
+            }
+            if (st != StatusCode::SUCCESS) {
+                return st;
+            }
+
+            QVector<ObservationRecord>& out = result.records;
+            out.reserve(points.size());
+            for (const PointRecord& p : std::as_const(points)) {
+                ObservationRecord rec;
+                rec.id = p.id;
+                rec.pos = QGV::GeoPos(p.latitude, p.longitude);
+                rec.robotData = QJsonDocument::fromJson(p.dataJson).object();
+                out.append(rec);
+            }
+            st = loadMlResults(db, out);
+            if (st != StatusCode::SUCCESS) {
+                return st;
+            }
+            return loadThumbnails(db, out);
+        },
+        [self = QPointer<DbObservationSource>(this), requestId](StatusCode st, const FetchResult& result) {
+            // Отменённый запрос заменён более новым — слою он уже не нужен
+            if (!self || st == StatusCode::DB_QUERY_CANCELLED) return;
+            if (st != StatusCode::SUCCESS) {
+                qWarning() << statusToMessage(st);
+                return;
+            }
+            emit self->loaded(requestId, result.records, result.thinned);
+        });
+
+    if (st != StatusCode::SUCCESS) {
+        qWarning() << statusToMessage(st);
+    }
+}
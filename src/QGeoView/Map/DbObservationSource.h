@@ -0,0 +1,21 @@
+#pragma once
+#include "ObservationSource.h"
+
+class AsyncDb;
+
+// Источник точек из БД сессии через AsyncDb: запросы в потоке БД, ответ в GUI-потоке.
+// Устаревший запрос видимой области отменяется новым (тег AsyncDb), так что при быстрой
+// прокрутке в очереди не копятся ненужные выборки.
+class DbObservationSource : public ObservationSource
+{
+    Q_OBJECT
+
+public:
+    DbObservationSource(AsyncDb* db, int sessionId, QObject* parent = nullptr);
+
+    void fetch(quint64 requestId, const QGV::GeoRect& rect, int limit, double cellDeg, bool prefetch) override;
+
+private:
+    AsyncDb* mDb = nullptr;
+    int mSessionId = -1;
+};
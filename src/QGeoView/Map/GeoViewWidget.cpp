@@ -820,10 +820,18 @@ void GeoViewWidget::updateRobotPos(const QJsonObject& json){
     addRobot(latitude, longitude, rotation_angle);
 
     mObservationLayer->addPoint(QGV::GeoPos(latitude, longitude));
+
+    // Manager уже записал точку в БД — загруженная область устарела
+    mObservationLayer->invalidate();
 }
 
 void GeoViewWidget::setMlResults(const QJsonObject& json){
     addMlResults(json);
+    mObservationLayer->invalidate();
+}
+
+void GeoViewWidget::setObservationSource(ObservationSource* source){
+    mObservationLayer->setSource(source);
 }
 
 QJsonDocument GeoViewWidget::generateGazeboJson() {
@@ -62,6 +62,9 @@ public:
                    bool drawArrow = false,
                    bool replaceExisting = false);
 
+    // Точки наблюдений подгружаются из источника по видимой области (nullptr — все в памяти)
+    void setObservationSource(ObservationSource* source);
+
     QJsonDocument getRouteCommands() const;
     const RobotItem& getRobotItem() const;
 
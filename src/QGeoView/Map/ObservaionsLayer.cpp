@@ -2,11 +2,22 @@
 #include <QGeoView/Raster/QGVIcon.h>
 #include <QPainter>
 #include <QDebug>
+#include <QSet>
 #include <QTimer>
+#include <algorithm>
+#include <cmath>
 
 ObservationsLayer::ObservationsLayer(QGVMap* map)
     :mMap(map)
-{}
+{
+    mRefreshTimer.setSingleShot(true);
+    mRefreshTimer.setInterval(REFRESH_DELAY_MS);
+    connect(&mRefreshTimer, &QTimer::timeout, this, &ObservationsLayer::onRefreshTimer);
+
+    if (mMap) {
+        connect(mMap, &QGVMap::areaChanged, this, &ObservationsLayer::onAreaChanged);
+    }
+}
 
 ObservationsLayer::~ObservationsLayer()
 {
@@ -26,6 +37,7 @@ void ObservationsLayer::addPoint(const QGV::GeoPos& pos, const QJsonObject& json
 
     ObservationPoint* point = new ObservationPoint(mMap, pos, json);
     mPoints.append(point);
+    mLive.insert({pos.latitude(), pos.longitude()}, point);
     addItem(point);
 }
 
@@ -33,6 +45,7 @@ void ObservationsLayer::addPoint(const QGV::GeoPos& pos)
 {
     ObservationPoint* point = new ObservationPoint(mMap, pos);
     mPoints.append(point);
+    mLive.insert({pos.latitude(), pos.longitude()}, point);
     addItem(point);
 }
 
@@ -49,6 +62,215 @@ void ObservationsLayer::clear()
     deleteItems();
 
     mPoints.clear();
+    mById.clear();
+    mLive.clear();
+    mLoadedRect = QGV::GeoRect();
+    mLoadedComplete = false;
+    mLoadedCell = 0;
+}
+
+void ObservationsLayer::setSource(ObservationSource* source)
+{
+    if (mSource) {
+        disconnect(mSource, nullptr, this, nullptr);
+    }
+
+    mSource = source;
+    clear();
+
+    if (mSource) {
+        connect(mSource, &ObservationSource::loaded, this, &ObservationsLayer::onLoaded);
+        refresh();
+    }
+}
+
+void ObservationsLayer::onAreaChanged()
+{
+    if (mSource) {
+        mRefreshTimer.start();
+    }
+}
+
+void ObservationsLayer::invalidate()
+{
+    mLoadedRect = QGV::GeoRect();
+    mLoadedComplete = false;
+
+    // Ответы на уже отправленные запросы могли не застать новые точки — ждём свежий
+    mViewRequestId = 0;
+    mPrefetchRequestId = 0;
+
+    if (mSource) {
+        mRefreshTimer.start();
+    }
+}
+
+void ObservationsLayer::onRefreshTimer()
+{
+    if (!mSource || !mMap) return;
+
+    // Видимое уже загружено целиком (без обрезки) и с сеткой этого масштаба — запрашивать нечего
+    const QGV::GeoRect view = visibleRect();
+    if (mLoadedComplete && !mLoadedRect.isEmpty() && mLoadedRect.contains(view)
+        && (mLoadedCell == 0 || mLoadedCell == thinningCell(view))) return;
+
+    refresh();
+}
+
+void ObservationsLayer::refresh()
+{
+    if (!mSource || !mMap) return;
+
+    const QGV::GeoRect view = visibleRect();
+    if (view.isEmpty()) return;
+
+    mViewRect = view;
+    mViewCell = thinningCell(view);
+    mViewRequestId = mNextRequestId++;
+    mPrefetchRequestId = 0;
+    mSource->fetch(mViewRequestId, view, MAX_POINTS_PER_REQUEST, mViewCell, false);
+}
+
+void ObservationsLayer::onLoaded(quint64 requestId, const QVector<ObservationRecord>& records, bool thinned)
+{
+    const double cell = thinned ? mViewCell : 0;
+
+    if (requestId == mViewRequestId) {
+        // Другая плотность (масштаб сменился или прореживание включилось/выключилось):
+        // точки прежней сетки с новыми не смешиваются
+        if (cell != mLoadedCell) {
+            dropRecordsExcept(records);
+            mLoadedCell = cell;
+        }
+
+        for (const ObservationRecord& record : records) {
+            addRecord(record);
+        }
+
+        // Поле вокруг — вторым запросом, чтобы видимое появилось без ожидания
+        const QGV::GeoRect around = inflated(mViewRect, PREFETCH_MARGIN);
+        evictOutside(around);
+
+        mLoadedRect = mViewRect;
+        mLoadedComplete = records.size() < MAX_POINTS_PER_REQUEST;
+        mPrefetchRequestId = mNextRequestId++;
+        mSource->fetch(mPrefetchRequestId, around, MAX_POINTS_PER_REQUEST, mViewCell, true);
+        return;
+    }
+
+    if (requestId == mPrefetchRequestId) {
+        for (const ObservationRecord& record : records) {
+            addRecord(record);
+        }
+
+        // Обрезанный ответ для поля вокруг или ответ другой плотности, чем видимая
+        // область, — считаем загруженной только видимую область
+        if (records.size() < MAX_POINTS_PER_REQUEST && cell == mLoadedCell) {
+            mLoadedRect = inflated(mViewRect, PREFETCH_MARGIN);
+        }
+        mPrefetchRequestId = 0;
+    }
+    // Ответы на более старые запросы не нужны: область уже другая
+}
+
+void ObservationsLayer::addRecord(const ObservationRecord& record)
+{
+    if (mById.contains(record.id)) return;
+
+    // Точка, уже добавленная с живых данных, — та же, что пришла из БД
+    ObservationPoint* point = mLive.take({record.pos.latitude(), record.pos.longitude()});
+    if (!point) {
+        point = new ObservationPoint(mMap, record.pos, record.robotData);
+        mPoints.append(point);
+        addItem(point);
+    }
+    if (!record.mlResults.isEmpty()) {
+        point->setMLResults(record.mlResults);
+    }
+    mById.insert(record.id, point);
+}
+
+void ObservationsLayer::dropRecordsExcept(const QVector<ObservationRecord>& records)
+{
+    QSet<qint64> keepIds;
+    for (const ObservationRecord& record : records) {
+        keepIds.insert(record.id);
+    }
+
+    // Точки с живых данных (mLive) ещё не в БД — их ответ источника не заменяет
+    QSet<ObservationPoint*> dropped;
+    for (auto it = mById.begin(); it != mById.end();) {
+        if (keepIds.contains(it.key())) {
+            ++it;
+        } else {
+            dropped.insert(it.value());
+            it = mById.erase(it);
+        }
+    }
+
+    QVector<ObservationPoint*> kept;
+    kept.reserve(mPoints.size());
+    for (auto* point : std::as_const(mPoints)) {
+        if (dropped.contains(point)) {
+            delete point;
+        } else {
+            kept.append(point);
+        }
+    }
+    mPoints = kept;
+}
+
+void ObservationsLayer::evictOutside(const QGV::GeoRect& keep)
+{
+    QVector<ObservationPoint*> kept;
+    kept.reserve(mPoints.size());
+
+    for (auto it = mById.begin(); it != mById.end();) {
+        if (keep.contains(it.value()->pos())) {
+            ++it;
+        } else {
+            it = mById.erase(it);
+        }
+    }
+    for (auto it = mLive.begin(); it != mLive.end();) {
+        if (keep.contains(it.value()->pos())) {
+            ++it;
+        } else {
+            it = mLive.erase(it);
+        }
+    }
+
+    for (auto* point : std::as_const(mPoints)) {
+        if (keep.contains(point->pos())) {
+            kept.append(point);
+        } else {
+            delete point;   // QGVItem сам убирает себя из слоя
+        }
+    }
+    mPoints = kept;
+}
+
+QGV::GeoRect ObservationsLayer::visibleRect() const
+{
+    auto* proj = mMap->getProjection();
+    if (!proj) return QGV::GeoRect();
+    return proj->projToGeo(mMap->getCamera().projRect());
+}
+
+// Степень двойки градусов: при сдвиге и небольшом изменении масштаба сетка та же
+double ObservationsLayer::thinningCell(const QGV::GeoRect& view)
+{
+    const double span = std::max(view.latTop() - view.latBottom(), view.lonRight() - view.lonLeft());
+    if (span <= 0) return 0;
+    return std::exp2(std::ceil(std::log2(span / THIN_CELLS_PER_SIDE)));
+}
+
+QGV::GeoRect ObservationsLayer::inflated(const QGV::GeoRect& rect, double margin)
+{
+    const double dLat = (rect.latTop() - rect.latBottom()) * margin;
+    const double dLon = (rect.lonRight() - rect.lonLeft()) * margin;
+    return QGV::GeoRect(rect.latTop() + dLat, rect.lonLeft() - dLon,
+                        rect.latBottom() - dLat, rect.lonRight() + dLon);
 }
 
 void ObservationsLayer::handleMapClick(const QGV::GeoPos& clickPos)
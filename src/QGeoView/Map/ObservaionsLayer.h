@@ -1,16 +1,36 @@
 #pragma once
 #include <QObject>
 #include <QVector>
+#include <QHash>
+#include <QPair>
 #include <QImage>
+#include <QTimer>
 #include <QGeoView/QGVLayer.h>
 #include <QGeoView/QGVMap.h>
 #include "ObservationPoint.h"
+#include "ObservationSource.h"
 
+// Слой точек наблюдений.
+//
+// Без источника (setSource) держит все добавленные точки, как раньше.
+// С источником точки подгружаются по видимой области: после сдвига или масштаба карты
+// (QGVMap::areaChanged, с задержкой REFRESH_DELAY_MS) — сначала видимый прямоугольник,
+// затем поле PREFETCH_MARGIN вокруг него; точки за пределами этого поля удаляются.
+// Если точек в области больше MAX_POINTS_PER_REQUEST, источник отдаёт по точке на ячейку
+// сетки, размер которой зависит только от масштаба (thinningCell): при сдвиге карты показанные
+// точки не меняются, при смене масштаба загруженное заменяется точками новой сетки.
 class ObservationsLayer : public QGVLayer
 {
     Q_OBJECT
 
 public:
+    static constexpr int REFRESH_DELAY_MS = 150;
+    static constexpr double PREFETCH_MARGIN = 0.5;     // доля размера видимой области с каждой стороны
+    static constexpr int MAX_POINTS_PER_REQUEST = 3000;
+    // Ячеек сетки прореживания на сторону видимой области (не больше). С полем вокруг
+    // область вдвое больше по каждой оси — ячеек всё равно меньше MAX_POINTS_PER_REQUEST
+    static constexpr int THIN_CELLS_PER_SIDE = 24;
+
     ObservationsLayer(QGVMap* map);
     ~ObservationsLayer() override;
 
@@ -25,12 +45,49 @@ public:
 
     void clear();
 
+    // Источник точек (слой им не владеет); nullptr — все точки в памяти
+    void setSource(ObservationSource* source);
+    ObservationSource* source() const { return mSource; }
+
 public slots:
     void handleMapClick(const QGV::GeoPos& clickPos);
 
+    // Перезапросить видимую область сразу, даже если она уже загружена
+    void refresh();
+
+    // Загруженное устарело (в БД записаны новые точки): перезапрос с задержкой REFRESH_DELAY_MS,
+    // так что поток точек от робота не порождает запрос на каждую
+    void invalidate();
+
+private slots:
+    void onAreaChanged();
+    void onRefreshTimer();
+    void onLoaded(quint64 requestId, const QVector<ObservationRecord>& records, bool thinned);
+
 private:
+    QGV::GeoRect visibleRect() const;
+    static QGV::GeoRect inflated(const QGV::GeoRect& rect, double margin);
+    static double thinningCell(const QGV::GeoRect& view);
+    void addRecord(const ObservationRecord& record);
+    void dropRecordsExcept(const QVector<ObservationRecord>& records);
+    void evictOutside(const QGV::GeoRect& keep);
+
     QGVMap* mMap = nullptr;
     QVector<ObservationPoint*> mPoints;
+
+    ObservationSource* mSource = nullptr;
+    QTimer mRefreshTimer;
+    quint64 mNextRequestId = 1;
+    quint64 mViewRequestId = 0;          // последний запрос видимой области
+    quint64 mPrefetchRequestId = 0;
+    QGV::GeoRect mViewRect;              // область этого запроса
+    double mViewCell = 0;                // сетка прореживания этого запроса
+    QGV::GeoRect mLoadedRect;            // видимая область и поле вокруг, уже загруженные
+    bool mLoadedComplete = false;        // в mLoadedRect не было обрезки по MAX_POINTS_PER_REQUEST
+    double mLoadedCell = 0;              // сетка загруженных точек; 0 — все точки, без прореживания
+
+    QHash<qint64, ObservationPoint*> mById;                 // точки из источника
+    QHash<QPair<double, double>, ObservationPoint*> mLive;  // добавленные addPoint, ещё без id
     QImage mPointImage;
     double mPointRadiusMeters = 1.5; // единый радиус для всех точек
 };
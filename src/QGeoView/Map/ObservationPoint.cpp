@@ -1,5 +1,7 @@
 #include "ObservationPoint.h"
+#include <QBuffer>
 #include <QByteArray>
+#include <QImageReader>
 #include <QJsonDocument>
 #include <QPainter>
 #include <QDialog>
@@ -10,6 +12,8 @@
 #include <QTimer>
 #include <QScrollArea>
 
+#include <algorithm>
+
 ObservationPoint::ObservationPoint(QGVMap* map, const QGV::GeoPos& pos, const QJsonObject& json, double radiusMeters, QObject* parent)
     : mMap(map), mPos(pos), mRadiusMeters(radiusMeters)
 {
@@ -27,10 +31,60 @@ ObservationPoint::ObservationPoint(const QJsonObject& json, QGVMap* map, double
     if (!json.isEmpty()) setRobotData(json);
 }
 
+namespace {
+
+// Размер показа изображения в окне точки
+const int DIALOG_IMAGE_SIZE = 450;
+
+// Наименьшая миниатюра не меньше maxSide; если такой нет — полный кадр
+QString thumbnailFile(const QJsonObject& thumbs, int maxSide)
+{
+    int best = -1;
+    for (auto it = thumbs.constBegin(); it != thumbs.constEnd(); ++it) {
+        bool ok = false;
+        const int size = it.key().toInt(&ok);
+        if (ok && size >= maxSide && maxSide > 0 && (best < 0 || size < best)) best = size;
+    }
+    return best > 0 ? thumbs.value(QString::number(best)).toString() : thumbs.value("full").toString();
+}
+
+// JPEG уменьшается прямо при разборе: полный кадр в памяти не собирается
+QImage readScaled(QImageReader& reader, int maxSide)
+{
+    reader.setAutoTransform(true);
+    const QSize size = reader.size();
+    if (maxSide > 0 && size.isValid() && std::max(size.width(), size.height()) > maxSide) {
+        reader.setScaledSize(size.scaled(maxSide, maxSide, Qt::KeepAspectRatio));
+    }
+    return reader.read();
+}
+
+}
+
+// Изображения не разбираются при загрузке точки: слой создаёт тысячи точек,
+// а картинка нужна только той, которую открыли
 void ObservationPoint::setRobotData(const QJsonObject& obj)
 {
     mRobotData = obj;
-    if (obj.contains("img_base64")) mImage = decodeBase64Image(obj.value("img_base64").toString());
+}
+
+QImage ObservationPoint::image(int maxSide) const
+{
+    return loadImage(mRobotData, "img", maxSide);
+}
+
+QImage ObservationPoint::loadImage(const QJsonObject& obj, const QString& name, int maxSide)
+{
+    const QJsonValue thumbs = obj.value(name + "_thumbs");
+    if (thumbs.isObject()) {
+        QImageReader reader(thumbnailFile(thumbs.toObject(), maxSide));
+        return readScaled(reader, maxSide);
+    }
+
+    const QJsonValue base64 = obj.value(name + "_base64");
+    if (base64.isString()) return decodeBase64Image(base64.toString(), maxSide);
+
+    return QImage();
 }
 
 void ObservationPoint::setMLResults(const QJsonObject& obj)
@@ -52,12 +106,13 @@ QColor ObservationPoint::color() const
     return QColor(255, 165, 0, alpha);
 }
 
-QImage ObservationPoint::decodeBase64Image(const QString& base64) const
+QImage ObservationPoint::decodeBase64Image(const QString& base64, int maxSide)
 {
     QByteArray ba = QByteArray::fromBase64(base64.toUtf8());
-    QImage img;
-    img.loadFromData(ba);
-    return img;
+    QBuffer buffer(&ba);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    return readScaled(reader, maxSide);
 }
 
 void ObservationPoint::onProjection(QGVMap* map)
@@ -134,7 +189,7 @@ void ObservationPoint::showData()
 
         QTextEdit* textEdit = new QTextEdit;
         textEdit->setReadOnly(true);
-        textEdit->setMinimumWidth(450);
+        textEdit->setMinimumWidth(DIALOG_IMAGE_SIZE);
 
 
         QJsonObject robotClean = mRobotData;
@@ -143,7 +198,7 @@ void ObservationPoint::showData()
         auto removeBase64Fields = [](QJsonObject& obj) {
             QStringList removeKeys;
             for (auto it = obj.begin(); it != obj.end(); ++it) {
-                if (it.key().contains("_base64", Qt::CaseInsensitive)) {
+                if (it.key().contains("_base64", Qt::CaseInsensitive) || it.key().endsWith("_thumbs")) {
                     removeKeys << it.key();
                 }
             }
@@ -172,11 +227,13 @@ void ObservationPoint::showData()
             for (auto it = obj.begin(); it != obj.end(); ++it) {
                 QString key = it.key();
 
-                if (!key.contains("_base64", Qt::CaseInsensitive))
-                    continue;
+                // Из БД — "<name>_blob" и файлы миниатюр "<name>_thumbs", напрямую от робота — "<name>_base64"
+                QString name;
+                if (key.endsWith("_thumbs")) name = key.chopped(7);
+                else if (key.endsWith("_base64", Qt::CaseInsensitive) && !obj.contains(key.chopped(7) + "_thumbs")) name = key.chopped(7);
+                else continue;
 
-                QString base64 = it.value().toString();
-                QImage img = decodeBase64Image(base64);
+                QImage img = loadImage(obj, name, DIALOG_IMAGE_SIZE);
                 if (img.isNull())
                     continue;
 
@@ -185,7 +242,7 @@ void ObservationPoint::showData()
 
                 QLabel* imgLabel = new QLabel;
                 imgLabel->setPixmap(QPixmap::fromImage(img)
-                                            .scaled(450, 450,
+                                            .scaled(DIALOG_IMAGE_SIZE, DIALOG_IMAGE_SIZE,
                                                     Qt::KeepAspectRatio,
                                                     Qt::SmoothTransformation));
 
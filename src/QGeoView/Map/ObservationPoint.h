@@ -21,7 +21,9 @@ public:
 
     QGV::GeoPos pos() const { return mPos; }
     QColor color() const;
-    QImage image() const { return mImage; }
+    // Изображение "img" по требованию: миниатюра не меньше maxSide, если есть,
+    // иначе кадр, уменьшенный при разборе (maxSide = 0 — полный размер)
+    QImage image(int maxSide = 0) const;
 
     void setRadiusMeters(double r) { mRadiusMeters = r; }
     double radiusMeters() const { return mRadiusMeters; }
@@ -35,7 +37,8 @@ protected:
     void projPaint(QPainter* p) override;
 
 private:
-    QImage decodeBase64Image(const QString& base64) const;
+    static QImage loadImage(const QJsonObject& obj, const QString& name, int maxSide);
+    static QImage decodeBase64Image(const QString& base64, int maxSide);
 
 private:
     QGVMap* mMap;
@@ -43,7 +46,6 @@ private:
     QGV::GeoPos mPos;
     QJsonObject mRobotData;
     QJsonObject mMLResults;
-    QImage mImage;
     double mRadiusMeters;
 
     QPointF m_projPos; // позиция в координатах проекции
@@ -0,0 +1,41 @@
+#pragma once
+#include <QObject>
+#include <QJsonObject>
+#include <QVector>
+#include <QGeoView/QGVGlobal.h>
+
+// Точка наблюдения, как её отдаёт источник: без изображений (в БД они лежат
+// в хранилище блобов, в robotData остаются ссылки "*_blob"). Рядом источник может
+// положить "*_thumbs" — файлы миниатюр по размеру и "full" — полный кадр
+struct ObservationRecord
+{
+    qint64 id = -1;
+    QGV::GeoPos pos;
+    QJsonObject robotData;
+    QJsonObject mlResults;
+};
+
+Q_DECLARE_METATYPE(ObservationRecord)
+
+// Источник точек для ObservationsLayer: слой запрашивает только видимую область
+// и поле вокруг неё, а не держит в памяти всю сессию.
+//
+// fetch() не блокирует: ответ приходит сигналом loaded с тем же requestId.
+// Новый запрос того же вида (prefetch или нет) отменяет предыдущий незавершённый.
+//
+// Если в rect больше limit точек, источник прореживает ответ (thinned = true): не больше
+// одной точки на ячейку cellDeg × cellDeg сетки, выровненной от (-90, -180), и всегда одну
+// и ту же. При сдвиге карты с той же сеткой уже показанные точки остаются на месте.
+class ObservationSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    using QObject::QObject;
+    ~ObservationSource() override = default;
+
+    virtual void fetch(quint64 requestId, const QGV::GeoRect& rect, int limit, double cellDeg, bool prefetch) = 0;
+
+signals:
+    void loaded(quint64 requestId, const QVector<ObservationRecord>& records, bool thinned);
+};
@@ -1,6 +1,12 @@
 #include "GeoViewWidget.h"
+#include "DbObservationSource.h"
+#include "asyncdb.h"
+#include "config.h"
+#include "dbconnectionpool.h"
+#include "statusmapper.h"
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDebug>
 
 int main(int argc, char* argv[])
 {
@@ -10,9 +16,33 @@ int main(int argc, char* argv[])
     QCommandLineParser parser;
     parser.addHelpOption();
     parser.addVersionOption();
+    parser.addOptions({
+        {"db", "Database file with observations.", "path", Config::DB_FILE_PATH},
+        {"session", "Session to show.", "id", "1"},
+    });
     parser.process(app);
 
     GeoViewWidget window;
+
+    // Точки наблюдений — из БД по видимой области; без БД слой держит всё в памяти.
+    // Карта только читает: писатель — основной процесс
+    DbConnectionPool pool;
+    pool.open(parser.value("db"), false);
+
+    AsyncDb db;
+    DbObservationSource source(&db, parser.value("session").toInt());
+
+    const StatusCode st = db.open(&pool);
+    if (st == StatusCode::SUCCESS) {
+        window.setObservationSource(&source);
+    } else {
+        qWarning() << statusToMessage(st);
+    }
+
     window.show();
-    return app.exec();
+    const int rc = app.exec();
+
+    window.setObservationSource(nullptr);
+    db.close();
+    return rc;
 }
@@ -0,0 +1,695 @@
+// Микробенчмарк вставок в SQLiteDb.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --rows 20000
+//
+// legacy — как было: prepare() на каждый вызов и отдельный SELECT last_insert_rowid();
+// cached — подготовленный запрос из кэша SQLiteDb и id прямо из вставки.
+// Оба пути делают одну и ту же простую вставку в Observations: addPoint добавил бы
+// к ней разбор JSON, поля сенсоров и агрегаты, и сравнение было бы не о подготовке запроса.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --rows 5000 --profiles
+//
+// Для каждого профиля (Config::DB_PROFILE_*) — вставки в автокоммите, как их делает Manager,
+// и скорость чтения всей таблицы Points.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --check-plans
+//
+// Проверка планов горячих запросов (QueryPlanCheck); код возврата 1 — есть полное сканирование.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --check-retention
+//
+// Политика хранения (RetentionEngine) на тестовой БД: удаление старых точек и сборка мусора блобов.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --check-journal
+//
+// Перезапуски журнала входящих сообщений (в том числе без сообщений) и восстановление;
+// повтор через Manager записей, которые уже есть в БД, не создаёт вторых точек.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --check-shards
+//
+// Файлы сессий (ShardedDb): Manager пишет две сессии со спецификацией из каталога, одна
+// архивируется, обе читаются одним запросом через ATTACH, затем восстановление и удаление.
+//
+//   AgroDbBench --db /tmp/agro_bench.db --rows 20000 --raw --image-kb 32
+//
+// Стоимость сообщения "data" от байт сети до строки Points (мкс на сообщение, процессорное
+// время процесса): parsed — QJsonDocument::fromJson + addPoint (разбор и повторная сериализация),
+// raw — RawJson::Document + addPointRaw (исходные байты). Отдельно — только подготовка
+// data_json без SQLite.
+
+#include "sqlitedb.h"
+#include "ingestjournal.h"
+#include "manager.h"
+#include "rawjson.h"
+#include "queryplancheck.h"
+#include "retentionengine.h"
+#include "shardeddb.h"
+#include "config.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlQuery>
+#include <QRandomGenerator>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+QJsonObject samplePoint(int i)
+{
+    QJsonObject data;
+    data["latitude"] = 59.9 + i * 1e-6;
+    data["longitude"] = 30.3 + i * 1e-6;
+    data["temperature"] = 18.0 + (i % 50) * 0.1;
+    data["humidity"] = 40 + i % 30;
+    data["soil_ph"] = 6.5;
+    return data;
+}
+
+// Старый путь вставки — воспроизводит SQLiteDb до кэша запросов
+double benchLegacy(int pointId, int rows)
+{
+    QSqlDatabase db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+    volatile int sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    db.transaction();
+    for (int i = 0; i < rows; ++i) {
+        QSqlQuery query(db);
+        query.prepare("INSERT INTO Observations (point_id) VALUES (:point_id)");
+        query.bindValue(":point_id", pointId);
+        query.exec();
+
+        QSqlQuery idQuery(db);
+        idQuery.exec("SELECT last_insert_rowid();");
+        idQuery.next();
+        sink = idQuery.value(0).toInt();
+    }
+    db.commit();
+
+    return rows * 1000.0 / std::max<qint64>(1, timer.elapsed());
+}
+
+
+// Тот же INSERT через SQLiteDb::addObservation: preparedQuery() и id из самой вставки
+double benchCached(SQLiteDb& sqlite, int pointId, int rows)
+{
+    QSqlDatabase db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+    volatile int sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    db.transaction();
+    for (int i = 0; i < rows; ++i) {
+        int id = -1;
+        sqlite.addObservation(pointId, &id);
+        sink = id;
+    }
+    db.commit();
+
+    return rows * 1000.0 / std::max<qint64>(1, timer.elapsed());
+}
+
+
+// Прогрев: страницы БД и кэш запросов addPoint
+void warmUp(SQLiteDb& sqlite, int rows)
+{
+    QSqlDatabase db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+
+    db.transaction();
+    for (int i = 0; i < rows; ++i) {
+        const QJsonObject data = samplePoint(i);
+        sqlite.addPoint(1, 1, data["latitude"].toDouble(), data["longitude"].toDouble(), data);
+    }
+    db.commit();
+}
+
+
+// Процессорное время процесса, нс: ожидание диска в него не входит
+qint64 cpuNs()
+{
+    return qint64(std::clock()) * 1000000000 / CLOCKS_PER_SEC;
+}
+
+
+// Сообщения как они приходят из сети; изображение у каждого десятого.
+// Разный seed — разные изображения: хранилище блобов не находит их уже записанными
+QVector<QByteArray> wireMessages(int rows, int imageBytes, quint32 seed)
+{
+    QVector<QByteArray> messages;
+    messages.reserve(rows);
+
+    QByteArray image(imageBytes, '\0');
+    for (int i = 0; i < rows; ++i) {
+        QJsonObject data = samplePoint(i);
+        data["rotation_angle"] = (i % 360) * 1.0;
+        if (imageBytes > 0 && i % 10 == 0) {
+            QRandomGenerator gen(seed * 1000003u + quint32(i));
+            for (int b = 0; b < image.size(); b += 4) {
+                const quint32 r = gen.generate();
+                memcpy(image.data() + b, &r, size_t(std::min(4, int(image.size()) - b)));
+            }
+            data["img_base64"] = QString::fromLatin1(image.toBase64());
+        }
+        messages.append(QJsonDocument(data).toJson(QJsonDocument::Compact));
+    }
+    return messages;
+}
+
+
+int benchRaw(SQLiteDb& sqlite, int rows, int imageBytes)
+{
+    QSqlDatabase db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+    const QVector<QByteArray> messages = wireMessages(rows, imageBytes, 1);
+    const QVector<QByteArray> rawMessages = wireMessages(rows, imageBytes, 2);
+
+    qint64 bytes = 0;
+    for (const QByteArray& m : messages) {
+        bytes += m.size();
+    }
+
+    // Только подготовка data_json: разбор + сериализация против разметки полей
+    qint64 start = cpuNs();
+    qint64 sink = 0;
+    for (const QByteArray& m : messages) {
+        const QJsonObject data = QJsonDocument::fromJson(m).object();
+        sink += QString(QJsonDocument(data).toJson(QJsonDocument::Compact)).size();
+    }
+    const double parsedPrepUs = (cpuNs() - start) / 1000.0 / rows;
+
+    start = cpuNs();
+    for (const QByteArray& m : messages) {
+        RawJson::Document doc;
+        doc.parse(m);
+        sink += QString::fromUtf8(doc.bytes()).size();
+    }
+    const double rawPrepUs = (cpuNs() - start) / 1000.0 / rows;
+
+    // Полный путь до строки Points, одна транзакция на прогон
+    db.transaction();
+    start = cpuNs();
+    for (const QByteArray& m : messages) {
+        const QJsonObject data = QJsonDocument::fromJson(m).object();
+        int id = -1;
+        sqlite.addPoint(1, 1, data["latitude"].toDouble(), data["longitude"].toDouble(), data, -1, &id);
+    }
+    const double parsedUs = (cpuNs() - start) / 1000.0 / rows;
+    db.commit();
+
+    db.transaction();
+    start = cpuNs();
+    for (const QByteArray& m : rawMessages) {
+        RawJson::Document doc;
+        doc.parse(m);
+        int id = -1;
+        sqlite.addPointRaw(1, 1, doc.number(QLatin1String("latitude")), doc.number(QLatin1String("longitude")),
+                           doc, -1, &id);
+    }
+    const double rawUs = (cpuNs() - start) / 1000.0 / rows;
+    db.commit();
+
+    qInfo().noquote() << QString("messages=%1 avg_bytes=%2").arg(rows).arg(bytes / std::max(1, rows));
+    qInfo().noquote() << QString("data_json prep us/msg parsed=%1 raw=%2 saved=%3")
+                             .arg(parsedPrepUs, 0, 'f', 2)
+                             .arg(rawPrepUs, 0, 'f', 2)
+                             .arg(parsedPrepUs - rawPrepUs, 0, 'f', 2);
+    qInfo().noquote() << QString("insert cpu us/msg parsed=%1 raw=%2 saved=%3")
+                             .arg(parsedUs, 0, 'f', 2)
+                             .arg(rawUs, 0, 'f', 2)
+                             .arg(parsedUs - rawUs, 0, 'f', 2);
+
+    // Сумма нужна только как зависимость для оптимизатора
+    volatile qint64 keep = sink;
+    Q_UNUSED(keep);
+    return 0;
+}
+
+
+void removeDbFiles(const QString& path)
+{
+    QFile::remove(path);
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+    QDir(path + ".blobs").removeRecursively();
+}
+
+
+// Вставки по одной (каждая в своей транзакции): точка + наблюдение
+double benchAutocommitIngest(SQLiteDb& sqlite, int rows)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < rows; ++i) {
+        QJsonObject data = samplePoint(i);
+        int pointId = -1;
+        sqlite.addPoint(1, 1, data["latitude"].toDouble(), data["longitude"].toDouble(), data, -1, &pointId);
+        sqlite.addObservation(pointId);
+    }
+
+    return rows * 1000.0 / std::max<qint64>(1, timer.elapsed());
+}
+
+
+// Полное чтение Points с разбором координат и data_json
+double benchRead(int passes)
+{
+    QSqlDatabase db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 rowsRead = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.exec("SELECT id, latitude, longitude, data_json FROM Points");
+        while (query.next()) {
+            query.value(1).toDouble();
+            query.value(2).toDouble();
+            query.value(3).toString();
+            ++rowsRead;
+        }
+    }
+
+    return rowsRead * 1000.0 / std::max<qint64>(1, timer.elapsed());
+}
+
+
+int benchProfiles(const QString& path, int rows)
+{
+    const QVector<DbProfile> profiles = {
+        Config::DB_PROFILE_DURABLE,
+        Config::DB_PROFILE_FIELD_INGEST,
+        Config::DB_PROFILE_ANALYTICS,
+    };
+
+    for (const DbProfile& profile : profiles) {
+        removeDbFiles(path);
+
+        SQLiteDb sqlite;
+        sqlite.setProfile(profile.name);
+        if (sqlite.connect(path) != StatusCode::SUCCESS) {
+            return 1;
+        }
+
+        const double ingest = benchAutocommitIngest(sqlite, rows);
+        const double read = benchRead(10);
+
+        qInfo().noquote() << QString("profile=%1 ingest_points/sec=%2 read_rows/sec=%3")
+                                 .arg(profile.name, -12)
+                                 .arg(ingest, 0, 'f', 0)
+                                 .arg(read, 0, 'f', 0);
+        sqlite.disconnect();
+    }
+
+    removeDbFiles(path);
+    return 0;
+}
+
+
+// Политика хранения на тестовой БД: старые точки с изображениями удаляются вместе
+// с наблюдениями, ссылки на блобы снимаются, сборка мусора удаляет строки Blobs и файлы.
+// Молодые точки и их блобы остаются. Код возврата 1 — что-то из этого не так
+int checkRetention(SQLiteDb& sqlite, const QString& path)
+{
+    const int OLD_ROWS = 40;
+    const int YOUNG_ROWS = 10;
+
+    const QVector<QByteArray> messages = wireMessages((OLD_ROWS + YOUNG_ROWS) * 10, 4096, 3);
+    int inserted = 0;
+    for (const QByteArray& m : messages) {
+        RawJson::Document doc;
+        if (!doc.parse(m) || !doc.find(QLatin1String("img_base64"))) {
+            continue;   // только точки с изображением
+        }
+        int pointId = -1;
+        int observationId = -1;
+        if (sqlite.addPointRaw(1, 1, doc.number(QLatin1String("latitude")), doc.number(QLatin1String("longitude")),
+                               doc, -1, &pointId) != StatusCode::SUCCESS
+            || sqlite.addObservation(pointId, &observationId) != StatusCode::SUCCESS) {
+            return 1;
+        }
+        ++inserted;
+    }
+
+    // Первые OLD_ROWS точек — «два месяца назад»
+    sqlite.exec("UPDATE Points SET created_at = datetime('now', '-60 days') WHERE id <= :last",
+                {{":last", OLD_ROWS}});
+
+    RetentionEngine retention(&sqlite);
+    RetentionPolicy policy;
+    policy.tableName = "Points";
+    policy.action = RetentionPolicy::Action::DeleteRows;
+    policy.maxAgeDays = 30;
+    if (retention.addPolicy(policy) != StatusCode::SUCCESS) {
+        return 1;
+    }
+
+    int steps = 0;
+    while (retention.runStep() && ++steps < 100000) {
+    }
+
+    auto count = [&sqlite](const QString& sql) {
+        qint64 n = -1;
+        sqlite.forEachRow(sql, [&n](const SqlCursor& row) {
+            n = row.toInt64(0);
+            return false;
+        });
+        return n;
+    };
+
+    qint64 files = 0;
+    QDirIterator it(path + ".blobs", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++files;
+    }
+
+    const qint64 points = count("SELECT COUNT(*) FROM Points");
+    const qint64 observations = count("SELECT COUNT(*) FROM Observations");
+    const qint64 blobs = count("SELECT COUNT(*) FROM Blobs");
+    const qint64 liveBlobs = count("SELECT COUNT(*) FROM Blobs WHERE refcount > 0");
+
+    const int young = inserted - OLD_ROWS;
+    const bool ok = points == young && observations == young && blobs == young
+                 && liveBlobs == young && files == young;
+
+    qInfo().noquote() << QString("retention steps=%1 points=%2 observations=%3 blobs=%4 live_blobs=%5 files=%6 expected=%7 %8")
+                             .arg(steps).arg(points).arg(observations).arg(blobs).arg(liveBlobs).arg(files)
+                             .arg(young).arg(ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+// Перезапуски журнала: запуски без сообщений между запусками с неприменёнными записями.
+// Каждый запуск: open → recover (сверка проигранного) → append → close без отметки
+// о применении, как при падении. Код возврата 1 — запись потеряна или проиграна повторно
+int checkJournal(const QString& dir)
+{
+    struct Run {
+        QStringList expectReplay;
+        QStringList append;
+        bool markApplied;
+    };
+
+    const QVector<Run> runs = {
+        {{}, {}, false},                 // пустой запуск
+        {{}, {"c1"}, false},             // новый сегмент с тем же номером, что у пустого
+        {{"c1"}, {"a1", "a2"}, true},
+        {{}, {}, false},                 // пустой сегмент, но applied > 0
+        {{}, {"b1"}, false},
+        {{"b1"}, {}, false},
+        {{}, {}, false},
+    };
+
+    QDir(dir).removeRecursively();
+    int failures = 0;
+
+    for (int i = 0; i < runs.size(); ++i) {
+        IngestJournal journal;
+        if (journal.open(dir) != StatusCode::SUCCESS) {
+            return 1;
+        }
+
+        QStringList replayed;
+        journal.recover([&replayed](quint64, const QString&, const QByteArray& payload) {
+            replayed.append(QString::fromUtf8(payload));
+        });
+
+        if (replayed != runs[i].expectReplay) {
+            qWarning().noquote() << "JOURNAL run" << i << "replayed" << replayed.join(',')
+                                 << "expected" << runs[i].expectReplay.join(',');
+            ++failures;
+        }
+
+        for (const QString& payload : runs[i].append) {
+            const quint64 seq = journal.append("data", payload.toUtf8());
+            if (seq == 0 || seq <= journal.appliedSeq()) {
+                qWarning().noquote() << "JOURNAL run" << i << "seq" << seq << "applied" << journal.appliedSeq();
+                ++failures;
+            }
+            if (runs[i].markApplied) {
+                journal.markApplied(seq);
+            }
+        }
+        journal.close();
+    }
+
+    QDir(dir).removeRecursively();
+    qInfo().noquote() << QString("journal restarts=%1 failures=%2").arg(runs.size()).arg(failures);
+    return failures == 0 ? 0 : 1;
+}
+
+
+// Сбой между фиксацией в БД и отметкой в журнале: одна запись уже в Points, другая — нет.
+// После перезапуска Manager проигрывает обе, но точек должно стать ровно по одной на запись
+int checkJournalReplay(SQLiteDb& sqlite, const QString& dir)
+{
+    auto message = [](int i) {
+        return QJsonDocument(samplePoint(i)).toJson(QJsonDocument::Compact);
+    };
+
+    QDir(dir).removeRecursively();
+
+    {
+        IngestJournal journal;
+        if (journal.open(dir) != StatusCode::SUCCESS) {
+            return 1;
+        }
+        Manager manager(&sqlite);
+        manager.setJournal(&journal);
+        manager.handleRaw("data", message(0));
+
+        // Точка записана, отметка о применении не дошла до диска
+        const QByteArray committed = message(1);
+        RawJson::Document doc;
+        doc.parse(committed);
+        const quint64 seq = journal.append("data", committed);
+        sqlite.addPointRaw(1, 1, doc.number(QLatin1String("latitude")), doc.number(QLatin1String("longitude")),
+                           doc, -1, nullptr, seq);
+
+        // Запись только в журнале
+        journal.append("data", message(2));
+        journal.close();
+    }
+
+    IngestJournal journal;
+    if (journal.open(dir) != StatusCode::SUCCESS) {
+        return 1;
+    }
+    Manager manager(&sqlite);
+    manager.setJournal(&journal);
+    const int replayed = manager.recoverFromJournal();
+    manager.handleRaw("data", message(3));
+    journal.close();
+    QDir(dir).removeRecursively();
+
+    qint64 points = 0;
+    qint64 seqs = 0;
+    sqlite.forEachRow("SELECT COUNT(*), COUNT(DISTINCT journal_seq) FROM Points", [&](const SqlCursor& row) {
+        points = row.toInt64(0);
+        seqs = row.toInt64(1);
+        return false;
+    });
+
+    const bool ok = replayed == 2 && points == 4 && seqs == 4;
+    qInfo().noquote() << QString("journal replay replayed=%1 points=%2 journal_seqs=%3 expected=2/4/4 %4")
+                             .arg(replayed).arg(points).arg(seqs).arg(ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+
+// Сессии в своих файлах: запись через Manager, архив, запрос по нескольким сессиям,
+// восстановление и удаление. Код возврата 1 — расхождение на каком-то шаге
+int checkShards(const QString& dir)
+{
+    const int perSession = 50;
+    const QJsonObject spec{{"fields", QJsonArray{"temperature", "humidity"}}};
+
+    QDir(dir).removeRecursively();
+
+    ShardedDb sharded;
+    if (sharded.open(dir) != StatusCode::SUCCESS) {
+        return 1;
+    }
+
+    QStringList failures;
+    auto expect = [&failures](bool ok, const QString& what) {
+        if (!ok) {
+            failures.append(what);
+        }
+    };
+    auto count = [](SQLiteDb* db, const QString& sql) {
+        qint64 n = -1;
+        db->forEachRow(sql, [&n](const SqlCursor& row) {
+            n = row.toInt64(0);
+            return false;
+        });
+        return n;
+    };
+
+    QVector<int> ids;
+    for (int s = 0; s < 2; ++s) {
+        int id = -1;
+        if (sharded.createSession(QString("check %1").arg(s), id) != StatusCode::SUCCESS) {
+            return 1;
+        }
+        ids.append(id);
+
+        Manager manager(sharded.session(id));
+        manager.setSession(id);
+        manager.handle("spec", spec);
+        for (int i = 0; i < perSession; ++i) {
+            manager.handleRaw("data", QJsonDocument(samplePoint(i)).toJson(QJsonDocument::Compact));
+        }
+    }
+
+    // id спецификации выдаёт каталог; в файле сессии — та же строка с тем же id
+    int specId = -1;
+    sharded.catalog()->addSensorSpec(spec, &specId);
+    for (int id : std::as_const(ids)) {
+        SQLiteDb* shard = sharded.session(id);
+        expect(count(shard, QString("SELECT COUNT(*) FROM Points WHERE spec_id = %1 AND session_id = %2")
+                                .arg(specId).arg(id)) == perSession,
+               QString("points of session %1").arg(id));
+        expect(count(shard, QString("SELECT COUNT(*) FROM Sensor_specs WHERE id = %1").arg(specId)) == 1,
+               QString("spec copy in session %1").arg(id));
+        expect(count(shard, "SELECT COUNT(*) FROM Sessions") == 0, QString("Sessions row in session %1").arg(id));
+    }
+
+    expect(sharded.archiveSession(ids[0]) == StatusCode::SUCCESS, "archive");
+    expect(sharded.sessionIds() == QVector<int>{ids[1]}, "active after archive");
+    expect(QFile::exists(QDir(dir).filePath(QString("archive/%1.db").arg(ids[0]))), "archived file");
+
+    qint64 total = -1;
+    const StatusCode st = sharded.crossSession(ids, [&](SQLiteDb& catalog, const QStringList& schemas) {
+        total = count(&catalog, "SELECT SUM(n) FROM ("
+                                + ShardedDb::unionAll("SELECT COUNT(*) AS n FROM %1.Points", schemas) + ")");
+        return StatusCode::SUCCESS;
+    });
+    expect(st == StatusCode::SUCCESS && total == 2 * perSession, "cross-session count");
+
+    expect(sharded.restoreSession(ids[0]) == StatusCode::SUCCESS && sharded.session(ids[0]) != nullptr, "restore");
+    expect(sharded.dropSession(ids[1]) == StatusCode::SUCCESS, "drop");
+    expect(sharded.sessionIds() == QVector<int>{ids[0]}, "active after drop");
+    expect(!QFile::exists(QDir(dir).filePath(QString("sessions/%1.db").arg(ids[1]))), "dropped file");
+
+    sharded.close();
+    QDir(dir).removeRecursively();
+
+    qInfo().noquote() << QString("shards sessions=%1 points=%2 %3")
+                             .arg(ids.size()).arg(total)
+                             .arg(failures.isEmpty() ? "OK" : "FAILED: " + failures.join(", "));
+    return failures.isEmpty() ? 0 : 1;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroDbBench");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"db", "Scratch database file (recreated).", "path", "agro_bench.db"},
+        {"rows", "Rows per run.", "count", "20000"},
+        {"profiles", "Compare ingest and read throughput of the DB performance profiles."},
+        {"check-plans", "Fail if any hot query plan falls back to a full table scan."},
+        {"check-journal", "Fail if journal restarts (including runs without messages) lose or repeat records."},
+        {"check-retention", "Fail if a retention policy does not prune old points and collect their blobs."},
+        {"check-shards", "Fail if per-session files are not written, archived, queried or dropped correctly."},
+        {"raw", "Compare per-message CPU of parsed vs raw-bytes point ingest."},
+        {"image-kb", "Image size for --raw (every 10th message), KiB.", "kb", "0"},
+    });
+    parser.process(app);
+
+    const QString path = parser.value("db");
+    const int rows = parser.value("rows").toInt();
+
+    if (parser.isSet("profiles")) {
+        return benchProfiles(path, rows);
+    }
+
+    if (parser.isSet("check-shards")) {
+        return checkShards(path + ".shards");
+    }
+
+    removeDbFiles(path);
+
+    SQLiteDb sqlite;
+    if (sqlite.connect(path) != StatusCode::SUCCESS) {
+        return 1;
+    }
+
+    if (parser.isSet("check-journal")) {
+        int st = checkJournal(path + ".journal");
+        st |= checkJournalReplay(sqlite, path + ".journal");
+        sqlite.disconnect();
+        removeDbFiles(path);
+        return st;
+    }
+
+    if (parser.isSet("check-plans")) {
+        const QVector<QueryPlanCheck::Issue> issues = QueryPlanCheck::run(sqlite, true);
+        for (const QueryPlanCheck::Issue& issue : issues) {
+            qWarning().noquote() << "FULL SCAN in" << issue.queryName << ":" << issue.detail;
+        }
+        sqlite.disconnect();
+        removeDbFiles(path);
+        return issues.isEmpty() ? 0 : 1;
+    }
+
+    if (parser.isSet("check-retention")) {
+        const int st = checkRetention(sqlite, path);
+        sqlite.disconnect();
+        removeDbFiles(path);
+        return st;
+    }
+
+    if (parser.isSet("raw")) {
+        warmUp(sqlite, 1000);
+        const int st = benchRaw(sqlite, rows, parser.value("image-kb").toInt() * 1024);
+        sqlite.disconnect();
+        removeDbFiles(path);
+        return st;
+    }
+
+    // Точка, к которой относятся наблюдения, и прогрев обоих путей
+    int pointId = -1;
+    const QJsonObject point = samplePoint(0);
+    if (sqlite.addPoint(1, 1, point["latitude"].toDouble(), point["longitude"].toDouble(), point,
+                        -1, &pointId) != StatusCode::SUCCESS) {
+        sqlite.disconnect();
+        return 1;
+    }
+    benchLegacy(pointId, 1000);
+    benchCached(sqlite, pointId, 1000);
+
+    const double legacy = benchLegacy(pointId, rows);
+    const double cached = benchCached(sqlite, pointId, rows);
+
+    qInfo().noquote() << QString("inserts/sec legacy=%1 cached=%2 speedup=%3x")
+                             .arg(legacy, 0, 'f', 0)
+                             .arg(cached, 0, 'f', 0)
+                             .arg(cached / legacy, 0, 'f', 2);
+
+    sqlite.disconnect();
+    return 0;
+}
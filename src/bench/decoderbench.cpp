@@ -0,0 +1,273 @@
+// Бенчмарк разбора кадров сенсоров: двоичный кадр по плану из спецификации
+// против того же набора значений в JSON.
+//
+//   AgroDecoderBench --frames 200000 --channels 16 --byte-order big
+//
+// json   — QJsonDocument::fromJson и чтение каждого канала, как сейчас получает данные Manager;
+// binary — FramePlan::decode в массив double, без промежуточного JSON;
+// object — decode + FramePlan::toJson: полный путь Manager::handleFrame до сообщения "data".
+// Кадры и JSON готовятся заранее, в замер входит только разбор. Перед замером каждый кадр
+// сверяется со своим JSON (в том числе счётчик u64 больше 2^53); расхождение — код возврата 1.
+
+#include "framedecoder.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace {
+
+const int DISTINCT_FRAMES = 1024;   // кадров в кольце: данные разные, но помещаются в кэш
+
+// Номер кадра: u64 за пределами точности double
+const quint64 FRAME_SEQ_BASE = (quint64(1) << 60) + 1;
+
+// latitude, longitude (f64), frame_seq (u64), затем каналы по кругу: i16 с масштабом, u16, f32, bool
+QJsonObject makeSpec(int channels, const QString& byteOrder)
+{
+    static const char* types[] = {"i16", "u16", "f32", "bool"};
+
+    QJsonArray list;
+    list.append(QJsonObject{{"name", "latitude"}, {"type", "f64"}});
+    list.append(QJsonObject{{"name", "longitude"}, {"type", "f64"}});
+    list.append(QJsonObject{{"name", "frame_seq"}, {"type", "u64"}});
+
+    for (int i = 0; i < channels; ++i) {
+        QJsonObject ch{{"name", QString("ch%1").arg(i)}, {"type", types[i % 4]}};
+        if (i % 4 == 0) {
+            ch["scale"] = 0.01;
+            ch["offset"] = -40;
+        }
+        list.append(ch);
+    }
+
+    return QJsonObject{{"frame", QJsonObject{{"byte_order", byteOrder}, {"channels", list}}}};
+}
+
+
+template <typename T>
+void put(QByteArray& frame, int& at, T value, bool big)
+{
+    T wire = big ? qToBigEndian(value) : qToLittleEndian(value);
+    std::memcpy(frame.data() + at, &wire, sizeof(T));
+    at += sizeof(T);
+}
+
+
+// Кадр и равнозначный ему JSON (значения — уже с масштабом, как после разбора)
+void makeFrame(const FramePlan& plan, int channels, bool big, quint64 seq, std::mt19937& rng,
+               QByteArray& frame, QByteArray& json)
+{
+    std::uniform_real_distribution<double> coord(-0.01, 0.01);
+    std::uniform_int_distribution<int> raw(0, 6000);
+
+    frame = QByteArray(plan.frameSize(), '\0');
+    QJsonObject obj;
+    int at = 0;
+
+    const double lat = 59.9 + coord(rng);
+    const double lon = 30.3 + coord(rng);
+    quint64 bits;
+    std::memcpy(&bits, &lat, 8);
+    put<quint64>(frame, at, bits, big);
+    std::memcpy(&bits, &lon, 8);
+    put<quint64>(frame, at, bits, big);
+    obj["latitude"] = lat;
+    obj["longitude"] = lon;
+
+    put<quint64>(frame, at, seq, big);
+    obj["frame_seq"] = QString::number(seq);
+
+    for (int i = 0; i < channels; ++i) {
+        const QString name = QString("ch%1").arg(i);
+        const int r = raw(rng);
+
+        switch (i % 4) {
+        case 0:
+            put<qint16>(frame, at, qint16(r), big);
+            obj[name] = r * 0.01 - 40;
+            break;
+        case 1:
+            put<quint16>(frame, at, quint16(r), big);
+            obj[name] = r;
+            break;
+        case 2: {
+            const float f = float(r) / 7.0f;
+            quint32 fbits;
+            std::memcpy(&fbits, &f, 4);
+            put<quint32>(frame, at, fbits, big);
+            obj[name] = double(f);
+            break;
+        }
+        default:
+            frame[at++] = char(r & 1);
+            obj[name] = bool(r & 1);
+            break;
+        }
+    }
+
+    json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+
+// Разбор кадра должен дать то же, что записано в его JSON
+bool sameValues(const QJsonObject& decoded, const QJsonObject& expected)
+{
+    if (decoded.keys() != expected.keys()) {
+        return false;
+    }
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        const QJsonValue got = decoded.value(it.key());
+        if (it.value().isDouble() && got.isDouble()) {
+            const double a = got.toDouble();
+            const double b = it.value().toDouble();
+            if (std::abs(a - b) > 1e-9 * std::max(1.0, std::abs(b))) {
+                return false;
+            }
+        }
+        else if (got != it.value()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+double framesPerSec(qint64 frames, qint64 elapsedNs)
+{
+    return frames * 1e9 / std::max<qint64>(1, elapsedNs);
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroDecoderBench");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"frames", "Frames to decode per run.", "count", "200000"},
+        {"channels", "Sensor channels per frame (besides latitude/longitude).", "count", "16"},
+        {"byte-order", "Frame byte order: little or big.", "order", "little"},
+    });
+    parser.process(app);
+
+    const int frames = parser.value("frames").toInt();
+    const int channels = std::max(1, parser.value("channels").toInt());
+    const QString byteOrder = parser.value("byte-order");
+
+    FramePlan plan;
+    if (FramePlan::compile(makeSpec(channels, byteOrder), plan) != StatusCode::SUCCESS) {
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+    QVector<QByteArray> binary(DISTINCT_FRAMES);
+    QVector<QByteArray> json(DISTINCT_FRAMES);
+    for (int i = 0; i < DISTINCT_FRAMES; ++i) {
+        makeFrame(plan, channels, byteOrder == "big", FRAME_SEQ_BASE + quint64(i), rng, binary[i], json[i]);
+    }
+
+    QVector<double> values(plan.channelCount());
+
+    int mismatches = 0;
+    for (int i = 0; i < DISTINCT_FRAMES; ++i) {
+        const QJsonObject expected = QJsonDocument::fromJson(json[i]).object();
+        if (!plan.decode(binary[i].constData(), int(binary[i].size()), values.data())
+            || !sameValues(plan.toJson(values.constData()), expected)) {
+            if (mismatches++ == 0) {
+                qWarning().noquote() << "MISMATCH frame" << i << "expected" << json[i]
+                                     << "decoded" << QJsonDocument(plan.toJson(values.constData())).toJson(QJsonDocument::Compact);
+            }
+        }
+    }
+    if (mismatches > 0) {
+        qWarning().noquote() << "frames decoded differently from their JSON:" << mismatches;
+        return 1;
+    }
+    qInfo().noquote() << "decoded frames match their JSON:" << DISTINCT_FRAMES;
+
+    QVector<QString> names;
+    QVector<FramePlan::ValueType> types;
+    for (int i = 0; i < plan.channelCount(); ++i) {
+        names.append(plan.channel(i).name);
+        types.append(plan.channel(i).valueType);
+    }
+
+    double checksum = 0;   // чтобы компилятор не выбросил разбор
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        const QJsonObject obj = QJsonDocument::fromJson(json[i % DISTINCT_FRAMES]).object();
+        for (int c = 0; c < names.size(); ++c) {
+            const QJsonValue v = obj.value(names[c]);
+
+            // 64-битные целые: строкой (больше 2^53) или числом; в ячейку — их биты, как у decode()
+            if (types[c] == FramePlan::ValueType::UInt64) {
+                const quint64 bits = v.isString() ? v.toString().toULongLong() : quint64(v.toDouble());
+                std::memcpy(&values[c], &bits, sizeof(bits));
+            }
+            else if (types[c] == FramePlan::ValueType::Int64) {
+                const qint64 bits = v.isString() ? v.toString().toLongLong() : qint64(v.toDouble());
+                std::memcpy(&values[c], &bits, sizeof(bits));
+            }
+            else {
+                values[c] = v.toDouble();
+            }
+        }
+        checksum += values[0];
+    }
+    const qint64 jsonNs = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        const QByteArray& frame = binary[i % DISTINCT_FRAMES];
+        if (!plan.decode(frame.constData(), int(frame.size()), values.data())) {
+            return 1;
+        }
+        checksum += values[0];
+    }
+    const qint64 binaryNs = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        const QByteArray& frame = binary[i % DISTINCT_FRAMES];
+        plan.decode(frame.constData(), int(frame.size()), values.data());
+        checksum += plan.toJson(values.constData()).size();
+    }
+    const qint64 objectNs = timer.nsecsElapsed();
+
+    const double jsonRate = framesPerSec(frames, jsonNs);
+    const double binaryRate = framesPerSec(frames, binaryNs);
+    const double objectRate = framesPerSec(frames, objectNs);
+
+    qInfo().noquote() << QString("channels=%1 frame_bytes=%2 json_bytes=%3")
+                             .arg(plan.channelCount())
+                             .arg(plan.frameSize())
+                             .arg(json[0].size());
+    qInfo().noquote() << QString("frames/sec json=%1 binary=%2 (%3x) binary+object=%4 (%5x)")
+                             .arg(jsonRate, 0, 'f', 0)
+                             .arg(binaryRate, 0, 'f', 0)
+                             .arg(binaryRate / jsonRate, 0, 'f', 1)
+                             .arg(objectRate, 0, 'f', 0)
+                             .arg(objectRate / jsonRate, 0, 'f', 1);
+
+    // Сумма нужна только как зависимость для оптимизатора
+    volatile double sink = checksum;
+    Q_UNUSED(sink);
+    return 0;
+}
@@ -0,0 +1,520 @@
+// Набор бенчмарков хранилища SQLiteDb на синтетических сессиях.
+//
+//   AgroStorageBench --dir /tmp/agro_bench --sizes 10000,1000000,10000000 --out results.json
+//
+// Для каждого размера сессии — новая БД, в которой измеряются:
+//   insert  — точек/с при вставке по одной (как Manager), пакетами (addPoints) и через AsyncDb;
+//   growth  — размер файла БД, WAL и хранилища блобов по мере заполнения
+//             и скорость пакетной вставки на каждом отрезке;
+//   queries — задержка (p50/p95/p99, мс) запросов видимой области, выборки за интервал
+//             времени и агрегатов по времени.
+//
+// Точка — запись тележки с сенсорами, идущей змейкой по полю; каждая --image-every точка
+// несёт кадр --image-kb КБ (img_base64 → хранилище блобов) и ML результат к нему.
+// Генератор с фиксированным зерном: прогоны сравнимы между собой.
+// Результаты дописываются в JSON (--out) для отслеживания от версии к версии.
+
+#include "asyncdb.h"
+#include "sqlitedb.h"
+#include "config.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <random>
+
+namespace {
+
+const int SINGLE_SAMPLE_ROWS = 10000;   // вставки по одной и через AsyncDb: не больше стольких точек
+const int BULK_BATCH_ROWS = 1000;
+const int GROWTH_CHECKPOINTS = 10;
+const double FIELD_LAT = 59.9;
+const double FIELD_LON = 30.3;
+const double ROW_STEP_DEG = 0.00002;    // ≈ 2 м между проходами и между точками в проходе
+const int POINTS_PER_ROW = 2000;
+
+struct BenchOptions {
+    QString dir;
+    int imageBytes = 32 * 1024;
+    int imageEvery = 100;
+    int queries = 200;
+};
+
+// Синтетическая сессия: точки по порядку их записи
+class SessionGenerator {
+public:
+    explicit SessionGenerator(const BenchOptions& options)
+        : options(options), rng(42)
+    {
+        image.resize(options.imageBytes);
+        for (char& c : image) {
+            c = char(rng() & 0xFF);
+        }
+    }
+
+    bool hasImage(qint64 i) const { return options.imageEvery > 0 && i % options.imageEvery == 0; }
+
+    PointRow point(qint64 i)
+    {
+        // Змейка: чётные проходы на восток, нечётные на запад
+        const qint64 row = i / POINTS_PER_ROW;
+        const qint64 col = row % 2 == 0 ? i % POINTS_PER_ROW : POINTS_PER_ROW - 1 - i % POINTS_PER_ROW;
+
+        PointRow p;
+        p.latitude = FIELD_LAT + row * ROW_STEP_DEG + noise(rng) * 1e-6;
+        p.longitude = FIELD_LON + col * ROW_STEP_DEG + noise(rng) * 1e-6;
+
+        QJsonObject data;
+        data["latitude"] = p.latitude;
+        data["longitude"] = p.longitude;
+        data["device_id"] = "cart-01";
+        data["heading"] = row % 2 == 0 ? 90.0 : 270.0;
+        data["speed"] = 1.2 + noise(rng) * 0.1;
+        data["hdop"] = 0.8 + std::abs(noise(rng)) * 0.2;
+        data["temperature"] = 18.0 + 4.0 * std::sin(i * 1e-4) + noise(rng) * 0.3;
+        data["humidity"] = 45.0 + noise(rng) * 5.0;
+        data["soil_moisture"] = 0.3 + noise(rng) * 0.05;
+        data["soil_ph"] = 6.5 + noise(rng) * 0.2;
+        data["ndvi"] = 0.6 + noise(rng) * 0.1;
+
+        if (hasImage(i)) {
+            // Первые байты — номер кадра, чтобы каждый кадр был отдельным блобом
+            memcpy(image.data(), &i, std::min<int>(sizeof(i), image.size()));
+            data["img_base64"] = QString::fromLatin1(image.toBase64());
+        }
+
+        p.data = data;
+        return p;
+    }
+
+    static QJsonObject mlResult(qint64 i)
+    {
+        QJsonObject result;
+        result["class"] = i % 7 == 0 ? "weed" : "crop";
+        result["confidence"] = 0.5 + (i % 50) * 0.01;
+        result["bbox"] = QJsonArray{12, 40, 96, 128};
+        return result;
+    }
+
+private:
+    BenchOptions options;
+    std::mt19937_64 rng;
+    std::normal_distribution<double> noise{0.0, 1.0};
+    QByteArray image;
+};
+
+
+double perSecond(qint64 count, qint64 elapsedMs)
+{
+    return count * 1000.0 / std::max<qint64>(1, elapsedMs);
+}
+
+
+void removeDbFiles(const QString& path)
+{
+    QFile::remove(path);
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+    QDir(path + ".blobs").removeRecursively();
+}
+
+
+qint64 dirSize(const QString& dir)
+{
+    qint64 total = 0;
+    QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        total += it.fileInfo().size();
+    }
+    return total;
+}
+
+
+QJsonObject fileSizes(const QString& path, qint64 points)
+{
+    QJsonObject sizes;
+    sizes["points"] = points;
+    sizes["db_bytes"] = QFileInfo(path).size();
+    sizes["wal_bytes"] = QFileInfo(path + "-wal").size();
+    sizes["blob_bytes"] = dirSize(path + ".blobs");
+    return sizes;
+}
+
+
+QJsonObject latencyStats(QVector<double> ms, qint64 rows)
+{
+    QJsonObject stats;
+    if (ms.isEmpty()) {
+        return stats;
+    }
+
+    std::sort(ms.begin(), ms.end());
+    auto pct = [&ms](double p) { return ms[std::min<int>(ms.size() - 1, int(p * ms.size()))]; };
+
+    double sum = 0;
+    for (double v : ms) {
+        sum += v;
+    }
+
+    stats["count"] = ms.size();
+    stats["mean_ms"] = sum / ms.size();
+    stats["p50_ms"] = pct(0.50);
+    stats["p95_ms"] = pct(0.95);
+    stats["p99_ms"] = pct(0.99);
+    stats["max_ms"] = ms.last();
+    stats["mean_rows"] = double(rows) / ms.size();
+    return stats;
+}
+
+
+// Точка, наблюдение и ML результат к кадру — каждый вызов в своей транзакции, как в Manager
+StatusCode insertSingle(SQLiteDb& db, SessionGenerator& gen, int sessionId, int fieldId, qint64 i)
+{
+    const PointRow p = gen.point(i);
+
+    int pointId = -1;
+    int observationId = -1;
+    StatusCode st = db.addPoint(fieldId, sessionId, p.latitude, p.longitude, p.data, p.specId, &pointId);
+    if (st == StatusCode::SUCCESS) {
+        st = db.addObservation(pointId, &observationId);
+    }
+    if (st == StatusCode::SUCCESS && gen.hasImage(i)) {
+        st = db.addMLResult(observationId, "weed_detector", SessionGenerator::mlResult(i));
+    }
+    return st;
+}
+
+
+StatusCode insertBulk(SQLiteDb& db, SessionGenerator& gen, int sessionId, int fieldId, qint64 from, qint64 to)
+{
+    QVector<PointRow> rows;
+    rows.reserve(int(to - from));
+    for (qint64 i = from; i < to; ++i) {
+        PointRow p = gen.point(i);
+        p.sessionId = sessionId;
+        p.fieldId = fieldId;
+        rows.append(p);
+    }
+
+    const BulkResult points = db.addPoints(rows);
+    if (points.code != StatusCode::SUCCESS) {
+        return points.code;
+    }
+
+    const BulkResult observations = db.addObservations(points.ids);
+    if (observations.code != StatusCode::SUCCESS) {
+        return observations.code;
+    }
+
+    QVector<MLResultRow> ml;
+    for (qint64 i = from; i < to; ++i) {
+        if (gen.hasImage(i)) {
+            ml.append({observations.ids[int(i - from)], "weed_detector", SessionGenerator::mlResult(i)});
+        }
+    }
+    return ml.isEmpty() ? StatusCode::SUCCESS : db.addMLResults(ml).code;
+}
+
+
+QString sqlTime(const QDateTime& t)
+{
+    return t.toUTC().toString("yyyy-MM-dd HH:mm:ss");
+}
+
+
+QJsonObject runSize(const BenchOptions& options, qint64 total)
+{
+    const QString path = QDir(options.dir).filePath(QString("bench_%1.db").arg(total));
+    removeDbFiles(path);
+
+    QJsonObject run;
+    run["points"] = total;
+
+    SQLiteDb db;
+    if (db.connect(path) != StatusCode::SUCCESS) {
+        run["error"] = "connect failed";
+        return run;
+    }
+
+    int sessionId = -1;
+    int fieldId = -1;
+    db.addSession("storage bench", &sessionId);
+    db.addField("bench field", QJsonObject(), sessionId, &fieldId);
+
+    SessionGenerator gen(options);
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    const QDateTime startedAt = QDateTime::currentDateTimeUtc();
+
+    QJsonObject insert;
+    qint64 next = 0;
+    QElapsedTimer timer;
+
+    // По одной: каждая вставка — своя транзакция
+    const qint64 singleRows = std::min<qint64>(total, SINGLE_SAMPLE_ROWS);
+    timer.start();
+    for (; next < singleRows; ++next) {
+        if (insertSingle(db, gen, sessionId, fieldId, next) != StatusCode::SUCCESS) {
+            run["error"] = "single insert failed";
+            return run;
+        }
+    }
+    insert["single_points_per_sec"] = perSecond(singleRows, timer.elapsed());
+
+    // Через AsyncDb: вставки в потоке БД, ограничение очереди — ожидание самых старых.
+    // Писатель AsyncDb на время замера единственный: второе соединение ждало бы блокировку
+    // и кэш страниц делился бы между двумя
+    const qint64 asyncRows = std::min<qint64>(total - next, SINGLE_SAMPLE_ROWS);
+    if (asyncRows > 0) {
+        db.disconnect();
+
+        AsyncDb async;
+        if (async.open(path) != StatusCode::SUCCESS) {
+            run["error"] = "async open failed";
+            return run;
+        }
+
+        std::deque<std::future<std::pair<StatusCode, int>>> inFlight;
+        StatusCode st = StatusCode::SUCCESS;
+
+        timer.start();
+        for (const qint64 end = next + asyncRows; next < end && st == StatusCode::SUCCESS; ++next) {
+            if (int(inFlight.size()) >= Config::ASYNC_DB_QUEUE_SIZE / 2) {
+                st = inFlight.front().get().first;
+                inFlight.pop_front();
+            }
+
+            const PointRow p = gen.point(next);
+            const QJsonObject ml = gen.hasImage(next) ? SessionGenerator::mlResult(next) : QJsonObject();
+
+            inFlight.push_back(async.run<int>("bench", [p, ml, sessionId, fieldId](SQLiteDb& adb, int& observationId) {
+                int pointId = -1;
+                StatusCode s = adb.addPoint(fieldId, sessionId, p.latitude, p.longitude, p.data, p.specId, &pointId);
+                if (s == StatusCode::SUCCESS) {
+                    s = adb.addObservation(pointId, &observationId);
+                }
+                if (s == StatusCode::SUCCESS && !ml.isEmpty()) {
+                    s = adb.addMLResult(observationId, "weed_detector", ml);
+                }
+                return s;
+            }));
+        }
+        for (auto& f : inFlight) {
+            const StatusCode s = f.get().first;
+            if (st == StatusCode::SUCCESS) {
+                st = s;
+            }
+        }
+        insert["async_points_per_sec"] = perSecond(asyncRows, timer.elapsed());
+        async.close();
+
+        if (st != StatusCode::SUCCESS) {
+            run["error"] = "async insert failed";
+            return run;
+        }
+        if (db.connect(path) != StatusCode::SUCCESS) {
+            run["error"] = "reconnect failed";
+            return run;
+        }
+    }
+
+    // Пакетами: остаток сессии, с замерами роста файла на контрольных точках
+    QJsonArray growth;
+    growth.append(fileSizes(path, next));
+
+    const qint64 bulkStart = next;
+    const qint64 step = std::max<qint64>(BULK_BATCH_ROWS, (total - bulkStart) / GROWTH_CHECKPOINTS);
+    QElapsedTimer bulkTimer;
+    bulkTimer.start();
+
+    while (next < total) {
+        const qint64 segmentEnd = std::min(total, next + step);
+        const qint64 segmentStart = next;
+
+        timer.start();
+        for (; next < segmentEnd; next = std::min(segmentEnd, next + BULK_BATCH_ROWS)) {
+            if (insertBulk(db, gen, sessionId, fieldId, next, std::min(segmentEnd, next + BULK_BATCH_ROWS))
+                    != StatusCode::SUCCESS) {
+                run["error"] = "bulk insert failed";
+                return run;
+            }
+        }
+
+        QJsonObject checkpoint = fileSizes(path, next);
+        checkpoint["bulk_points_per_sec"] = perSecond(next - segmentStart, timer.elapsed());
+        growth.append(checkpoint);
+    }
+    if (total > bulkStart) {
+        insert["bulk_points_per_sec"] = perSecond(total - bulkStart, bulkTimer.elapsed());
+    }
+
+    const QDateTime finishedAt = QDateTime::currentDateTimeUtc();
+    run["insert"] = insert;
+    run["growth"] = growth;
+    run["ingest_sec"] = totalTimer.elapsed() / 1000.0;
+
+    // Запросы: случайные окна по данным сессии
+    std::mt19937 rng(7);
+    const qint64 rows = (total + POINTS_PER_ROW - 1) / POINTS_PER_ROW;
+    std::uniform_real_distribution<double> latPick(FIELD_LAT, FIELD_LAT + rows * ROW_STEP_DEG);
+    std::uniform_real_distribution<double> lonPick(FIELD_LON, FIELD_LON + POINTS_PER_ROW * ROW_STEP_DEG);
+
+    const qint64 spanSec = std::max<qint64>(1, startedAt.secsTo(finishedAt));
+    const qint64 windowSec = std::max<qint64>(Config::ROLLUP_BUCKET_SEC, spanSec / 20);
+    std::uniform_int_distribution<qint64> timePick(0, std::max<qint64>(0, spanSec - windowSec));
+
+    QJsonObject queries;
+    QVector<double> ms;
+    qint64 found = 0;
+
+    // Видимая область ≈ 200 × 200 м
+    for (int q = 0; q < options.queries; ++q) {
+        GeoRect rect;
+        rect.latMin = latPick(rng);
+        rect.lonMin = lonPick(rng);
+        rect.latMax = rect.latMin + 0.002;
+        rect.lonMax = rect.lonMin + 0.002;
+
+        QVector<PointRecord> out;
+        timer.start();
+        db.pointsInRect(sessionId, rect, out, 5000);
+        ms.append(timer.nsecsElapsed() / 1e6);
+        found += out.size();
+    }
+    queries["viewport"] = latencyStats(ms, found);
+
+    ms.clear();
+    found = 0;
+    for (int q = 0; q < options.queries; ++q) {
+        const QDateTime from = startedAt.addSecs(timePick(rng));
+
+        timer.start();
+        SqlCursor cursor = db.select(
+            "SELECT id, latitude, longitude, data_json FROM Points "
+            "WHERE session_id = :session AND created_at BETWEEN :from AND :to",
+            {{":session", sessionId}, {":from", sqlTime(from)}, {":to", sqlTime(from.addSecs(windowSec))}});
+        while (cursor.next()) {
+            cursor.toDouble(1);
+            cursor.toDouble(2);
+            cursor.toBytes(3);
+        }
+        ms.append(timer.nsecsElapsed() / 1e6);
+        found += cursor.rowsRead();
+    }
+    queries["time_range"] = latencyStats(ms, found);
+
+    ms.clear();
+    found = 0;
+    for (int q = 0; q < options.queries; ++q) {
+        const qint64 from = startedAt.toSecsSinceEpoch() + timePick(rng);
+
+        QVector<RollupBucket> out;
+        timer.start();
+        db.rollupByTime(sessionId, "temperature", from, from + windowSec, out);
+        ms.append(timer.nsecsElapsed() / 1e6);
+        found += out.size();
+    }
+    queries["rollup_time"] = latencyStats(ms, found);
+
+    run["queries"] = queries;
+    run["final_size"] = fileSizes(path, total);
+
+    db.disconnect();
+    removeDbFiles(path);
+    return run;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroStorageBench");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"dir", "Directory for scratch databases (removed after each size).", "path", "."},
+        {"sizes", "Comma-separated session sizes in points.", "list", "10000,1000000,10000000"},
+        {"image-kb", "Image size in KiB.", "kib", "32"},
+        {"image-every", "Attach an image (and ML result) to every N-th point; 0 = none.", "n", "100"},
+        {"queries", "Queries per query type.", "count", "200"},
+        {"out", "JSON file the results are appended to.", "path", "storage_bench.json"},
+    });
+    parser.process(app);
+
+    BenchOptions options;
+    options.dir = parser.value("dir");
+    options.imageBytes = parser.value("image-kb").toInt() * 1024;
+    options.imageEvery = parser.value("image-every").toInt();
+    options.queries = parser.value("queries").toInt();
+
+    QDir().mkpath(options.dir);
+
+    QJsonArray runs;
+    for (const QString& size : parser.value("sizes").split(',', Qt::SkipEmptyParts)) {
+        const qint64 points = size.trimmed().toLongLong();
+        if (points <= 0) {
+            continue;
+        }
+
+        qInfo().noquote() << "points:" << points;
+        const QJsonObject run = runSize(options, points);
+        qInfo().noquote() << QJsonDocument(run).toJson(QJsonDocument::Indented);
+        runs.append(run);
+
+        if (run.contains("error")) {
+            break;
+        }
+    }
+
+    QJsonObject result;
+    result["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    result["host"] = QSysInfo::machineHostName();
+    result["cpu"] = QSysInfo::currentCpuArchitecture();
+    result["profile"] = Config::DB_PROFILE;
+    result["image_bytes"] = options.imageBytes;
+    result["image_every"] = options.imageEvery;
+    result["runs"] = runs;
+
+    // Файл — массив прогонов; новый добавляется в конец
+    const QString outPath = parser.value("out");
+    QJsonArray history;
+    QFile in(outPath);
+    if (in.open(QIODevice::ReadOnly)) {
+        history = QJsonDocument::fromJson(in.readAll()).array();
+        in.close();
+    }
+    history.append(result);
+
+    QFile out(outPath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write" << outPath;
+        return 1;
+    }
+    out.write(QJsonDocument(history).toJson(QJsonDocument::Indented));
+
+    for (const QJsonValue& run : runs) {
+        if (run.toObject().contains("error")) {
+            return 1;
+        }
+    }
+    return 0;
+}
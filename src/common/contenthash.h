@@ -0,0 +1,114 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <cstring>
+
+// Быстрый некриптографический хеш содержимого (алгоритм xxHash64).
+// В отличие от qHash не зависит от случайного seed процесса,
+// поэтому значения можно хранить в БД и сравнивать между запусками.
+namespace ContentHash {
+
+namespace detail {
+constexpr quint64 P1 = 0x9E3779B185EBCA87ull;
+constexpr quint64 P2 = 0xC2B2AE3D27D4EB4Full;
+constexpr quint64 P3 = 0x165667B19E3779F9ull;
+constexpr quint64 P4 = 0x85EBCA77C2B2AE63ull;
+constexpr quint64 P5 = 0x27D4EB2F165667C5ull;
+
+inline quint64 rotl(quint64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline quint64 read64(const uchar* p) { quint64 v; std::memcpy(&v, p, 8); return qFromLittleEndian(v); }
+inline quint32 read32(const uchar* p) { quint32 v; std::memcpy(&v, p, 4); return qFromLittleEndian(v); }
+
+inline quint64 round(quint64 acc, quint64 input)
+{
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 val)
+{
+    acc ^= round(0, val);
+    return acc * P1 + P4;
+}
+}
+
+inline quint64 hash64(const char* data, qsizetype size, quint64 seed = 0)
+{
+    using namespace detail;
+
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    const uchar* end = p + size;
+    quint64 h;
+
+    if (size >= 32) {
+        quint64 v1 = seed + P1 + P2;
+        quint64 v2 = seed + P2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - P1;
+
+        const uchar* limit = end - 32;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else {
+        h = seed + P5;
+    }
+
+    h += quint64(size);
+
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * P1 + P4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= quint64(read32(p)) * P1;
+        h = rotl(h, 23) * P2 + P3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= quint64(*p) * P5;
+        h = rotl(h, 11) * P1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline quint64 hash64(const QByteArray& data, quint64 seed = 0)
+{
+    return hash64(data.constData(), data.size(), seed);
+}
+
+// 16 шестнадцатеричных символов — для хранения в TEXT колонках
+inline QString toHex(quint64 hash)
+{
+    return QString("%1").arg(hash, 16, 16, QChar('0'));
+}
+
+}
+
+#endif // CONTENTHASH_H
@@ -0,0 +1,328 @@
+#ifndef RAWJSON_H
+#define RAWJSON_H
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QString>
+#include <QVector>
+
+#include <cstring>
+
+// Разбор JSON-объекта только на верхнем уровне: где начинается и кончается каждое поле.
+//
+// Для пути приёма, где сообщение сохраняется как есть: байты остаются исходными,
+// значения разбираются по запросу (координаты, числа для агрегатов), вложенные
+// объекты и массивы только пропускаются по скобкам. Строки не декодируются —
+// для полей без escape-последовательностей содержимое доступно без копирования.
+namespace RawJson {
+
+enum class Kind { String, Number, Bool, Null, Object, Array };
+
+struct Field {
+    int keyBegin = 0;      // первый символ имени (после кавычки)
+    int keyLength = 0;
+    int valueBegin = 0;    // у строк — открывающая кавычка
+    int valueLength = 0;
+    Kind kind = Kind::Null;
+    bool keyEscaped = false;
+    bool valueEscaped = false;
+};
+
+namespace detail {
+
+inline int skipSpace(const char* s, int n, int i)
+{
+    while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) {
+        ++i;
+    }
+    return i;
+}
+
+// i — на открывающей кавычке; возвращает позицию после закрывающей или -1
+inline int skipString(const char* s, int n, int i, bool* escaped)
+{
+    int j = i + 1;
+    while (j < n) {
+        const char* quote = static_cast<const char*>(memchr(s + j, '"', size_t(n - j)));
+        if (!quote) {
+            return -1;
+        }
+        const int k = int(quote - s);
+
+        // Кавычка экранирована, если перед ней нечётное число обратных слэшей
+        int slashes = 0;
+        while (k - 1 - slashes > i && s[k - 1 - slashes] == '\\') {
+            ++slashes;
+        }
+        if (slashes % 2 == 0) {
+            if (escaped) {
+                *escaped = memchr(s + i + 1, '\\', size_t(k - i - 1)) != nullptr;
+            }
+            return k + 1;
+        }
+        j = k + 1;
+    }
+    return -1;
+}
+
+inline bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+inline bool matches(const char* s, int n, int i, const char* word, int length)
+{
+    return i + length <= n && std::memcmp(s + i, word, size_t(length)) == 0;
+}
+
+// Возвращает позицию после значения или -1
+inline int skipValue(const char* s, int n, int i, Kind* kind, bool* escaped)
+{
+    if (i >= n) {
+        return -1;
+    }
+
+    switch (s[i]) {
+    case '"':
+        *kind = Kind::String;
+        return skipString(s, n, i, escaped);
+
+    case '{':
+    case '[': {
+        *kind = s[i] == '{' ? Kind::Object : Kind::Array;
+        int depth = 0;
+        int j = i;
+        while (j < n) {
+            const char c = s[j];
+            if (c == '"') {
+                j = skipString(s, n, j, nullptr);
+                if (j < 0) {
+                    return -1;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            }
+            else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return j + 1;
+                }
+            }
+            ++j;
+        }
+        return -1;
+    }
+
+    case 't':
+        *kind = Kind::Bool;
+        return matches(s, n, i, "true", 4) ? i + 4 : -1;
+    case 'f':
+        *kind = Kind::Bool;
+        return matches(s, n, i, "false", 5) ? i + 5 : -1;
+    case 'n':
+        *kind = Kind::Null;
+        return matches(s, n, i, "null", 4) ? i + 4 : -1;
+
+    default: {
+        *kind = Kind::Number;
+        int j = i;
+        while (j < n && isNumberChar(s[j])) {
+            ++j;
+        }
+        return j > i ? j : -1;
+    }
+    }
+}
+
+}
+
+
+class Document {
+public:
+    // false — не объект или синтаксис верхнего уровня нарушен (тогда нужен полный разбор)
+    bool parse(const QByteArray& json)
+    {
+        using namespace detail;
+
+        data = json;
+        list.clear();
+        valid = false;
+
+        const char* s = data.constData();
+        const int n = int(data.size());
+
+        int i = skipSpace(s, n, 0);
+        if (i >= n || s[i] != '{') {
+            return false;
+        }
+
+        i = skipSpace(s, n, i + 1);
+        if (i < n && s[i] == '}') {
+            valid = skipSpace(s, n, i + 1) == n;
+            return valid;
+        }
+
+        while (i < n && s[i] == '"') {
+            Field f;
+            f.keyBegin = i + 1;
+            int end = skipString(s, n, i, &f.keyEscaped);
+            if (end < 0) {
+                return false;
+            }
+            f.keyLength = end - 1 - f.keyBegin;
+
+            i = skipSpace(s, n, end);
+            if (i >= n || s[i] != ':') {
+                return false;
+            }
+
+            f.valueBegin = skipSpace(s, n, i + 1);
+            end = skipValue(s, n, f.valueBegin, &f.kind, &f.valueEscaped);
+            if (end < 0) {
+                return false;
+            }
+            f.valueLength = end - f.valueBegin;
+            list.append(f);
+
+            i = skipSpace(s, n, end);
+            if (i < n && s[i] == ',') {
+                i = skipSpace(s, n, i + 1);
+                continue;
+            }
+            if (i < n && s[i] == '}') {
+                valid = skipSpace(s, n, i + 1) == n;
+                return valid;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    bool isValid() const { return valid; }
+    const QByteArray& bytes() const { return data; }
+    const QVector<Field>& fields() const { return list; }
+
+    QString key(const Field& f) const
+    {
+        if (!f.keyEscaped) {
+            return QString::fromUtf8(data.constData() + f.keyBegin, f.keyLength);
+        }
+        return slice(f.keyBegin - 1, f.keyLength + 2).toString();
+    }
+
+    bool keyIs(const Field& f, QLatin1String name) const
+    {
+        return !f.keyEscaped && f.keyLength == int(name.size())
+            && std::memcmp(data.constData() + f.keyBegin, name.data(), size_t(f.keyLength)) == 0;
+    }
+
+    bool keyEndsWith(const Field& f, QLatin1String suffix) const
+    {
+        const int length = int(suffix.size());
+        return !f.keyEscaped && f.keyLength >= length
+            && std::memcmp(data.constData() + f.keyBegin + f.keyLength - length, suffix.data(), size_t(length)) == 0;
+    }
+
+    const Field* find(QLatin1String name) const
+    {
+        for (const Field& f : list) {
+            if (keyIs(f, name)) {
+                return &f;
+            }
+        }
+        return nullptr;
+    }
+
+    double number(const Field& f, double defaultValue = 0) const
+    {
+        if (f.kind != Kind::Number) {
+            return defaultValue;
+        }
+        bool ok = false;
+        const double v = QByteArray::fromRawData(data.constData() + f.valueBegin, f.valueLength).toDouble(&ok);
+        return ok ? v : defaultValue;
+    }
+
+    double number(QLatin1String name, double defaultValue = 0) const
+    {
+        const Field* f = find(name);
+        return f ? number(*f, defaultValue) : defaultValue;
+    }
+
+    // Содержимое строки между кавычками как есть (без копирования); для строк
+    // с escape-последовательностями — декодированная копия
+    QByteArray stringBytes(const Field& f) const
+    {
+        if (f.kind != Kind::String) {
+            return QByteArray();
+        }
+        if (f.valueEscaped) {
+            return value(f).toString().toUtf8();
+        }
+        return QByteArray::fromRawData(data.constData() + f.valueBegin + 1, f.valueLength - 2);
+    }
+
+    // Полный разбор одного значения
+    QJsonValue value(const Field& f) const
+    {
+        switch (f.kind) {
+        case Kind::Number: return number(f);
+        case Kind::Bool:   return data.at(f.valueBegin) == 't';
+        case Kind::Null:   return QJsonValue();
+        case Kind::String:
+            if (!f.valueEscaped) {
+                return QString::fromUtf8(data.constData() + f.valueBegin + 1, f.valueLength - 2);
+            }
+            return slice(f.valueBegin, f.valueLength);
+        default:
+            return slice(f.valueBegin, f.valueLength);
+        }
+    }
+
+    // Есть ли поля "*_base64" (изображения, маски)
+    bool hasBase64() const
+    {
+        for (const Field& f : list) {
+            if (keyEndsWith(f, QLatin1String("_base64"))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Объект из полей верхнего уровня; withBase64 = false — без полей "*_base64" (изображений)
+    QJsonObject toObject(bool withBase64 = true) const
+    {
+        QJsonObject json;
+        for (const Field& f : list) {
+            if (!withBase64 && keyEndsWith(f, QLatin1String("_base64"))) {
+                continue;
+            }
+            json.insert(key(f), value(f));
+        }
+        return json;
+    }
+
+private:
+    QByteArray data;
+    QVector<Field> list;
+    bool valid = false;
+
+    // Значение вне объекта QJsonDocument не разбирает — оборачиваем в массив
+    QJsonValue slice(int begin, int length) const
+    {
+        QByteArray wrapped;
+        wrapped.reserve(length + 2);
+        wrapped.append('[').append(data.constData() + begin, length).append(']');
+        return QJsonDocument::fromJson(wrapped).array().at(0);
+    }
+};
+
+}
+
+#endif // RAWJSON_H
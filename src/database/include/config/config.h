@@ -3,18 +3,113 @@
 
 #include <QString>
 
+// Профиль производительности SQLite: PRAGMA, применяемые при подключении
+struct DbProfile {
+    QString name;
+    QString journalMode;        // WAL — читатели не блокируют писателя
+    QString synchronous;        // FULL / NORMAL / OFF
+    qint64 mmapSize;            // байт, 0 — без mmap
+    int cacheSizeKb;            // размер страничного кэша
+    QString tempStore;          // DEFAULT / FILE / MEMORY
+    int walAutocheckpoint;      // страниц WAL до автоматического checkpoint
+};
+
 namespace Config {
 // Имя подключения для SQLite
 const QString DB_CONNECTION_NAME = "agro_connection";
 
-// Путь к схеме БД
-const QString DB_SCHEMA_PATH = "D:/QtProjects/AgroDB/schema.sql";
-
 // Имя файла БД
 const QString DB_FILE_PATH = "D:/QtProjects/AgroDB/agro.db";
 
 // Тестовая база данных
 const QString DB_TEST_FILE_PATH = "D:/QtProjects/AgroDB/agro_test.db";
+
+// Профили производительности БД:
+//  durable      — WAL + fsync на каждую транзакцию, ничего не теряется при отключении питания;
+//  field-ingest — WAL + fsync только на checkpoint: быстрая запись на полевых ноутбуках,
+//                 при отключении питания могут пропасть последние транзакции (но не целостность);
+//  analytics    — крупный кэш и mmap для отчётов и выгрузок.
+const DbProfile DB_PROFILE_DURABLE      = {"durable",      "WAL", "FULL",   0,                   8 * 1024,   "DEFAULT", 1000};
+const DbProfile DB_PROFILE_FIELD_INGEST = {"field-ingest", "WAL", "NORMAL", 256LL * 1024 * 1024, 64 * 1024,  "MEMORY",  4000};
+const DbProfile DB_PROFILE_ANALYTICS    = {"analytics",    "WAL", "NORMAL", 1024LL * 1024 * 1024, 256 * 1024, "MEMORY",  1000};
+
+// Ожидание блокировки другим соединением, мс
+const int DB_BUSY_TIMEOUT_MS = 5000;
+
+// Пул соединений только для чтения: не больше стольких потоков-читателей одновременно
+const int DB_READER_POOL_SIZE = 8;
+const QString DB_READER_CONNECTION_PREFIX = "agro_reader_";
+
+// Очередь асинхронных запросов (AsyncDb)
+const int ASYNC_DB_QUEUE_SIZE = 256;
+
+// Файлы сессий (ShardedDb): каталог рядом с файлом основной БД и сколько сессий
+// подключать через ATTACH за раз (SQLite по умолчанию допускает не больше 10 подключённых БД)
+const QString SHARD_ROOT_DIR = DB_FILE_PATH.left(DB_FILE_PATH.lastIndexOf('/') + 1) + "sessions";
+const int SHARD_ATTACH_BATCH = 8;
+
+// Профиль по умолчанию
+const QString DB_PROFILE = "field-ingest";
+
+inline DbProfile dbProfile(const QString& name)
+{
+    if (name == DB_PROFILE_FIELD_INGEST.name) return DB_PROFILE_FIELD_INGEST;
+    if (name == DB_PROFILE_ANALYTICS.name)    return DB_PROFILE_ANALYTICS;
+    return DB_PROFILE_DURABLE;
+}
+
+// Журнал входящих сообщений (восстановление после падения)
+const QString JOURNAL_DIR = "D:/QtProjects/AgroDB/journal";
+
+// Размер одного сегмента журнала
+const qint64 JOURNAL_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+// Групповая фиксация: fsync после N записей или через T мс после первой незафиксированной
+const int JOURNAL_GROUP_COMMIT_RECORDS = 64;
+const int JOURNAL_GROUP_COMMIT_MS = 20;
+
+// Кэш ML результатов: предел памяти и сохранение в таблицу ML_cache
+const qint64 ML_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+const bool ML_CACHE_PERSIST = true;
+const int ML_CACHE_PRELOAD_ROWS = 10000;
+const int ML_PENDING_MAX = 1024;           // кадров, ждущих ответа ML; больше — сервис ответы теряет
+
+// Агрегаты сенсоров (Rollup_time / Rollup_cell): корзина времени и шаг сетки
+const qint64 ROLLUP_BUCKET_SEC = 60;
+const double ROLLUP_CELL_DEG = 0.0001;     // ≈ 11 м по широте
+
+// Хранилище блобов (<файл БД>.blobs): поля *_base64 не меньше порога уходят в файлы
+const bool BLOB_STORE_ENABLED = true;
+const int BLOB_MIN_BYTES = 1024;
+// Файл блоба без строки в Blobs (откат транзакции после записи файла) удаляется не раньше
+const int BLOB_ORPHAN_GRACE_SEC = 10 * 60;
+
+// Выгрузка сессии в Arrow: строк в одной пачке (RecordBatch)
+const int EXPORT_BATCH_ROWS = 65536;
+
+// Очистка по политикам хранения (RetentionEngine): шаги через TICK, циклы через IDLE.
+// Шаг держит блокировку записи не дольше бюджета: пачка строк подстраивается под него
+const int RETENTION_TICK_MS = 100;
+const int RETENTION_IDLE_MS = 10 * 60 * 1000;
+const int RETENTION_STEP_BUDGET_MS = 5;
+const int RETENTION_BATCH_ROWS = 128;          // начальный размер пачки
+const int RETENTION_GC_BATCH = 256;            // блобов без ссылок за шаг
+const int RETENTION_VACUUM_PAGES = 512;        // страниц incremental_vacuum за шаг
+
+// БД в памяти (MemoryDb): шаг сетки для pointsInRect и строк в пачке при снимке в SQLite
+const double MEMORY_DB_CELL_DEG = 0.001;       // ≈ 110 м по широте
+const int MEMORY_DB_SNAPSHOT_BATCH = 10000;
+
+// Двоичные кадры сенсоров: предел числа каналов в описании кадра
+const int FRAME_MAX_CHANNELS = 1024;
+
+// Миниатюры изображений (ThumbnailPipeline): размеры по длинной стороне по возрастанию,
+// потоки декодирования, шаг по таймеру и блобов за один просмотр старых данных
+const int THUMBNAIL_SIZES[] = {64, 256, 1024};
+const int THUMBNAIL_WORKERS = 2;
+const int THUMBNAIL_TICK_MS = 200;
+const int THUMBNAIL_SCAN_BATCH = 64;
+const int THUMBNAIL_JPEG_QUALITY = 85;
 }
 
 
@@ -1,8 +1,11 @@
 #ifndef DBINTERFACE_H
 #define DBINTERFACE_H
 
+#include "dbrows.h"
 #include "statuscodes.h"
+#include "rawjson.h"
 
+#include <QJsonObject>
 #include <QString>
 #include <QVariant>
 #include <QVector>
@@ -24,6 +27,44 @@ public:
 
     // Отключиться от базы
     virtual void disconnect() = 0;
+
+    // Добавление данных; insertedId (если передан) получает id новой строки
+    virtual StatusCode addSession(const QString& description, int* insertedId = nullptr) = 0;
+    virtual StatusCode addField(const QString& name, const QJsonObject& boundary, int sessionId, int* insertedId = nullptr) = 0;
+    // Одинаковая спецификация хранится один раз: повторная отдаёт id уже записанной
+    virtual StatusCode addSensorSpec(const QJsonObject& spec, int* insertedId = nullptr) = 0;
+    // specId — id из addSensorSpec (-1 — спецификация неизвестна).
+    // journalSeq — номер записи журнала сообщений (0 — не из журнала). Точка с уже записанным
+    // номером не вставляется повторно: JOURNAL_ALREADY_APPLIED, insertedId — id существующей
+    virtual StatusCode addPoint(int fieldId, int sessionId, double latitude, double longitude,
+                                const QJsonObject& data, int specId = -1, int* insertedId = nullptr,
+                                quint64 journalSeq = 0) = 0;
+    // Точка из исходных байт сообщения: data_json пишется без разбора и повторной сериализации
+    virtual StatusCode addPointRaw(int fieldId, int sessionId, double latitude, double longitude,
+                                   const RawJson::Document& data, int specId = -1, int* insertedId = nullptr,
+                                   quint64 journalSeq = 0) = 0;
+    virtual StatusCode addObservation(int pointId, int* insertedId = nullptr) = 0;
+    virtual StatusCode addMLResult(int observationId, const QString& moduleName, const QJsonObject& result,
+                                   int* insertedId = nullptr) = 0;
+    virtual StatusCode addRecommendation(int observationId, const QString& text, int* insertedId = nullptr) = 0;
+
+    // Пакетная вставка
+    virtual BulkResult addPoints(const QVector<PointRow>& rows) = 0;
+    virtual BulkResult addObservations(const QVector<int>& pointIds) = 0;
+    virtual BulkResult addMLResults(const QVector<MLResultRow>& rows) = 0;
+
+    // Точки сессии в прямоугольнике (limit < 0 — без ограничения) — запрос карты
+    virtual StatusCode pointsInRect(int sessionId, const GeoRect& rect, QVector<PointRecord>& out, int limit = -1) = 0;
+
+    // Журнал сообщений: запись отмечается применённой сразу после вставки, поэтому
+    // фиксация в БД должна доходить до диска раньше отметки
+    virtual StatusCode requireDurableCommits() = 0;
+    // Наибольший journalSeq среди точек (0 — таких нет)
+    virtual StatusCode lastJournalSeq(quint64& seq) = 0;
+
+    // Кэш ML результатов
+    virtual StatusCode addMLCacheEntry(const QString& contentHash, const QString& moduleName, const QJsonObject& result) = 0;
+    virtual QVector<MLCacheRow> loadMLCache(int limit) = 0;
 };
 
 #endif // DBINTERFACE_H
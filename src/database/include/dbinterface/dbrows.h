@@ -0,0 +1,85 @@
+#ifndef DBROWS_H
+#define DBROWS_H
+
+#include "statuscodes.h"
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+// Строки таблиц для пакетной вставки и выборок
+
+struct PointRow {
+    int fieldId = 1;
+    int sessionId = 1;
+    int specId = -1;          // спецификация, по которой записана точка; -1 — неизвестна
+    double latitude = 0;
+    double longitude = 0;
+    QJsonObject data;
+};
+
+// Точка, прочитанная из БД; data_json не разбирается — это делает тот, кому он нужен
+struct PointRecord {
+    int id = -1;
+    int sessionId = -1;
+    double latitude = 0;
+    double longitude = 0;
+    QByteArray dataJson;
+};
+
+// Прямоугольник в географических координатах (градусы)
+struct GeoRect {
+    double latMin = 0;
+    double latMax = 0;
+    double lonMin = 0;
+    double lonMax = 0;
+};
+
+// Агрегаты по полю сенсора
+struct SensorAggregate {
+    qint64 count = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double variance = 0;   // дисперсия генеральной совокупности
+};
+
+// Одна корзина агрегатов: по времени (bucketStart) или по ячейке сетки (cellX, cellY)
+struct RollupBucket {
+    qint64 bucketStart = 0;   // начало корзины, секунды UTC
+    qint64 cellX = 0;         // floor(долгота / Config::ROLLUP_CELL_DEG)
+    qint64 cellY = 0;         // floor(широта / Config::ROLLUP_CELL_DEG)
+    SensorAggregate aggregate;
+};
+
+struct MLResultRow {
+    int observationId = -1;
+    QString moduleName;
+    QJsonObject result;
+};
+
+// Строка кэша ML результатов
+struct MLCacheRow {
+    QString contentHash;
+    QString moduleName;
+    QJsonObject result;
+};
+
+// Миниатюра изображения из хранилища блобов (таблица Thumbnails)
+struct ThumbnailRow {
+    int size = 0;             // длинная сторона, пикселей (Config::THUMBNAIL_SIZES)
+    QString hash;             // блоб с байтами миниатюры
+    int width = 0;
+    int height = 0;
+};
+
+// Итог пакетной вставки: статус и id для каждой строки в порядке входа
+struct BulkResult {
+    StatusCode code = StatusCode::SUCCESS;   // SUCCESS — вставлены все строки
+    QVector<StatusCode> rowStatus;
+    QVector<int> ids;                        // -1 для не вставленных строк
+    int inserted = 0;
+};
+
+#endif // DBROWS_H
@@ -8,17 +8,64 @@ namespace LogMsg {
 const QString DB_CONNECTED       = "Подключение к базе данных успешно.";
 const QString DB_CONNECT_FAILED  = "Ошибка подключения к базе данных.";
 const QString DB_DISCONNECTED    = "Соединение с базой данных закрыто.";
+const QString DB_PROFILE_APPLIED = "Профиль производительности БД:";
+const QString DB_PRAGMA_FAILED   = "Не удалось применить PRAGMA:";
+
+const QString DB_READER_OPENED   = "Открыто соединение только для чтения:";
+const QString DB_READER_POOL_EXHAUSTED = "Пул соединений для чтения исчерпан, потоков:";
+const QString DB_READER_NO_FILE  = "Соединения для чтения требуют БД в файле, а не :memory:";
 
 // Инициализация
 const QString DB_INIT_SUCCESS    = "Инициализация БД выполнена успешно.";
 const QString DB_INIT_FAILED     = "Не удалось инициализировать базу данных.";
+const QString DB_MIGRATED        = "Схема БД обновлена, версия:";
+const QString DB_MIGRATION_FAILED = "Ошибка шага миграции схемы БД:";
 
 // SQL
 const QString DB_QUERY_FAILED    = "Ошибка выполнения SQL-запроса.";
 const QString DB_TABLE_CREATE_FAILED = "Ошибка создания таблицы.";
+const QString DB_UNKNOWN_SENSOR_FIELD = "Поле сенсора не вынесено в колонку:";
+const QString DB_SENSOR_FIELD_ADDED  = "Поле сенсора вынесено в индексируемую колонку:";
+const QString DB_BAD_SENSOR_FIELD    = "Недопустимое имя поля сенсора:";
+const QString DB_QUERY_CANCELLED = "Запрос отменён.";
+const QString DB_QUEUE_FULL      = "Очередь асинхронных запросов заполнена:";
+const QString DB_SESSION_NOT_FOUND = "Сессия не найдена или в архиве:";
+const QString DB_SESSION_CREATED = "Создан файл сессии:";
+const QString DB_SESSION_ARCHIVED = "Сессия перенесена в архив:";
+const QString DB_RETENTION_BAD_POLICY = "Неверная политика хранения (таблица, действие):";
+const QString DB_RETENTION_CYCLE = "Очистка по политикам хранения (строк, страниц освобождено):";
+const QString DB_AUTOVACUUM_OFF = "auto_vacuum не INCREMENTAL, место в файле не возвращается:";
+const QString DB_MEMORY_SQL_UNSUPPORTED = "MemoryDb не выполняет SQL:";
+const QString DB_MEMORY_BAD_REFERENCE = "Ссылка на несуществующую строку (таблица, id):";
+const QString DB_MEMORY_SNAPSHOT = "Снимок MemoryDb записан в SQLite (соединение, точек):";
+const QString DB_RTREE_UNAVAILABLE = "Модуль R*Tree недоступен, пространственный индекс не создан:";
 
 // Файлы
 const QString FILE_NOT_FOUND     = "Файл не найден.";
+const QString FILE_MOVE_FAILED   = "Не удалось переместить файл:";
+
+// Журнал
+const QString JOURNAL_OPEN_FAILED  = "Не удалось открыть журнал сообщений.";
+const QString JOURNAL_WRITE_FAILED = "Ошибка записи в журнал сообщений.";
+const QString JOURNAL_ALREADY_APPLIED = "Сообщение журнала уже записано в БД, повтор пропущен:";
+
+// Хранилище блобов
+const QString BLOB_WRITE_FAILED  = "Не удалось сохранить блоб:";
+const QString BLOB_NOT_FOUND     = "Блоб не найден:";
+const QString BLOB_STORE_OPENED  = "Хранилище блобов:";
+const QString BLOB_GARBAGE_COLLECTED = "Удалено блобов без ссылок:";
+const QString BLOB_ORPHANS_REMOVED = "Удалены файлы блобов без строки в Blobs (каталог, файлов):";
+const QString THUMBNAIL_STORED   = "Миниатюры сохранены (блоб, размеров):";
+const QString THUMBNAIL_NOT_IMAGE = "Блоб не является изображением:";
+
+// Выгрузка сессий
+const QString EXPORT_FAILED      = "Ошибка выгрузки сессии:";
+const QString EXPORT_FINISHED    = "Сессия выгружена (сессия, строк, каталог):";
+
+// Двоичные кадры сенсоров
+const QString DECODER_BAD_SPEC   = "Неверное описание двоичного кадра в спецификации:";
+const QString DECODER_BAD_FRAME  = "Кадр не совпадает с описанием (спецификация, длина):";
+const QString DECODER_PLAN_COMPILED = "План разбора кадра собран (спецификация, каналов, байт):";
 
 // Общее
 const QString UNKNOWN_ERROR      = "Неизвестная ошибка.";
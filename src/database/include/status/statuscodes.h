@@ -11,9 +11,30 @@ enum class StatusCode {
     // Ошибки SQL
     DB_QUERY_FAILED = 1101,
     DB_TABLE_CREATE_FAILED = 1102,
+    DB_UNKNOWN_SENSOR_FIELD = 1103,
+    DB_QUERY_CANCELLED = 1104,
+    DB_QUEUE_FULL = 1105,
+    DB_SESSION_NOT_FOUND = 1106,
 
     // Ошибки файлов
     FILE_NOT_FOUND = 1201,
+    FILE_MOVE_FAILED = 1202,
+
+    // Ошибки журнала
+    JOURNAL_OPEN_FAILED = 1301,
+    JOURNAL_WRITE_FAILED = 1302,
+    JOURNAL_ALREADY_APPLIED = 1303,
+
+    // Ошибки хранилища блобов
+    BLOB_WRITE_FAILED = 1401,
+    BLOB_NOT_FOUND = 1402,
+
+    // Ошибки выгрузки
+    EXPORT_FAILED = 1501,
+
+    // Ошибки разбора двоичных кадров
+    DECODER_BAD_SPEC = 1601,
+    DECODER_BAD_FRAME = 1602,
 
     // Неизвестная ошибка
     UNKNOWN_ERROR = 1999
@@ -12,7 +12,20 @@ inline QString statusToMessage(StatusCode code) {
     case StatusCode::DB_INIT_FAILED:         return DB_INIT_FAILED;
     case StatusCode::DB_QUERY_FAILED:        return DB_QUERY_FAILED;
     case StatusCode::DB_TABLE_CREATE_FAILED: return DB_TABLE_CREATE_FAILED;
+    case StatusCode::DB_UNKNOWN_SENSOR_FIELD: return DB_UNKNOWN_SENSOR_FIELD;
+    case StatusCode::DB_QUERY_CANCELLED:     return DB_QUERY_CANCELLED;
+    case StatusCode::DB_QUEUE_FULL:          return DB_QUEUE_FULL;
+    case StatusCode::DB_SESSION_NOT_FOUND:   return DB_SESSION_NOT_FOUND;
     case StatusCode::FILE_NOT_FOUND:         return FILE_NOT_FOUND;
+    case StatusCode::FILE_MOVE_FAILED:       return FILE_MOVE_FAILED;
+    case StatusCode::JOURNAL_OPEN_FAILED:    return JOURNAL_OPEN_FAILED;
+    case StatusCode::JOURNAL_WRITE_FAILED:   return JOURNAL_WRITE_FAILED;
+    case StatusCode::JOURNAL_ALREADY_APPLIED: return JOURNAL_ALREADY_APPLIED;
+    case StatusCode::BLOB_WRITE_FAILED:      return BLOB_WRITE_FAILED;
+    case StatusCode::BLOB_NOT_FOUND:         return BLOB_NOT_FOUND;
+    case StatusCode::EXPORT_FAILED:          return EXPORT_FAILED;
+    case StatusCode::DECODER_BAD_SPEC:       return DECODER_BAD_SPEC;
+    case StatusCode::DECODER_BAD_FRAME:      return DECODER_BAD_FRAME;
     case StatusCode::SUCCESS:                return "Операция успешно выполнена.";
     default:                                 return UNKNOWN_ERROR;
     }
@@ -0,0 +1,109 @@
+#ifndef COLUMNARENA_H
+#define COLUMNARENA_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Столбец только для добавления: значения лежат в блоках по ChunkSize штук.
+// Блок выделяется один раз и не перевыделяется — рост не копирует уже записанное,
+// а ссылки на элементы остаются действительными до clear().
+template <typename T, int ChunkSize = 16384>
+class AppendColumn {
+public:
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+    void append(const T& value)
+    {
+        if (count % ChunkSize == 0) {
+            chunks.push_back(std::make_unique<T[]>(ChunkSize));
+        }
+        chunks.back()[count % ChunkSize] = value;
+        ++count;
+    }
+
+    const T& operator[](int i) const { return chunks[i / ChunkSize][i % ChunkSize]; }
+
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+
+    qint64 bytesReserved() const { return qint64(chunks.size()) * ChunkSize * sizeof(T); }
+
+private:
+    std::vector<std::unique_ptr<T[]>> chunks;
+    int count = 0;
+};
+
+
+// Байты переменной длины (JSON, тексты) подряд в больших блоках.
+// Запись возвращает ссылку {блок, смещение, длина}; чтение без копирования — view().
+// Значение больше блока получает собственный блок.
+class ByteArena {
+public:
+    struct Ref {
+        int block = -1;
+        int offset = 0;
+        int length = 0;
+    };
+
+    static constexpr int BLOCK_SIZE = 1 << 20;
+
+    Ref append(const QByteArray& bytes)
+    {
+        const int length = int(bytes.size());
+
+        if (blocks.empty() || used + length > blockCapacity) {
+            blockCapacity = std::max(BLOCK_SIZE, length);
+            blocks.push_back(std::make_unique<char[]>(blockCapacity));
+            used = 0;
+            reserved += blockCapacity;
+        }
+
+        Ref ref{int(blocks.size()) - 1, used, length};
+        memcpy(blocks.back().get() + used, bytes.constData(), length);
+        used += length;
+        return ref;
+    }
+
+    // Представление поверх памяти арены: действительно, пока арена не очищена
+    QByteArray view(const Ref& ref) const
+    {
+        if (ref.block < 0) {
+            return QByteArray();
+        }
+        return QByteArray::fromRawData(blocks[ref.block].get() + ref.offset, ref.length);
+    }
+
+    // Собственная копия — для данных, которые уходят наружу
+    QByteArray copy(const Ref& ref) const
+    {
+        const QByteArray bytes = view(ref);
+        return QByteArray(bytes.constData(), bytes.size());
+    }
+
+    void clear()
+    {
+        blocks.clear();
+        used = 0;
+        blockCapacity = 0;
+        reserved = 0;
+    }
+
+    qint64 bytesReserved() const { return reserved; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    int used = 0;
+    int blockCapacity = 0;
+    qint64 reserved = 0;
+};
+
+#endif // COLUMNARENA_H
@@ -0,0 +1,598 @@
+#include "memorydb.h"
+#include "logmessages.h"
+#include "sqlitedb.h"
+#include "statusmapper.h"
+
+#include <QJsonDocument>
+#include <QSqlDatabase>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+MemoryDb::~MemoryDb()
+{
+    disconnect();
+}
+
+
+StatusCode MemoryDb::connect(const QString& connectionInfo)
+{
+    clear();
+    snapshotPath = connectionInfo == ":memory:" ? QString() : connectionInfo;
+    return StatusCode::SUCCESS;
+}
+
+
+SQLResult MemoryDb::executeSQL(const QString& query)
+{
+    qWarning() << LogMsg::DB_MEMORY_SQL_UNSUPPORTED << query;
+    return {StatusCode::DB_QUERY_FAILED, QVariant()};
+}
+
+
+void MemoryDb::disconnect()
+{
+    if (!snapshotPath.isEmpty()) {
+        SQLiteDb target("agro_memory_snapshot");
+        if (target.connect(snapshotPath) == StatusCode::SUCCESS) {
+            snapshotTo(target);
+            target.disconnect();
+        }
+        snapshotPath.clear();
+    }
+    clear();
+}
+
+
+void MemoryDb::clear()
+{
+    sessions.clear();
+    fields.clear();
+    specs.clear();
+    specIds.clear();
+    points = PointTable();
+    observations = ObservationTable();
+    mlResults = MLResultTable();
+    recommendations = RecommendationTable();
+    arena.clear();
+    moduleNames.clear();
+    moduleIds.clear();
+    spatialIndex.clear();
+    journalPoints.clear();
+    mlCache.clear();
+    mlCacheIndex.clear();
+    mlCacheSeq = 0;
+}
+
+
+qint64 MemoryDb::bytesReserved() const
+{
+    return points.fieldId.bytesReserved() + points.sessionId.bytesReserved() + points.specId.bytesReserved()
+         + points.latitude.bytesReserved() + points.longitude.bytesReserved() + points.data.bytesReserved()
+         + observations.pointId.bytesReserved()
+         + mlResults.observationId.bytesReserved() + mlResults.module.bytesReserved()
+         + mlResults.result.bytesReserved()
+         + recommendations.observationId.bytesReserved() + recommendations.text.bytesReserved()
+         + arena.bytesReserved();
+}
+
+
+ByteArena::Ref MemoryDb::store(const QJsonObject& json)
+{
+    return arena.append(QJsonDocument(json).toJson(QJsonDocument::Compact));
+}
+
+
+QJsonObject MemoryDb::load(const ByteArena::Ref& ref) const
+{
+    return QJsonDocument::fromJson(arena.view(ref)).object();
+}
+
+
+int MemoryDb::moduleId(const QString& name)
+{
+    auto it = moduleIds.constFind(name);
+    if (it != moduleIds.constEnd()) {
+        return it.value();
+    }
+    moduleNames.append(name);
+    return moduleIds.insert(name, int(moduleNames.size()) - 1).value();
+}
+
+
+qint64 MemoryDb::cellCoord(double degrees)
+{
+    return qint64(std::floor(degrees / Config::MEMORY_DB_CELL_DEG));
+}
+
+
+qint64 MemoryDb::cellOf(double latitude, double longitude)
+{
+    return cellKey(cellCoord(latitude), cellCoord(longitude));
+}
+
+
+// Сдвиг в беззнаковом типе: сдвиг влево отрицательного qint64 в C++17 — неопределённое поведение
+qint64 MemoryDb::cellKey(qint64 y, qint64 x)
+{
+    return qint64((quint64(y) << 32) | (quint64(x) & 0xFFFFFFFFull));
+}
+
+// -------------------- Добавление --------------------
+
+StatusCode MemoryDb::addSession(const QString& description, int* insertedId)
+{
+    sessions.append({description});
+    if (insertedId) {
+        *insertedId = int(sessions.size());
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::addField(const QString& name, const QJsonObject& boundary, int sessionId, int* insertedId)
+{
+    fields.append({name, boundary, sessionId});
+    if (insertedId) {
+        *insertedId = int(fields.size());
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::addSensorSpec(const QJsonObject& spec, int* insertedId)
+{
+    const QString hash = SQLiteDb::specHash(spec);
+    auto it = specIds.constFind(hash);
+    if (it == specIds.constEnd()) {
+        specs.append(QJsonDocument(spec).toJson(QJsonDocument::Compact));
+        it = specIds.insert(hash, int(specs.size()));
+    }
+    if (insertedId) {
+        *insertedId = it.value();
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::insertPoint(int fieldId, int sessionId, double latitude, double longitude,
+                                 const ByteArena::Ref& data, int specId, int* insertedId)
+{
+    const int row = points.latitude.size();
+
+    points.fieldId.append(fieldId);
+    points.sessionId.append(sessionId);
+    points.specId.append(specId);
+    points.latitude.append(latitude);
+    points.longitude.append(longitude);
+    points.data.append(data);
+
+    spatialIndex[sessionId][cellOf(latitude, longitude)].push_back(row);
+
+    if (insertedId) {
+        *insertedId = row + 1;
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::insertObservation(int pointId, int* insertedId)
+{
+    if (pointId < 1 || pointId > points.latitude.size()) {
+        qWarning() << LogMsg::DB_MEMORY_BAD_REFERENCE << "Points" << pointId;
+        if (insertedId) {
+            *insertedId = -1;
+        }
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    observations.pointId.append(pointId);
+    if (insertedId) {
+        *insertedId = observations.pointId.size();
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::insertMLResult(int observationId, const QString& moduleName, const QJsonObject& result,
+                                    int* insertedId)
+{
+    if (observationId < 1 || observationId > observations.pointId.size()) {
+        qWarning() << LogMsg::DB_MEMORY_BAD_REFERENCE << "Observations" << observationId;
+        if (insertedId) {
+            *insertedId = -1;
+        }
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    mlResults.observationId.append(observationId);
+    mlResults.module.append(moduleId(moduleName));
+    mlResults.result.append(store(result));
+    if (insertedId) {
+        *insertedId = mlResults.observationId.size();
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::addPoint(int fieldId, int sessionId, double latitude, double longitude,
+                              const QJsonObject& data, int specId, int* insertedId, quint64 journalSeq)
+{
+    if (isJournalRepeat(journalSeq, insertedId)) {
+        return StatusCode::JOURNAL_ALREADY_APPLIED;
+    }
+    const StatusCode st = insertPoint(fieldId, sessionId, latitude, longitude, store(data), specId, insertedId);
+    if (st == StatusCode::SUCCESS && journalSeq > 0) {
+        journalPoints.insert(journalSeq, points.latitude.size());
+    }
+    return st;
+}
+
+
+// Байты сообщения ложатся в арену как есть
+StatusCode MemoryDb::addPointRaw(int fieldId, int sessionId, double latitude, double longitude,
+                                 const RawJson::Document& data, int specId, int* insertedId,
+                                 quint64 journalSeq)
+{
+    if (isJournalRepeat(journalSeq, insertedId)) {
+        return StatusCode::JOURNAL_ALREADY_APPLIED;
+    }
+    const StatusCode st = insertPoint(fieldId, sessionId, latitude, longitude, arena.append(data.bytes()),
+                                      specId, insertedId);
+    if (st == StatusCode::SUCCESS && journalSeq > 0) {
+        journalPoints.insert(journalSeq, points.latitude.size());
+    }
+    return st;
+}
+
+
+bool MemoryDb::isJournalRepeat(quint64 journalSeq, int* insertedId) const
+{
+    auto it = journalPoints.constFind(journalSeq);
+    if (journalSeq == 0 || it == journalPoints.constEnd()) {
+        return false;
+    }
+    if (insertedId) {
+        *insertedId = it.value();
+    }
+    return true;
+}
+
+
+StatusCode MemoryDb::lastJournalSeq(quint64& seq)
+{
+    seq = 0;
+    for (auto it = journalPoints.constBegin(); it != journalPoints.constEnd(); ++it) {
+        seq = std::max(seq, it.key());
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode MemoryDb::addObservation(int pointId, int* insertedId)
+{
+    return insertObservation(pointId, insertedId);
+}
+
+
+StatusCode MemoryDb::addMLResult(int observationId, const QString& moduleName, const QJsonObject& result,
+                                 int* insertedId)
+{
+    return insertMLResult(observationId, moduleName, result, insertedId);
+}
+
+
+StatusCode MemoryDb::addRecommendation(int observationId, const QString& text, int* insertedId)
+{
+    if (observationId < 1 || observationId > observations.pointId.size()) {
+        qWarning() << LogMsg::DB_MEMORY_BAD_REFERENCE << "Observations" << observationId;
+        if (insertedId) {
+            *insertedId = -1;
+        }
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    recommendations.observationId.append(observationId);
+    recommendations.text.append(arena.append(text.toUtf8()));
+    if (insertedId) {
+        *insertedId = recommendations.observationId.size();
+    }
+    return StatusCode::SUCCESS;
+}
+
+// -------------------- Пакетная вставка --------------------
+
+namespace {
+template <typename Row, typename Insert>
+BulkResult bulk(const QVector<Row>& rows, Insert insert)
+{
+    BulkResult result;
+    result.rowStatus.fill(StatusCode::DB_QUERY_FAILED, rows.size());
+    result.ids.fill(-1, rows.size());
+
+    for (int i = 0; i < rows.size(); ++i) {
+        result.rowStatus[i] = insert(rows[i], &result.ids[i]);
+        if (result.rowStatus[i] == StatusCode::SUCCESS) {
+            ++result.inserted;
+        }
+    }
+
+    if (result.inserted != rows.size()) {
+        result.code = StatusCode::DB_QUERY_FAILED;
+    }
+    return result;
+}
+}
+
+
+BulkResult MemoryDb::addPoints(const QVector<PointRow>& rows)
+{
+    return bulk(rows, [this](const PointRow& row, int* id) {
+        return insertPoint(row.fieldId, row.sessionId, row.latitude, row.longitude, store(row.data), row.specId, id);
+    });
+}
+
+
+BulkResult MemoryDb::addObservations(const QVector<int>& pointIds)
+{
+    return bulk(pointIds, [this](int pointId, int* id) {
+        return insertObservation(pointId, id);
+    });
+}
+
+
+BulkResult MemoryDb::addMLResults(const QVector<MLResultRow>& rows)
+{
+    return bulk(rows, [this](const MLResultRow& row, int* id) {
+        return insertMLResult(row.observationId, row.moduleName, row.result, id);
+    });
+}
+
+// -------------------- Запросы --------------------
+
+StatusCode MemoryDb::pointsInRect(int sessionId, const GeoRect& rect, QVector<PointRecord>& out, int limit)
+{
+    out.clear();
+
+    auto session = spatialIndex.find(sessionId);
+    if (session == spatialIndex.end() || limit == 0) {
+        return StatusCode::SUCCESS;
+    }
+    const CellIndex& cells = session->second;
+
+    const qint64 yMin = cellCoord(rect.latMin);
+    const qint64 yMax = cellCoord(rect.latMax);
+    const qint64 xMin = cellCoord(rect.lonMin);
+    const qint64 xMax = cellCoord(rect.lonMax);
+
+    auto visitCell = [&](const std::vector<int>& rows) {
+        for (int row : rows) {
+            const double lat = points.latitude[row];
+            const double lon = points.longitude[row];
+            if (lat < rect.latMin || lat > rect.latMax || lon < rect.lonMin || lon > rect.lonMax) {
+                continue;
+            }
+
+            PointRecord rec;
+            rec.id = row + 1;
+            rec.sessionId = sessionId;
+            rec.latitude = lat;
+            rec.longitude = lon;
+            rec.dataJson = arena.copy(points.data[row]);
+            out.append(rec);
+
+            if (limit > 0 && out.size() >= limit) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Прямоугольник крупнее занятой части сетки — дешевле пройти по непустым ячейкам
+    const double rectCells = double(yMax - yMin + 1) * double(xMax - xMin + 1);
+    if (rectCells > double(cells.size())) {
+        for (const auto& cell : cells) {
+            const qint64 y = qint64(qint32(quint64(cell.first) >> 32));
+            const qint64 x = qint64(qint32(quint64(cell.first) & 0xFFFFFFFFull));
+            if (y < yMin || y > yMax || x < xMin || x > xMax) {
+                continue;
+            }
+            if (!visitCell(cell.second)) {
+                break;
+            }
+        }
+        return StatusCode::SUCCESS;
+    }
+
+    for (qint64 y = yMin; y <= yMax; ++y) {
+        for (qint64 x = xMin; x <= xMax; ++x) {
+            auto it = cells.find(cellKey(y, x));
+            if (it != cells.end() && !visitCell(it->second)) {
+                return StatusCode::SUCCESS;
+            }
+        }
+    }
+    return StatusCode::SUCCESS;
+}
+
+// -------------------- Кэш ML результатов --------------------
+
+StatusCode MemoryDb::addMLCacheEntry(const QString& contentHash, const QString& moduleName, const QJsonObject& result)
+{
+    // Как INSERT OR REPLACE: повторная запись обновляет результат и делает его самым новым
+    const QPair<QString, QString> key(contentHash, moduleName);
+    auto it = mlCacheIndex.constFind(key);
+    if (it != mlCacheIndex.constEnd()) {
+        CacheEntry& entry = mlCache[it.value()];
+        entry.result = store(result);
+        entry.seq = ++mlCacheSeq;
+        return StatusCode::SUCCESS;
+    }
+
+    mlCacheIndex.insert(key, int(mlCache.size()));
+    mlCache.append({contentHash, moduleName, store(result), ++mlCacheSeq});
+    return StatusCode::SUCCESS;
+}
+
+
+QVector<MLCacheRow> MemoryDb::loadMLCache(int limit)
+{
+    return cacheRows(limit);
+}
+
+
+QVector<MLCacheRow> MemoryDb::cacheRows(int limit) const
+{
+    QVector<const CacheEntry*> entries;
+    entries.reserve(mlCache.size());
+    for (const CacheEntry& entry : mlCache) {
+        entries.append(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry* a, const CacheEntry* b) {
+        return a->seq > b->seq;
+    });
+
+    QVector<MLCacheRow> rows;
+    for (const CacheEntry* entry : std::as_const(entries)) {
+        if (limit >= 0 && rows.size() >= limit) {
+            break;
+        }
+        rows.append({entry->contentHash, entry->moduleName, load(entry->result)});
+    }
+    return rows;
+}
+
+// -------------------- Снимок в SQLite --------------------
+
+StatusCode MemoryDb::snapshotTo(SQLiteDb& target) const
+{
+    QSqlDatabase conn = QSqlDatabase::database(target.connectionName(), false);
+    if (!conn.transaction()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << target.connectionName();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    auto fail = [&conn](StatusCode st) {
+        conn.rollback();
+        qWarning() << statusToMessage(st);
+        return st;
+    };
+
+    // Старые id (номер строки + 1) → новые id в target
+    QVector<int> sessionIds(sessions.size() + 1, -1);
+    QVector<int> fieldIds(fields.size() + 1, -1);
+    QVector<int> specIdMap(specs.size() + 1, -1);
+    QVector<int> pointIds(points.latitude.size() + 1, -1);
+    QVector<int> observationIds(observations.pointId.size() + 1, -1);
+
+    for (int i = 0; i < sessions.size(); ++i) {
+        StatusCode st = target.addSession(sessions[i].description, &sessionIds[i + 1]);
+        if (st != StatusCode::SUCCESS) {
+            return fail(st);
+        }
+    }
+
+    // Точки могут ссылаться на сессию или поле, которых нет в MemoryDb (Manager пишет в 1/1) —
+    // такие id остаются как есть
+    auto remap = [](const QVector<int>& ids, int id) {
+        return id > 0 && id < ids.size() && ids[id] > 0 ? ids[id] : id;
+    };
+
+    for (int i = 0; i < fields.size(); ++i) {
+        StatusCode st = target.addField(fields[i].name, fields[i].boundary,
+                                        remap(sessionIds, fields[i].sessionId), &fieldIds[i + 1]);
+        if (st != StatusCode::SUCCESS) {
+            return fail(st);
+        }
+    }
+
+    // В target такая спецификация может уже быть — тогда точки получат её id
+    for (int i = 0; i < specs.size(); ++i) {
+        StatusCode st = target.addSensorSpec(QJsonDocument::fromJson(specs[i]).object(), &specIdMap[i + 1]);
+        if (st != StatusCode::SUCCESS) {
+            return fail(st);
+        }
+    }
+
+    const int batch = Config::MEMORY_DB_SNAPSHOT_BATCH;
+
+    for (int from = 0; from < points.latitude.size(); from += batch) {
+        const int to = std::min(points.latitude.size(), from + batch);
+
+        QVector<PointRow> rows;
+        rows.reserve(to - from);
+        for (int i = from; i < to; ++i) {
+            PointRow row;
+            row.fieldId = remap(fieldIds, points.fieldId[i]);
+            row.sessionId = remap(sessionIds, points.sessionId[i]);
+            row.specId = points.specId[i] > 0 ? remap(specIdMap, points.specId[i]) : -1;
+            row.latitude = points.latitude[i];
+            row.longitude = points.longitude[i];
+            row.data = load(points.data[i]);
+            rows.append(row);
+        }
+
+        const BulkResult result = target.addPoints(rows);
+        if (result.code != StatusCode::SUCCESS) {
+            return fail(result.code);
+        }
+        std::copy(result.ids.cbegin(), result.ids.cend(), pointIds.begin() + from + 1);
+    }
+
+    for (int from = 0; from < observations.pointId.size(); from += batch) {
+        const int to = std::min(observations.pointId.size(), from + batch);
+
+        QVector<int> rows;
+        rows.reserve(to - from);
+        for (int i = from; i < to; ++i) {
+            rows.append(pointIds[observations.pointId[i]]);
+        }
+
+        const BulkResult result = target.addObservations(rows);
+        if (result.code != StatusCode::SUCCESS) {
+            return fail(result.code);
+        }
+        std::copy(result.ids.cbegin(), result.ids.cend(), observationIds.begin() + from + 1);
+    }
+
+    for (int from = 0; from < mlResults.observationId.size(); from += batch) {
+        const int to = std::min(mlResults.observationId.size(), from + batch);
+
+        QVector<MLResultRow> rows;
+        rows.reserve(to - from);
+        for (int i = from; i < to; ++i) {
+            rows.append({observationIds[mlResults.observationId[i]], moduleNames[mlResults.module[i]],
+                         load(mlResults.result[i])});
+        }
+
+        const BulkResult result = target.addMLResults(rows);
+        if (result.code != StatusCode::SUCCESS) {
+            return fail(result.code);
+        }
+    }
+
+    for (int i = 0; i < recommendations.observationId.size(); ++i) {
+        StatusCode st = target.addRecommendation(observationIds[recommendations.observationId[i]],
+                                                 QString::fromUtf8(arena.view(recommendations.text[i])));
+        if (st != StatusCode::SUCCESS) {
+            return fail(st);
+        }
+    }
+
+    // Кэш — от старых записей к новым, чтобы порядок created_at совпал с порядком записи
+    const QVector<MLCacheRow> cache = cacheRows(-1);
+    for (auto it = cache.crbegin(); it != cache.crend(); ++it) {
+        StatusCode st = target.addMLCacheEntry(it->contentHash, it->moduleName, it->result);
+        if (st != StatusCode::SUCCESS) {
+            return fail(st);
+        }
+    }
+
+    if (!conn.commit()) {
+        return fail(StatusCode::DB_QUERY_FAILED);
+    }
+
+    qDebug() << LogMsg::DB_MEMORY_SNAPSHOT << target.connectionName() << points.latitude.size();
+    return StatusCode::SUCCESS;
+}
@@ -0,0 +1,166 @@
+#ifndef MEMORYDB_H
+#define MEMORYDB_H
+
+#include "dbinterface.h"
+#include "dbrows.h"
+#include "columnarena.h"
+#include "statuscodes.h"
+#include "config.h"
+
+#include <QHash>
+#include <QJsonObject>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <unordered_map>
+#include <vector>
+
+class SQLiteDb;
+
+// БД в памяти с тем же API добавления, что у SQLiteDb: для симуляций и нагрузочных тестов,
+// которым не нужен файловый ввод-вывод.
+//
+// Таблицы — столбцы только для добавления (AppendColumn), JSON и тексты — в ByteArena;
+// id строки = номер в столбце + 1, как у AUTOINCREMENT в пустой БД.
+// Точки каждой сессии разложены по ячейкам сетки Config::MEMORY_DB_CELL_DEG — на этом
+// работает pointsInRect для карты.
+//
+// connect(path) запоминает файл SQLite, в который disconnect() запишет снимок
+// (пустая строка или ":memory:" — без снимка). SQL не выполняется.
+class MemoryDb : public DbInterface
+{
+public:
+    MemoryDb() = default;
+    ~MemoryDb();
+
+    StatusCode connect(const QString& connectionInfo) override;
+    SQLResult executeSQL(const QString& query) override;
+    void disconnect() override;
+
+    StatusCode addSession(const QString& description, int* insertedId = nullptr) override;
+    StatusCode addField(const QString& name, const QJsonObject& boundary, int sessionId, int* insertedId = nullptr) override;
+    StatusCode addSensorSpec(const QJsonObject& spec, int* insertedId = nullptr) override;
+    StatusCode addPoint(int fieldId, int sessionId, double latitude, double longitude,
+                        const QJsonObject& data, int specId = -1, int* insertedId = nullptr,
+                        quint64 journalSeq = 0) override;
+    StatusCode addPointRaw(int fieldId, int sessionId, double latitude, double longitude,
+                           const RawJson::Document& data, int specId = -1, int* insertedId = nullptr,
+                           quint64 journalSeq = 0) override;
+    StatusCode addObservation(int pointId, int* insertedId = nullptr) override;
+    StatusCode addMLResult(int observationId, const QString& moduleName, const QJsonObject& result,
+                           int* insertedId = nullptr) override;
+    StatusCode addRecommendation(int observationId, const QString& text, int* insertedId = nullptr) override;
+
+    BulkResult addPoints(const QVector<PointRow>& rows) override;
+    BulkResult addObservations(const QVector<int>& pointIds) override;
+    BulkResult addMLResults(const QVector<MLResultRow>& rows) override;
+
+    StatusCode pointsInRect(int sessionId, const GeoRect& rect, QVector<PointRecord>& out, int limit = -1) override;
+
+    // Повторы записей журнала отбрасываются, как в SQLiteDb. Надёжной фиксации нет:
+    // на диск попадает только снимок при disconnect()
+    StatusCode requireDurableCommits() override { return StatusCode::SUCCESS; }
+    StatusCode lastJournalSeq(quint64& seq) override;
+
+    StatusCode addMLCacheEntry(const QString& contentHash, const QString& moduleName, const QJsonObject& result) override;
+    QVector<MLCacheRow> loadMLCache(int limit) override;
+
+    int pointCount() const { return points.latitude.size(); }
+    int observationCount() const { return observations.pointId.size(); }
+    int mlResultCount() const { return mlResults.observationId.size(); }
+
+    // Память под столбцы и арену (выделенная, а не занятая)
+    qint64 bytesReserved() const;
+
+    // Переносит всё содержимое в SQLite одной транзакцией. id в target назначаются заново,
+    // ссылки между таблицами пересчитываются; created_at — время записи снимка
+    StatusCode snapshotTo(SQLiteDb& target) const;
+
+    void clear();
+
+private:
+    struct SessionRow {
+        QString description;
+    };
+
+    struct FieldRow {
+        QString name;
+        QJsonObject boundary;
+        int sessionId;
+    };
+
+    struct PointTable {
+        AppendColumn<int> fieldId;
+        AppendColumn<int> sessionId;
+        AppendColumn<int> specId;          // -1 — спецификация неизвестна
+        AppendColumn<double> latitude;
+        AppendColumn<double> longitude;
+        AppendColumn<ByteArena::Ref> data;
+    };
+
+    struct ObservationTable {
+        AppendColumn<int> pointId;
+    };
+
+    struct MLResultTable {
+        AppendColumn<int> observationId;
+        AppendColumn<int> module;          // номер в moduleNames
+        AppendColumn<ByteArena::Ref> result;
+    };
+
+    struct RecommendationTable {
+        AppendColumn<int> observationId;
+        AppendColumn<ByteArena::Ref> text;
+    };
+
+    struct CacheEntry {
+        QString contentHash;
+        QString moduleName;
+        ByteArena::Ref result;
+        qint64 seq;                        // порядок записи: loadMLCache отдаёт новые первыми
+    };
+
+    // Ячейка сетки → номера точек сессии
+    using CellIndex = std::unordered_map<qint64, std::vector<int>>;
+
+    QString snapshotPath;
+
+    QVector<SessionRow> sessions;
+    QVector<FieldRow> fields;
+    QVector<QByteArray> specs;
+    QHash<QString, int> specIds;           // хеш спецификации → id, как в SQLiteDb
+    PointTable points;
+    ObservationTable observations;
+    MLResultTable mlResults;
+    RecommendationTable recommendations;
+    ByteArena arena;
+
+    QVector<QString> moduleNames;
+    QHash<QString, int> moduleIds;
+
+    std::unordered_map<int, CellIndex> spatialIndex;   // сессия → ячейки
+    QHash<quint64, int> journalPoints;                 // номер записи журнала → id точки
+
+    QVector<CacheEntry> mlCache;
+    QHash<QPair<QString, QString>, int> mlCacheIndex;
+    qint64 mlCacheSeq = 0;
+
+    StatusCode insertPoint(int fieldId, int sessionId, double latitude, double longitude,
+                           const ByteArena::Ref& data, int specId, int* insertedId);
+    StatusCode insertObservation(int pointId, int* insertedId);
+    StatusCode insertMLResult(int observationId, const QString& moduleName, const QJsonObject& result,
+                              int* insertedId);
+    bool isJournalRepeat(quint64 journalSeq, int* insertedId) const;
+
+    ByteArena::Ref store(const QJsonObject& json);
+    QJsonObject load(const ByteArena::Ref& ref) const;
+    QVector<MLCacheRow> cacheRows(int limit) const;   // новые первыми; limit < 0 — все
+    int moduleId(const QString& name);
+
+    static qint64 cellOf(double latitude, double longitude);
+    static qint64 cellCoord(double degrees);
+    static qint64 cellKey(qint64 y, qint64 x);   // номер ячейки по строке и столбцу сетки
+};
+
+#endif // MEMORYDB_H
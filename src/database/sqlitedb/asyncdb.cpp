@@ -0,0 +1,238 @@
+#include "asyncdb.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+
+#include <QDebug>
+#include <QMetaObject>
+
+namespace {
+std::atomic<int> nextConnectionId{0};
+}
+
+
+AsyncDb::AsyncDb(QObject* parent)
+    : QObject(parent)
+{}
+
+AsyncDb::~AsyncDb()
+{
+    close();
+}
+
+
+StatusCode AsyncDb::open(DbConnectionPool* pool)
+{
+    return start(pool, QString());
+}
+
+
+StatusCode AsyncDb::open(const QString& path)
+{
+    return start(nullptr, path);
+}
+
+
+StatusCode AsyncDb::start(DbConnectionPool* pool, const QString& path)
+{
+    close();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+
+    // Соединение Qt живёт в потоке, где создано, поэтому подключаемся уже в потоке БД
+    std::promise<StatusCode> opened;
+    std::future<StatusCode> result = opened.get_future();
+
+    worker = std::thread(&AsyncDb::workerLoop, this, pool, path, std::move(opened));
+
+    const StatusCode st = result.get();
+    if (st != StatusCode::SUCCESS) {
+        close();
+    }
+    return st;
+}
+
+
+void AsyncDb::close()
+{
+    if (!worker.joinable()) {
+        return;
+    }
+
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        dropped.swap(queue);
+        if (runningCancelled) {
+            *runningCancelled = true;
+        }
+    }
+    wakeUp.notify_all();
+
+    for (Task& task : dropped) {
+        *task.cancelled = true;
+        task.cancel();
+    }
+
+    worker.join();
+}
+
+
+StatusCode AsyncDb::enqueue(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (stopping) {
+            qWarning() << statusToMessage(StatusCode::DB_CONNECTION_FAILED);
+            return StatusCode::DB_CONNECTION_FAILED;
+        }
+
+        if (int(queue.size()) >= Config::ASYNC_DB_QUEUE_SIZE) {
+            qWarning() << statusToMessage(StatusCode::DB_QUEUE_FULL) << queue.size();
+            return StatusCode::DB_QUEUE_FULL;
+        }
+
+        queue.push_back(std::move(task));
+    }
+
+    wakeUp.notify_one();
+    return StatusCode::SUCCESS;
+}
+
+
+int AsyncDb::cancel(const QString& tag)
+{
+    std::deque<Task> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->tag == tag) {
+                dropped.push_back(std::move(*it));
+                it = queue.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        // Выполняющийся запрос не прервать, но его результат уже никому не нужен
+        if (runningCancelled && runningTag == tag) {
+            *runningCancelled = true;
+        }
+    }
+
+    for (Task& task : dropped) {
+        *task.cancelled = true;
+        task.cancel();
+    }
+    return int(dropped.size());
+}
+
+
+bool AsyncDb::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !stopping;
+}
+
+
+int AsyncDb::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return int(queue.size());
+}
+
+
+void AsyncDb::workerLoop(DbConnectionPool* pool, const QString& path, std::promise<StatusCode> opened)
+{
+    // Читателя закрывает пул при завершении этого потока, писателя — сам цикл
+    std::unique_ptr<SQLiteDb> own;
+    SQLiteDb* db = nullptr;
+
+    if (pool) {
+        db = pool->reader();
+    }
+    else {
+        own = std::make_unique<SQLiteDb>(QString("agro_async_%1").arg(nextConnectionId++));
+        if (own->connect(path) == StatusCode::SUCCESS) {
+            db = own.get();
+        }
+    }
+
+    opened.set_value(db ? StatusCode::SUCCESS : StatusCode::DB_CONNECTION_FAILED);
+    if (!db) {
+        return;
+    }
+
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || !queue.empty(); });
+
+            if (stopping) {
+                break;
+            }
+
+            task = std::move(queue.front());
+            queue.pop_front();
+            runningCancelled = task.cancelled;
+            runningTag = task.tag;
+        }
+
+        task.run(*db);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        runningCancelled.reset();
+        runningTag.clear();
+    }
+
+    if (own) {
+        own->disconnect();
+    }
+}
+
+
+void AsyncDb::deliver(std::function<void()> fn)
+{
+    // Если AsyncDb удалён раньше, чем событие обработано, Qt его просто отбросит
+    QMetaObject::invokeMethod(this, std::move(fn), Qt::QueuedConnection);
+}
+
+// -------------------- Готовые операции --------------------
+
+StatusCode AsyncDb::executeSQL(const QString& sql, std::function<void(const SQLResult&)> done, const QString& tag)
+{
+    return submit<SQLResult>(
+        tag,
+        [sql](SQLiteDb& db, SQLResult& result) {
+            result = db.executeSQL(sql);
+            return result.code;
+        },
+        [done](StatusCode code, const SQLResult& result) {
+            if (!done) {
+                return;
+            }
+            SQLResult out = result;
+            out.code = code;
+            done(out);
+        });
+}
+
+
+StatusCode AsyncDb::pointsInRect(int sessionId, const GeoRect& rect, int limit,
+                                 std::function<void(StatusCode, const QVector<PointRecord>&)> done,
+                                 const QString& tag)
+{
+    return submitLatest<QVector<PointRecord>>(
+        tag,
+        [sessionId, rect, limit](SQLiteDb& db, QVector<PointRecord>& out) {
+            return db.pointsInRect(sessionId, rect, out, limit);
+        },
+        std::move(done));
+}
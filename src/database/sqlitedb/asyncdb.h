@@ -0,0 +1,170 @@
+#ifndef ASYNCDB_H
+#define ASYNCDB_H
+
+#include "dbconnectionpool.h"
+#include "sqlitedb.h"
+#include "statuscodes.h"
+#include "config.h"
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Асинхронный доступ к БД: запросы выполняются в отдельном потоке со своим соединением.
+// Для чтения соединение берётся из DbConnectionPool (читатель потока БД), для записи
+// AsyncDb подключает собственного писателя.
+//
+// Задачи ставятся в ограниченную очередь (Config::ASYNC_DB_QUEUE_SIZE) и выполняются по порядку.
+// Обработчик done вызывается в потоке, которому принадлежит AsyncDb (обычно GUI),
+// через очередь событий — поэтому там можно сразу трогать виджеты.
+//
+// У задачи есть тег. cancel(tag) снимает ещё не начатые задачи с этим тегом и помечает
+// выполняющуюся: её результат не доставляется, done получает DB_QUERY_CANCELLED.
+// Так запрос видимой области, устаревший после нового сдвига карты, не тратит время GUI.
+class AsyncDb : public QObject {
+    Q_OBJECT
+
+public:
+    explicit AsyncDb(QObject* parent = nullptr);
+    ~AsyncDb();
+
+    // Запускает поток БД и берёт в нём читателя из пула; ждёт результата подключения.
+    // Пул должен жить дольше AsyncDb (до close()).
+    // open() и close() вызываются из потока-владельца, submit() и cancel() — из любого
+    StatusCode open(DbConnectionPool* pool);
+    // То же с собственным соединением для записи
+    StatusCode open(const QString& path);
+    void close();
+    bool isOpen() const;
+
+    // job выполняется в потоке БД, done — в потоке AsyncDb.
+    // DB_QUEUE_FULL — очередь заполнена, задача не принята (done не вызывается)
+    template <typename Result>
+    StatusCode submit(const QString& tag,
+                      std::function<StatusCode(SQLiteDb&, Result&)> job,
+                      std::function<void(StatusCode, const Result&)> done);
+
+    // То же, но сначала отменяет задачи с этим тегом: нужен только последний запрос
+    template <typename Result>
+    StatusCode submitLatest(const QString& tag,
+                            std::function<StatusCode(SQLiteDb&, Result&)> job,
+                            std::function<void(StatusCode, const Result&)> done)
+    {
+        cancel(tag);
+        return submit<Result>(tag, std::move(job), std::move(done));
+    }
+
+    // Вариант с future для потоков без цикла событий (не ждать его в потоке AsyncDb вместе с done!)
+    template <typename Result>
+    std::future<std::pair<StatusCode, Result>> run(const QString& tag,
+                                                   std::function<StatusCode(SQLiteDb&, Result&)> job);
+
+    // Отменяет задачи с тегом; возвращает число снятых из очереди
+    int cancel(const QString& tag);
+
+    // Готовые операции
+    StatusCode executeSQL(const QString& sql, std::function<void(const SQLResult&)> done,
+                          const QString& tag = QString());
+
+    // Точки в прямоугольнике; предыдущий незавершённый запрос с тем же тегом отменяется
+    StatusCode pointsInRect(int sessionId, const GeoRect& rect, int limit,
+                            std::function<void(StatusCode, const QVector<PointRecord>&)> done,
+                            const QString& tag = "viewport");
+
+    int pendingCount() const;
+
+private:
+    struct Task {
+        QString tag;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        std::function<void(SQLiteDb&)> run;     // в потоке БД
+        std::function<void()> cancel;           // задача снята из очереди
+    };
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<Task> queue;
+    std::shared_ptr<std::atomic<bool>> runningCancelled;
+    QString runningTag;
+    bool stopping = true;      // true — поток БД не запущен или останавливается
+
+    StatusCode start(DbConnectionPool* pool, const QString& path);
+    StatusCode enqueue(Task task);
+    void workerLoop(DbConnectionPool* pool, const QString& path, std::promise<StatusCode> opened);
+
+    // Вызов fn в потоке AsyncDb
+    void deliver(std::function<void()> fn);
+};
+
+
+template <typename Result>
+StatusCode AsyncDb::submit(const QString& tag,
+                           std::function<StatusCode(SQLiteDb&, Result&)> job,
+                           std::function<void(StatusCode, const Result&)> done)
+{
+    Task task;
+    task.tag = tag;
+    task.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    task.run = [this, job = std::move(job), done, cancelled = task.cancelled](SQLiteDb& db) {
+        auto result = std::make_shared<Result>();
+        const StatusCode st = *cancelled ? StatusCode::DB_QUERY_CANCELLED : job(db, *result);
+        if (!done) {
+            return;
+        }
+        deliver([done, result, st, cancelled] {
+            // Отмена могла прийти, пока результат ждал в очереди событий
+            done(*cancelled ? StatusCode::DB_QUERY_CANCELLED : st, *result);
+        });
+    };
+
+    task.cancel = [this, done] {
+        if (done) {
+            deliver([done] { done(StatusCode::DB_QUERY_CANCELLED, Result()); });
+        }
+    };
+
+    return enqueue(std::move(task));
+}
+
+
+template <typename Result>
+std::future<std::pair<StatusCode, Result>> AsyncDb::run(const QString& tag,
+                                                        std::function<StatusCode(SQLiteDb&, Result&)> job)
+{
+    auto promise = std::make_shared<std::promise<std::pair<StatusCode, Result>>>();
+    std::future<std::pair<StatusCode, Result>> future = promise->get_future();
+
+    Task task;
+    task.tag = tag;
+    task.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    task.run = [job = std::move(job), promise, cancelled = task.cancelled](SQLiteDb& db) {
+        Result result;
+        const StatusCode st = *cancelled ? StatusCode::DB_QUERY_CANCELLED : job(db, result);
+        promise->set_value({*cancelled ? StatusCode::DB_QUERY_CANCELLED : st, std::move(result)});
+    };
+
+    task.cancel = [promise] {
+        promise->set_value({StatusCode::DB_QUERY_CANCELLED, Result()});
+    };
+
+    const StatusCode st = enqueue(std::move(task));
+    if (st != StatusCode::SUCCESS) {
+        promise->set_value({st, Result()});
+    }
+    return future;
+}
+
+#endif // ASYNCDB_H
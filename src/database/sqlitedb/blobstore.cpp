@@ -0,0 +1,458 @@
+#include "blobstore.h"
+#include "config.h"
+#include "contenthash.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+const QString BASE64_SUFFIX = "_base64";
+const QString BLOB_SUFFIX = "_blob";
+}
+
+
+StatusCode BlobStore::open(const QString& blobDir, const QSqlDatabase& database)
+{
+    close();
+
+    if (!QDir().mkpath(blobDir)) {
+        qWarning() << statusToMessage(StatusCode::BLOB_WRITE_FAILED) << blobDir;
+        return StatusCode::BLOB_WRITE_FAILED;
+    }
+
+    db = database;
+
+    addRefQuery = QSqlQuery(db);
+    addRefQuery.prepare(
+        "INSERT INTO Blobs (hash, size, refcount) VALUES (:hash, :size, 1) "
+        "ON CONFLICT(hash) DO UPDATE SET refcount = refcount + 1");
+
+    releaseQuery = QSqlQuery(db);
+    releaseQuery.prepare("UPDATE Blobs SET refcount = refcount - 1 WHERE hash = :hash AND refcount > 0");
+
+    dir = blobDir;
+    return StatusCode::SUCCESS;
+}
+
+
+void BlobStore::close()
+{
+    // Запросы держат ссылку на соединение — освобождаем до его закрытия
+    addRefQuery = QSqlQuery();
+    releaseQuery = QSqlQuery();
+    db = QSqlDatabase();
+    dir.clear();
+}
+
+
+// 128 бит из двух xxHash64 с разными seed: быстрее криптографического хеша
+// на мегабайтных кадрах, а вероятность коллизии пренебрежимо мала
+QString BlobStore::hashOf(const QByteArray& bytes)
+{
+    return ContentHash::toHex(ContentHash::hash64(bytes, 0))
+         + ContentHash::toHex(ContentHash::hash64(bytes, 0x5A17C0DEull));
+}
+
+
+QString BlobStore::path(const QString& hash) const
+{
+    return QDir(dir).filePath(hash.left(2) + "/" + hash);
+}
+
+
+StatusCode BlobStore::put(const QByteArray& bytes, QString& hash)
+{
+    if (!isOpen()) {
+        return StatusCode::BLOB_WRITE_FAILED;
+    }
+
+    hash = hashOf(bytes);
+    const QString target = path(hash);
+
+    // Такой кадр уже есть — только ссылка
+    if (!QFileInfo::exists(target)) {
+        QDir().mkpath(QFileInfo(target).path());
+
+        // QSaveFile пишет во временный файл и переименовывает: недописанный блоб не виден
+        QSaveFile file(target);
+        if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+            qWarning() << statusToMessage(StatusCode::BLOB_WRITE_FAILED) << target << file.errorString();
+            return StatusCode::BLOB_WRITE_FAILED;
+        }
+    }
+
+    addRefQuery.bindValue(":hash", hash);
+    addRefQuery.bindValue(":size", bytes.size());
+    if (!addRefQuery.exec()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << addRefQuery.lastError().text();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode BlobStore::release(const QString& hash)
+{
+    if (!isOpen()) {
+        return StatusCode::BLOB_NOT_FOUND;
+    }
+
+    releaseQuery.bindValue(":hash", hash);
+    if (!releaseQuery.exec()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << releaseQuery.lastError().text();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+    return releaseQuery.numRowsAffected() > 0 ? StatusCode::SUCCESS : StatusCode::BLOB_NOT_FOUND;
+}
+
+
+// Файлы удаляются только после того, как строки Blobs удалены и зафиксированы,
+// поэтому откат чужой транзакции не может оставить ссылку на удалённый файл
+int BlobStore::collectGarbage(int limit)
+{
+    if (!isOpen()) {
+        return 0;
+    }
+
+    QSqlQuery query(db);
+    QStringList orphans;
+
+    query.prepare("SELECT hash FROM Blobs WHERE refcount <= 0 LIMIT :limit");
+    query.bindValue(":limit", limit);
+    if (!query.exec()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return 0;
+    }
+    while (query.next()) {
+        orphans.append(query.value(0).toString());
+    }
+    query.finish();
+
+    sweepOrphanFiles();
+
+    if (orphans.isEmpty()) {
+        return 0;
+    }
+
+    // Ссылка могла появиться заново между SELECT и DELETE — такой блоб остаётся
+    const bool ownTransaction = db.transaction();
+
+    // Вместе с изображением уходят его миниатюры: ссылки на них снимаются, а сами
+    // блобы миниатюр удалятся следующим вызовом
+    QSqlQuery thumbs(db);
+    thumbs.prepare("SELECT thumb_hash FROM Thumbnails WHERE blob_hash = :hash AND thumb_hash IS NOT NULL");
+    QSqlQuery dropThumbs(db);
+    dropThumbs.prepare("DELETE FROM Thumbnails WHERE blob_hash = :hash");
+
+    auto fail = [&](const QSqlQuery& failed) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << failed.lastError().text();
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return 0;
+    };
+
+    QStringList removed;
+    query.prepare("DELETE FROM Blobs WHERE hash = :hash AND refcount <= 0");
+    for (const QString& hash : std::as_const(orphans)) {
+        query.bindValue(":hash", hash);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        if (query.numRowsAffected() == 0) {
+            continue;
+        }
+        removed.append(hash);
+
+        thumbs.bindValue(":hash", hash);
+        if (!thumbs.exec()) {
+            return fail(thumbs);
+        }
+        QStringList thumbHashes;
+        while (thumbs.next()) {
+            thumbHashes.append(thumbs.value(0).toString());
+        }
+        for (const QString& thumb : std::as_const(thumbHashes)) {
+            release(thumb);
+        }
+
+        dropThumbs.bindValue(":hash", hash);
+        if (!dropThumbs.exec()) {
+            return fail(dropThumbs);
+        }
+    }
+
+    if (ownTransaction && !db.commit()) {
+        db.rollback();
+        return 0;
+    }
+
+    for (const QString& hash : std::as_const(removed)) {
+        QFile::remove(path(hash));
+    }
+
+    qDebug() << LogMsg::BLOB_GARBAGE_COLLECTED << removed.size();
+    return int(removed.size());
+}
+
+
+int BlobStore::sweepOrphanFiles()
+{
+    if (!isOpen()) {
+        return 0;
+    }
+
+    const QString prefix = QString("%1").arg(sweepBucket, 2, 16, QChar('0'));
+    sweepBucket = (sweepBucket + 1) % 256;
+
+    const QDir bucket(QDir(dir).filePath(prefix));
+    if (!bucket.exists()) {
+        return 0;
+    }
+
+    // Хеши каталога — диапазон по первичному ключу Blobs
+    QSqlQuery query(db);
+    query.prepare("SELECT hash FROM Blobs WHERE hash >= :from AND hash < :to");
+    query.bindValue(":from", prefix);
+    query.bindValue(":to", prefix + "g");
+    if (!query.exec()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return 0;
+    }
+
+    QSet<QString> known;
+    while (query.next()) {
+        known.insert(query.value(0).toString());
+    }
+
+    // Свежий файл может принадлежать транзакции, которая ещё не зафиксирована
+    const QDateTime cutoff = QDateTime::currentDateTimeUtc().addSecs(-Config::BLOB_ORPHAN_GRACE_SEC);
+
+    int removed = 0;
+    const QFileInfoList files = bucket.entryInfoList(QDir::Files);
+    for (const QFileInfo& file : files) {
+        if (known.contains(file.fileName()) || file.lastModified().toUTC() > cutoff) {
+            continue;
+        }
+        if (QFile::remove(file.absoluteFilePath())) {
+            ++removed;
+        }
+    }
+
+    if (removed > 0) {
+        qDebug() << LogMsg::BLOB_ORPHANS_REMOVED << prefix << removed;
+    }
+    return removed;
+}
+
+
+BlobView BlobStore::map(const QString& hash) const
+{
+    auto file = std::make_unique<QFile>(path(hash));
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << statusToMessage(StatusCode::BLOB_NOT_FOUND) << hash;
+        return BlobView();
+    }
+
+    const qint64 size = file->size();
+    const uchar* data = file->map(0, size);
+    if (!data) {
+        qWarning() << statusToMessage(StatusCode::BLOB_NOT_FOUND) << hash << file->errorString();
+        return BlobView();
+    }
+
+    return BlobView(std::move(file), data, size);
+}
+
+
+QByteArray BlobStore::read(const QString& hash) const
+{
+    QFile file(path(hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << statusToMessage(StatusCode::BLOB_NOT_FOUND) << hash;
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+
+QJsonObject BlobStore::externalize(const QJsonObject& json)
+{
+    if (!isOpen()) {
+        return json;
+    }
+
+    QJsonObject out = json;
+
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        const QString& key = it.key();
+
+        if (it.value().isObject()) {
+            out.insert(key, externalize(it.value().toObject()));
+            continue;
+        }
+
+        if (!key.endsWith(BASE64_SUFFIX) || !it.value().isString()) {
+            continue;
+        }
+
+        const QByteArray bytes = QByteArray::fromBase64(it.value().toString().toLatin1());
+        if (bytes.size() < Config::BLOB_MIN_BYTES) {
+            continue;   // мелочь дешевле хранить в JSON
+        }
+
+        QString hash;
+        if (put(bytes, hash) != StatusCode::SUCCESS) {
+            continue;
+        }
+
+        if (storedObserver) {
+            storedObserver(hash);
+        }
+
+        out.remove(key);
+        out.insert(key.chopped(BASE64_SUFFIX.size()) + BLOB_SUFFIX, hash);
+    }
+
+    return out;
+}
+
+
+QByteArray BlobStore::externalize(const RawJson::Document& doc)
+{
+    const QByteArray& src = doc.bytes();
+    if (!isOpen()) {
+        return src;
+    }
+
+    QByteArray out;
+    int copied = 0;
+
+    auto splice = [&](const RawJson::Field& f, const QByteArray& replacement) {
+        if (out.isEmpty()) {
+            out.reserve(src.size());
+        }
+        out.append(src.constData() + copied, f.valueBegin - copied);
+        out.append(replacement);
+        copied = f.valueBegin + f.valueLength;
+    };
+
+    for (const RawJson::Field& f : doc.fields()) {
+        // Вложенные объекты с изображениями редки — их разбираем целиком
+        if (f.kind == RawJson::Kind::Object) {
+            const QByteArray value = QByteArray::fromRawData(src.constData() + f.valueBegin, f.valueLength);
+            if (value.contains(BASE64_SUFFIX.toLatin1() + '"')) {
+                splice(f, QJsonDocument(externalize(doc.value(f).toObject())).toJson(QJsonDocument::Compact));
+            }
+            continue;
+        }
+
+        if (f.kind != RawJson::Kind::String || !doc.keyEndsWith(f, QLatin1String("_base64"))) {
+            continue;
+        }
+
+        const QByteArray bytes = QByteArray::fromBase64(doc.stringBytes(f));
+        if (bytes.size() < Config::BLOB_MIN_BYTES) {
+            continue;
+        }
+
+        QString hash;
+        if (put(bytes, hash) != StatusCode::SUCCESS) {
+            continue;
+        }
+
+        if (storedObserver) {
+            storedObserver(hash);
+        }
+
+        // "img_base64": "..." → "img_blob":"<хеш>": имя меняется вместе со значением
+        const int nameEnd = f.keyBegin + f.keyLength - int(BASE64_SUFFIX.size());
+        if (out.isEmpty()) {
+            out.reserve(src.size());
+        }
+        out.append(src.constData() + copied, nameEnd - copied);
+        out.append(BLOB_SUFFIX.toLatin1()).append("\":\"").append(hash.toLatin1()).append('"');
+        copied = f.valueBegin + f.valueLength;
+    }
+
+    if (copied == 0) {
+        return src;
+    }
+
+    out.append(src.constData() + copied, src.size() - copied);
+    return out;
+}
+
+
+QJsonObject BlobStore::inlineBlobs(const QJsonObject& json) const
+{
+    QJsonObject out = json;
+
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        const QString& key = it.key();
+
+        if (it.value().isObject()) {
+            out.insert(key, inlineBlobs(it.value().toObject()));
+            continue;
+        }
+
+        if (!key.endsWith(BLOB_SUFFIX) || !it.value().isString()) {
+            continue;
+        }
+
+        const BlobView view = map(it.value().toString());
+        if (!view.isValid()) {
+            continue;
+        }
+
+        const QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(view.data()),
+                                                       qsizetype(view.size()));
+        out.remove(key);
+        out.insert(key.chopped(BLOB_SUFFIX.size()) + BASE64_SUFFIX, QString::fromLatin1(raw.toBase64()));
+    }
+
+    return out;
+}
+
+
+QStringList BlobStore::blobRefs(const QJsonObject& json)
+{
+    QStringList refs;
+
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        if (it.value().isObject()) {
+            refs.append(blobRefs(it.value().toObject()));
+        }
+        else if (it.key().endsWith(BLOB_SUFFIX) && it.value().isString()) {
+            refs.append(it.value().toString());
+        }
+    }
+
+    return refs;
+}
+
+
+QJsonObject BlobStore::withoutBlobs(const QJsonObject& json)
+{
+    QJsonObject out = json;
+
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        if (it.value().isObject()) {
+            out.insert(it.key(), withoutBlobs(it.value().toObject()));
+        }
+        else if (it.key().endsWith(BLOB_SUFFIX) && it.value().isString()) {
+            out.remove(it.key());
+        }
+    }
+
+    return out;
+}
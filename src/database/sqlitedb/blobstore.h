@@ -0,0 +1,101 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include "statuscodes.h"
+#include "rawjson.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+
+// Содержимое блоба, отображённое в память (только чтение).
+// Отображение живёт, пока жив объект; копировать нельзя, только перемещать.
+class BlobView {
+public:
+    BlobView() = default;
+    BlobView(std::unique_ptr<QFile> file, const uchar* data, qint64 size)
+        : file(std::move(file)), bytes(data), length(size) {}
+
+    bool isValid() const { return bytes != nullptr; }
+    const uchar* data() const { return bytes; }
+    qint64 size() const { return length; }
+
+    // Копия содержимого (для API, которым нужен QByteArray)
+    QByteArray toByteArray() const { return QByteArray(reinterpret_cast<const char*>(bytes), qsizetype(length)); }
+
+private:
+    std::unique_ptr<QFile> file;   // QFile снимает отображение при закрытии
+    const uchar* bytes = nullptr;
+    qint64 length = 0;
+};
+
+
+// Хранилище изображений и масок с адресацией по содержимому.
+//
+// Поля "<name>_base64" при вставке заменяются на "<name>_blob" с хешем,
+// а байты ложатся в файл <dir>/<первые 2 символа хеша>/<хеш>. Одинаковые кадры
+// хранятся один раз; таблица Blobs считает ссылки. Чтение — через map() без копирования.
+class BlobStore {
+public:
+    StatusCode open(const QString& dir, const QSqlDatabase& db);
+    void close();
+    bool isOpen() const { return !dir.isEmpty(); }
+
+    // Сохраняет байты (или находит уже сохранённые) и добавляет ссылку
+    StatusCode put(const QByteArray& bytes, QString& hash);
+
+    // Снимает ссылку; файл удаляется позже, в collectGarbage()
+    StatusCode release(const QString& hash);
+
+    // Удаляет блобы без ссылок (не больше limit; -1 — все); вызывать вне транзакции.
+    // Заодно просматривает один каталог <hh> на файлы без строки в Blobs (см. sweepOrphanFiles).
+    // Возвращает число удалённых строк
+    int collectGarbage(int limit = -1);
+
+    // Файл пишется до фиксации транзакции со ссылкой на него; при откате файл остаётся
+    // без строки Blobs. Такие файлы старше Config::BLOB_ORPHAN_GRACE_SEC удаляются —
+    // по одному каталогу <hh> за вызов, по кругу. Возвращает число удалённых файлов
+    int sweepOrphanFiles();
+
+    BlobView map(const QString& hash) const;
+    QByteArray read(const QString& hash) const;
+    QString path(const QString& hash) const;
+
+    // "<name>_base64" → "<name>_blob" (рекурсивно по вложенным объектам).
+    // Если блоб записать не удалось, поле остаётся в JSON как было
+    QJsonObject externalize(const QJsonObject& json);
+
+    // То же для исходных байт сообщения: заменённые поля вырезаются и вставляются
+    // на месте, остальное копируется как есть. Без полей для замены — исходный массив
+    QByteArray externalize(const RawJson::Document& doc);
+
+    // Вызывается для каждого блоба, сохранённого externalize() (в том числе уже известного):
+    // так ThumbnailPipeline узнаёт о новых изображениях без просмотра таблицы Blobs
+    void setStoredObserver(std::function<void(const QString& hash)> observer) { storedObserver = std::move(observer); }
+
+    // Обратная замена для выгрузок и воспроизведения
+    QJsonObject inlineBlobs(const QJsonObject& json) const;
+
+    // Хеши из полей "<name>_blob" (рекурсивно) и тот же JSON без этих полей
+    static QStringList blobRefs(const QJsonObject& json);
+    static QJsonObject withoutBlobs(const QJsonObject& json);
+
+    static QString hashOf(const QByteArray& bytes);
+
+private:
+    QString dir;
+    QSqlDatabase db;
+    QSqlQuery addRefQuery;
+    QSqlQuery releaseQuery;
+    std::function<void(const QString&)> storedObserver;
+    int sweepBucket = 0;   // следующий каталог <hh> для sweepOrphanFiles()
+};
+
+#endif // BLOBSTORE_H
@@ -0,0 +1,95 @@
+#include "dbconnectionpool.h"
+#include "logmessages.h"
+
+#include <QDebug>
+
+
+DbConnectionPool::ReaderSlot::~ReaderSlot()
+{
+    // Соединение закрывается в своём потоке: QThreadStorage удаляет слот при выходе из него
+    db.reset();
+    if (counter) {
+        --*counter;
+    }
+}
+
+
+DbConnectionPool::DbConnectionPool(int maxReaders)
+    : maxReaders(maxReaders)
+{}
+
+DbConnectionPool::~DbConnectionPool()
+{
+    close();
+}
+
+
+StatusCode DbConnectionPool::open(const QString& dbPath, bool withWriter)
+{
+    close();
+
+    if (!withWriter) {
+        path = dbPath;
+        profileName.clear();
+        return StatusCode::SUCCESS;
+    }
+
+    writerDb = std::make_unique<SQLiteDb>(Config::DB_CONNECTION_NAME);
+    StatusCode st = writerDb->connect(dbPath);
+    if (st != StatusCode::SUCCESS) {
+        writerDb.reset();
+        return st;
+    }
+
+    path = dbPath;
+    profileName = writerDb->currentProfile().name;
+    return StatusCode::SUCCESS;
+}
+
+
+void DbConnectionPool::close()
+{
+    // Читатель этого потока; читатели других потоков закрываются при их завершении
+    if (threadReaders.hasLocalData()) {
+        threadReaders.setLocalData(nullptr);
+    }
+
+    writerDb.reset();
+    path.clear();
+}
+
+
+SQLiteDb* DbConnectionPool::reader()
+{
+    if (threadReaders.hasLocalData() && threadReaders.localData()) {
+        return threadReaders.localData()->db.get();
+    }
+
+    if (path.isEmpty() || path == ":memory:") {
+        qWarning() << LogMsg::DB_READER_NO_FILE;
+        return nullptr;
+    }
+
+    if (++readers > maxReaders) {
+        --readers;
+        qWarning() << LogMsg::DB_READER_POOL_EXHAUSTED << maxReaders;
+        return nullptr;
+    }
+
+    auto slot = new ReaderSlot;
+    slot->counter = &readers;
+    slot->db = std::make_unique<SQLiteDb>(Config::DB_READER_CONNECTION_PREFIX + QString::number(nextReaderId++),
+                                          true);
+    if (!profileName.isEmpty()) {
+        slot->db->setProfile(profileName);
+    }
+
+    if (slot->db->connect(path) != StatusCode::SUCCESS) {
+        delete slot;
+        return nullptr;
+    }
+
+    qDebug() << LogMsg::DB_READER_OPENED << slot->db->connectionName();
+    threadReaders.setLocalData(slot);
+    return slot->db.get();
+}
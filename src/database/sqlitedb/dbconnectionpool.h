@@ -0,0 +1,61 @@
+#ifndef DBCONNECTIONPOOL_H
+#define DBCONNECTIONPOOL_H
+
+#include "sqlitedb.h"
+#include "statuscodes.h"
+#include "config.h"
+
+#include <QString>
+#include <QThreadStorage>
+
+#include <atomic>
+#include <memory>
+
+// Один писатель и соединения только для чтения по одному на поток.
+//
+// Писатель создаёт схему и принимает все вставки (Manager). Карта, выгрузки и отчёты
+// берут reader() в своём потоке: в режиме WAL читатели не ждут писателя и не мешают ему.
+// Соединение Qt можно использовать только в потоке, где оно создано, поэтому читатель
+// живёт в QThreadStorage и закрывается при завершении потока.
+//
+// Других соединений только для чтения в программе нет: AsyncDb и SessionExporter
+// берут читателя из пула в своём рабочем потоке.
+//
+// Пул должен жить дольше всех потоков, которые брали из него читателей.
+class DbConnectionPool {
+public:
+    explicit DbConnectionPool(int maxReaders = Config::DB_READER_POOL_SIZE);
+    ~DbConnectionPool();
+
+    // Подключает писателя (создаёт схему); вызывать до первого reader().
+    // withWriter = false — только читатели уже созданной БД (карта, утилиты выгрузки)
+    StatusCode open(const QString& path, bool withWriter = true);
+    void close();
+
+    // Только из потока, вызвавшего open(); nullptr — открыт без писателя
+    SQLiteDb* writer() { return writerDb.get(); }
+
+    // Соединение текущего потока; nullptr — пул исчерпан или БД не в файле
+    SQLiteDb* reader();
+
+    int readerCount() const { return readers.load(); }
+
+private:
+    // Слот потока: держит соединение и освобождает место в пуле при завершении потока
+    struct ReaderSlot {
+        std::unique_ptr<SQLiteDb> db;
+        std::atomic<int>* counter = nullptr;
+        ~ReaderSlot();
+    };
+
+    QString path;
+    QString profileName;
+    int maxReaders;
+    std::unique_ptr<SQLiteDb> writerDb;
+
+    QThreadStorage<ReaderSlot*> threadReaders;
+    std::atomic<int> readers{0};
+    std::atomic<int> nextReaderId{0};
+};
+
+#endif // DBCONNECTIONPOOL_H
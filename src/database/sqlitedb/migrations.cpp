@@ -0,0 +1,319 @@
+#include "migrations.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+namespace Migrations {
+
+const QVector<Step>& steps()
+{
+    static const QVector<Step> list = {
+        {1, "Базовые таблицы", {
+            "CREATE TABLE IF NOT EXISTS Sessions ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    start_timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    description TEXT DEFAULT 'session' "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS Fields ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    name TEXT NOT NULL DEFAULT 'Поле №1', "
+            "    boundary_json TEXT DEFAULT '{}', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    session_id INTEGER, "
+            "    FOREIGN KEY(session_id) REFERENCES Sessions(id) "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS Sensor_specs ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    spec_json TEXT NOT NULL, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS Points ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    field_id INTEGER NOT NULL, "
+            "    session_id INTEGER NOT NULL, "
+            "    latitude REAL NOT NULL, "
+            "    longitude REAL NOT NULL, "
+            "    data_json TEXT NOT NULL DEFAULT '{}', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    FOREIGN KEY(field_id) REFERENCES Fields(id), "
+            "    FOREIGN KEY(session_id) REFERENCES Sessions(id) "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS Observations ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    point_id INTEGER NOT NULL, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    FOREIGN KEY(point_id) REFERENCES Points(id) "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS ML_results ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    observation_id INTEGER NOT NULL, "
+            "    module_name TEXT NOT NULL DEFAULT 'ML_module', "
+            "    results_json TEXT NOT NULL DEFAULT '{}', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    FOREIGN KEY(observation_id) REFERENCES Observations(id) "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS Recommendations ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    observation_id INTEGER NOT NULL, "
+            "    text TEXT NOT NULL DEFAULT 'Action', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    FOREIGN KEY(observation_id) REFERENCES Observations(id) "
+            ")",
+
+            "CREATE TABLE IF NOT EXISTS ML_cache ("
+            "    content_hash TEXT NOT NULL, "
+            "    module_name TEXT NOT NULL, "
+            "    results_json TEXT NOT NULL DEFAULT '{}', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    PRIMARY KEY(content_hash, module_name) "
+            ")",
+        }},
+
+        // Points(session_id, created_at) закрывает и выборку точек сессии, и диапазоны по времени;
+        // Observations(point_id, id) — покрывающий индекс для перехода точка → наблюдения.
+        {2, "Индексы по внешним ключам и времени создания", {
+            "CREATE INDEX IF NOT EXISTS idx_fields_session ON Fields(session_id)",
+            "CREATE INDEX IF NOT EXISTS idx_points_session_created ON Points(session_id, created_at)",
+            "CREATE INDEX IF NOT EXISTS idx_points_field ON Points(field_id)",
+            "CREATE INDEX IF NOT EXISTS idx_points_created ON Points(created_at)",
+            "CREATE INDEX IF NOT EXISTS idx_observations_point ON Observations(point_id, id)",
+            "CREATE INDEX IF NOT EXISTS idx_observations_created ON Observations(created_at)",
+            "CREATE INDEX IF NOT EXISTS idx_ml_results_observation ON ML_results(observation_id, module_name)",
+            "CREATE INDEX IF NOT EXISTS idx_ml_results_created ON ML_results(created_at)",
+            "CREATE INDEX IF NOT EXISTS idx_recommendations_observation ON Recommendations(observation_id)",
+            "CREATE INDEX IF NOT EXISTS idx_ml_cache_created ON ML_cache(created_at)",
+        }},
+
+        // Если SQLite собран без модуля rtree, выборки по прямоугольнику идут по самой Points
+        {3, "R*Tree по координатам точек", {
+            "CREATE VIRTUAL TABLE IF NOT EXISTS Points_rtree USING rtree("
+            "id, min_lat, max_lat, min_lon, max_lon, +session_id)",
+
+            "CREATE TRIGGER IF NOT EXISTS Points_rtree_insert AFTER INSERT ON Points BEGIN "
+            "INSERT INTO Points_rtree (id, min_lat, max_lat, min_lon, max_lon, session_id) "
+            "VALUES (new.id, new.latitude, new.latitude, new.longitude, new.longitude, new.session_id); "
+            "END",
+
+            "CREATE TRIGGER IF NOT EXISTS Points_rtree_update AFTER UPDATE OF latitude, longitude, session_id ON Points BEGIN "
+            "UPDATE Points_rtree SET min_lat = new.latitude, max_lat = new.latitude, "
+            "min_lon = new.longitude, max_lon = new.longitude, session_id = new.session_id "
+            "WHERE id = new.id; "
+            "END",
+
+            "CREATE TRIGGER IF NOT EXISTS Points_rtree_delete AFTER DELETE ON Points BEGIN "
+            "DELETE FROM Points_rtree WHERE id = old.id; "
+            "END",
+
+            // Точки, записанные до появления индекса
+            "INSERT INTO Points_rtree (id, min_lat, max_lat, min_lon, max_lon, session_id) "
+            "SELECT id, latitude, latitude, longitude, longitude, session_id FROM Points "
+            "WHERE id NOT IN (SELECT id FROM Points_rtree)",
+        }, true},
+
+        // Колонки добавляются по спецификации сенсоров (SQLiteDb::materializeSpecFields)
+        {4, "Поля сенсоров, вынесенные из Points.data_json в генерируемые колонки", {
+            "CREATE TABLE IF NOT EXISTS Sensor_fields ("
+            "    name TEXT PRIMARY KEY, "
+            "    column_name TEXT NOT NULL, "
+            "    sql_type TEXT NOT NULL DEFAULT 'REAL', "
+            "    spec_id INTEGER, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    FOREIGN KEY(spec_id) REFERENCES Sensor_specs(id) "
+            ")",
+        }},
+
+        // Обновляются при вставке точки (UPSERT); среднее и дисперсия считаются из sum и sum_sq
+        {5, "Агрегаты числовых полей data_json по минутам и по ячейкам сетки", {
+            "CREATE TABLE IF NOT EXISTS Rollup_time ("
+            "    session_id INTEGER NOT NULL, "
+            "    field TEXT NOT NULL, "
+            "    bucket INTEGER NOT NULL, "
+            "    count INTEGER NOT NULL, "
+            "    min REAL NOT NULL, "
+            "    max REAL NOT NULL, "
+            "    sum REAL NOT NULL, "
+            "    sum_sq REAL NOT NULL, "
+            "    PRIMARY KEY(session_id, field, bucket) "
+            ") WITHOUT ROWID",
+
+            "CREATE TABLE IF NOT EXISTS Rollup_cell ("
+            "    session_id INTEGER NOT NULL, "
+            "    field TEXT NOT NULL, "
+            "    cell_y INTEGER NOT NULL, "
+            "    cell_x INTEGER NOT NULL, "
+            "    count INTEGER NOT NULL, "
+            "    min REAL NOT NULL, "
+            "    max REAL NOT NULL, "
+            "    sum REAL NOT NULL, "
+            "    sum_sq REAL NOT NULL, "
+            "    PRIMARY KEY(session_id, field, cell_y, cell_x) "
+            ") WITHOUT ROWID",
+        }},
+
+        // Байты лежат в файлах <файл БД>.blobs/<hh>/<hash>, в JSON остаётся поле *_blob с хешем
+        {6, "Блобы (изображения, маски) с адресацией по содержимому", {
+            "CREATE TABLE IF NOT EXISTS Blobs ("
+            "    hash TEXT PRIMARY KEY, "
+            "    size INTEGER NOT NULL, "
+            "    refcount INTEGER NOT NULL DEFAULT 1, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP "
+            ") WITHOUT ROWID",
+        }},
+
+        // Используется только в каталоге ShardedDb: какая сессия в каком файле
+        {7, "Каталог файлов сессий", {
+            "CREATE TABLE IF NOT EXISTS Session_shards ("
+            "    session_id INTEGER PRIMARY KEY, "
+            "    file_name TEXT NOT NULL, "
+            "    state TEXT NOT NULL DEFAULT 'active', "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    archived_at TIMESTAMP, "
+            "    FOREIGN KEY(session_id) REFERENCES Sessions(id) "
+            ")",
+        }},
+
+        // Политики очистки старых данных (RetentionEngine); last_id — докуда строки уже просмотрены.
+        // Индекс по времени у Recommendations нужен для поиска границы по возрасту
+        {8, "Политики хранения данных", {
+            "CREATE TABLE IF NOT EXISTS Retention_policies ("
+            "    id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "    table_name TEXT NOT NULL, "
+            "    action TEXT NOT NULL, "
+            "    max_age_days INTEGER NOT NULL, "
+            "    session_id INTEGER, "
+            "    last_id INTEGER NOT NULL DEFAULT 0, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP "
+            ")",
+
+            "CREATE INDEX IF NOT EXISTS idx_recommendations_created ON Recommendations(created_at)",
+        }},
+
+        // Одна строка Sensor_specs на различную спецификацию (хеш канонического JSON);
+        // у старых строк хеш заполняет SQLiteDb при подключении
+        {9, "Дедупликация спецификаций сенсоров и spec_id у точек", {
+            "ALTER TABLE Sensor_specs ADD COLUMN spec_hash TEXT",
+            "CREATE UNIQUE INDEX IF NOT EXISTS idx_sensor_specs_hash ON Sensor_specs(spec_hash)",
+            "ALTER TABLE Points ADD COLUMN spec_id INTEGER REFERENCES Sensor_specs(id)",
+        }},
+
+        // Миниатюры изображений из хранилища блобов: сами байты — тоже блобы (thumb_hash).
+        // Строка с size = 0 и thumb_hash = NULL — блоб не изображение или кадр меньше
+        // наименьшей миниатюры: повторно не разбирать
+        {10, "Миниатюры изображений", {
+            "CREATE TABLE IF NOT EXISTS Thumbnails ("
+            "    blob_hash TEXT NOT NULL, "
+            "    size INTEGER NOT NULL, "
+            "    thumb_hash TEXT, "
+            "    width INTEGER NOT NULL DEFAULT 0, "
+            "    height INTEGER NOT NULL DEFAULT 0, "
+            "    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "    PRIMARY KEY(blob_hash, size) "
+            ") WITHOUT ROWID",
+            "CREATE INDEX IF NOT EXISTS idx_thumbnails_thumb ON Thumbnails(thumb_hash)",
+        }},
+
+        // Номер записи журнала (IngestJournal), из которой создана точка: повтор записи
+        // после сбоя не создаёт вторую точку. У точек не из журнала — NULL
+        {11, "Номер записи журнала у точек", {
+            "ALTER TABLE Points ADD COLUMN journal_seq INTEGER",
+            "CREATE UNIQUE INDEX IF NOT EXISTS idx_points_journal_seq ON Points(journal_seq) "
+            "WHERE journal_seq IS NOT NULL",
+        }},
+    };
+    return list;
+}
+
+
+int latestVersion()
+{
+    return steps().last().version;
+}
+
+
+int currentVersion(const QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+
+namespace {
+bool setVersion(QSqlQuery& query, int version)
+{
+    // PRAGMA не принимает параметры, номер подставляется в текст
+    return query.exec(QString("PRAGMA user_version = %1").arg(version));
+}
+
+bool applyStep(QSqlDatabase& db, const Step& step)
+{
+    QSqlQuery query(db);
+
+    if (!db.transaction()) {
+        qWarning() << LogMsg::DB_MIGRATION_FAILED << step.version << db.lastError().text();
+        return false;
+    }
+
+    for (const QString& sql : step.statements) {
+        if (query.exec(sql)) {
+            continue;
+        }
+
+        qWarning() << LogMsg::DB_MIGRATION_FAILED << step.version << step.description << query.lastError().text();
+        db.rollback();
+
+        // Необязательный шаг пропускается, но его номер записывается, чтобы не повторять попытку
+        // при каждом подключении
+        if (step.optional) {
+            return setVersion(query, step.version);
+        }
+        return false;
+    }
+
+    if (!setVersion(query, step.version) || !db.commit()) {
+        qWarning() << LogMsg::DB_MIGRATION_FAILED << step.version << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+}
+
+
+StatusCode migrate(QSqlDatabase& db)
+{
+    const int version = currentVersion(db);
+    if (version < 0) {
+        qWarning() << statusToMessage(StatusCode::DB_INIT_FAILED);
+        return StatusCode::DB_INIT_FAILED;
+    }
+
+    if (version >= latestVersion()) {
+        return StatusCode::SUCCESS;
+    }
+
+    for (const Step& step : steps()) {
+        if (step.version <= version) {
+            continue;
+        }
+        if (!applyStep(db, step)) {
+            return StatusCode::DB_TABLE_CREATE_FAILED;
+        }
+    }
+
+    qDebug() << LogMsg::DB_MIGRATED << version << "->" << latestVersion();
+    return StatusCode::SUCCESS;
+}
+
+}
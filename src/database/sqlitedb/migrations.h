@@ -0,0 +1,38 @@
+#ifndef MIGRATIONS_H
+#define MIGRATIONS_H
+
+#include "statuscodes.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Схема БД, встроенная в программу, в виде пронумерованных шагов.
+//
+// Номер последнего применённого шага хранится в PRAGMA user_version (заголовок файла БД),
+// поэтому подключение к актуальной БД — одно чтение PRAGMA и никакого DDL.
+// Шаг и запись его номера выполняются в одной транзакции.
+//
+// Новые изменения схемы — только новым шагом в конце списка; старые шаги не меняются,
+// иначе уже созданные БД разойдутся с новыми.
+namespace Migrations {
+
+struct Step {
+    int version;
+    QString description;
+    QStringList statements;
+    bool optional = false;   // ошибка не останавливает миграцию (модуль SQLite может отсутствовать)
+};
+
+const QVector<Step>& steps();
+int latestVersion();
+
+int currentVersion(const QSqlDatabase& db);
+
+// Применяет недостающие шаги; для актуальной БД только читает user_version
+StatusCode migrate(QSqlDatabase& db);
+
+}
+
+#endif // MIGRATIONS_H
@@ -0,0 +1,93 @@
+#include "queryplancheck.h"
+#include "retentionengine.h"
+#include "sqlitedb.h"
+#include "sqlqueries.h"
+
+#include <QRegularExpression>
+#include <QDebug>
+
+namespace QueryPlanCheck {
+
+const QVector<HotQuery>& hotQueries()
+{
+    static const QVector<HotQuery> queries = {
+        {"session_replay", SqlQueries::SESSION_REPLAY},
+        {"export_points", SqlQueries::EXPORT_POINTS.arg(QString())},
+        {"export_ml_results", SqlQueries::EXPORT_ML_RESULTS},
+
+        {"points_in_rect", SqlQueries::POINTS_IN_RECT},
+        {"points_in_rect_fallback", SqlQueries::POINTS_IN_RECT_FALLBACK},
+        {"points_in_rect_thinned", SqlQueries::POINTS_IN_RECT_THINNED},
+        {"points_in_rect_thinned_fallback", SqlQueries::POINTS_IN_RECT_THINNED_FALLBACK},
+        {"ml_results_of_points", SqlQueries::ML_RESULTS_OF_POINTS.arg("1, 2, 3")},
+        {"thumbnails_of_blobs", SqlQueries::THUMBNAILS_OF_BLOBS.arg(":h0, :h1")},
+        {"thumbnail_backlog", SqlQueries::THUMBNAIL_BACKLOG},
+
+        {"rollup_time", SqlQueries::ROLLUP_TIME},
+        {"rollup_cell", SqlQueries::ROLLUP_CELL},
+        {"ml_cache_preload", SqlQueries::ML_CACHE_PRELOAD},
+
+        // RetentionEngine: граница по времени и пачка окна для типичных политик
+        {"retention_young_points", RetentionEngine::youngRowQuery("Points")},
+        {"retention_batch_points", RetentionEngine::batchQuery("Points", true, true)},
+        {"retention_batch_observations", RetentionEngine::batchQuery("Observations", true, false)},
+        {"retention_batch_ml_results", RetentionEngine::batchQuery("ML_results", true, true)},
+        {"retention_batch_recommendations", RetentionEngine::batchQuery("Recommendations", true, false)},
+        {"retention_batch_ml_cache", RetentionEngine::batchQuery("ML_cache", false, true)},
+
+        // Выборки по индексам без одного места вызова (отчёты, ручные запросы)
+        {"session_points_time_range",
+         "SELECT id, latitude, longitude FROM Points "
+         "WHERE session_id = 1 AND created_at BETWEEN '2025-06-01 00:00:00' AND '2025-06-02 00:00:00'"},
+
+        {"observations_time_range",
+         "SELECT id, point_id FROM Observations "
+         "WHERE created_at BETWEEN '2025-06-01 00:00:00' AND '2025-06-02 00:00:00'"},
+
+        {"ml_results_of_observation",
+         "SELECT id, module_name, results_json FROM ML_results WHERE observation_id = 1"},
+
+        {"recommendations_of_observation",
+         "SELECT id, text FROM Recommendations WHERE observation_id = 1"},
+    };
+    return queries;
+}
+
+
+QVector<Issue> run(SQLiteDb& db, bool printPlans)
+{
+    // "SCAN Points" / "SCAN TABLE Points" (старые версии SQLite) без индекса.
+    // Обход виртуальной таблицы (R*Tree) и обход по индексу ради ORDER BY ... LIMIT допустимы.
+    static const QRegularExpression fullScan(R"(^SCAN (TABLE )?\w+( AS \w+)?$)");
+
+    // Параметры запроса (:name, но не время вида '00:00:00'); план от значений не зависит
+    static const QRegularExpression placeholder(R"((?<![\w:']):([A-Za-z_]\w*))");
+
+    QVector<Issue> issues;
+
+    for (const HotQuery& q : hotQueries()) {
+        QVariantMap binds;
+        for (auto it = placeholder.globalMatch(q.sql); it.hasNext();) {
+            binds.insert(it.next().captured(0), 1);
+        }
+
+        QStringList details;
+        if (db.explainQueryPlan(q.sql, details, binds) != StatusCode::SUCCESS) {
+            issues.append({q.name, "EXPLAIN QUERY PLAN failed"});
+            continue;
+        }
+
+        for (const QString& detail : std::as_const(details)) {
+            if (printPlans) {
+                qInfo().noquote() << q.name << ":" << detail;
+            }
+            if (fullScan.match(detail).hasMatch()) {
+                issues.append({q.name, detail});
+            }
+        }
+    }
+
+    return issues;
+}
+
+}
@@ -0,0 +1,32 @@
+#ifndef QUERYPLANCHECK_H
+#define QUERYPLANCHECK_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class SQLiteDb;
+
+// Проверка планов горячих запросов: ни один не должен читать таблицу целиком.
+// Запускается на пустой БД со свежей схемой (AgroDbBench --check-plans),
+// так что удалённый или переименованный индекс сразу виден.
+namespace QueryPlanCheck {
+
+struct HotQuery {
+    QString name;
+    QString sql;    // текст из места вызова; параметрам :name при проверке привязывается 1
+};
+
+struct Issue {
+    QString queryName;
+    QString detail;   // строка плана с полным сканированием
+};
+
+const QVector<HotQuery>& hotQueries();
+
+// Пустой результат — все планы используют индексы
+QVector<Issue> run(SQLiteDb& db, bool printPlans = false);
+
+}
+
+#endif // QUERYPLANCHECK_H
@@ -0,0 +1,467 @@
+#include "retentionengine.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QSqlError>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int MIN_BATCH_ROWS = 8;
+const int MAX_BATCH_ROWS = 4096;
+
+// За шаг просматривается не больше batchRows * SCAN_FACTOR id: строки без блобов
+// или чужих сессий не должны растягивать один шаг на всю таблицу
+const int SCAN_FACTOR = 8;
+
+// Таблица, к которой можно применить политику.
+// cascade — удаление зависимых строк (%1 — список id), childBlobs — их JSON со ссылками на блобы
+struct TableInfo {
+    QString name;
+    QString jsonColumn;
+    QString sessionExpr;
+    QString childBlobs;
+    QStringList cascade;
+};
+
+const QVector<TableInfo>& tables()
+{
+    static const QVector<TableInfo> list = {
+        {"Points", "data_json", "+session_id",
+         "SELECT m.results_json FROM ML_results m JOIN Observations o ON o.id = m.observation_id "
+         "WHERE o.point_id IN (%1)",
+         {"DELETE FROM Recommendations WHERE observation_id IN (SELECT id FROM Observations WHERE point_id IN (%1))",
+          "DELETE FROM ML_results WHERE observation_id IN (SELECT id FROM Observations WHERE point_id IN (%1))",
+          "DELETE FROM Observations WHERE point_id IN (%1)"}},
+
+        {"Observations", QString(), "(SELECT p.session_id FROM Points p WHERE p.id = Observations.point_id)",
+         "SELECT results_json FROM ML_results WHERE observation_id IN (%1)",
+         {"DELETE FROM Recommendations WHERE observation_id IN (%1)",
+          "DELETE FROM ML_results WHERE observation_id IN (%1)"}},
+
+        {"ML_results", "results_json",
+         "(SELECT p.session_id FROM Observations o JOIN Points p ON p.id = o.point_id "
+         "WHERE o.id = ML_results.observation_id)",
+         QString(), {}},
+
+        {"Recommendations", QString(),
+         "(SELECT p.session_id FROM Observations o JOIN Points p ON p.id = o.point_id "
+         "WHERE o.id = Recommendations.observation_id)",
+         QString(), {}},
+
+        {"ML_cache", "results_json", QString(), QString(), {}},
+    };
+    return list;
+}
+
+const TableInfo* tableInfo(const QString& name)
+{
+    for (const TableInfo& info : tables()) {
+        if (info.name == name) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+QString actionName(RetentionPolicy::Action action)
+{
+    return action == RetentionPolicy::Action::DeleteRows ? "delete_rows" : "drop_blobs";
+}
+
+bool isValid(const RetentionPolicy& policy)
+{
+    const TableInfo* info = tableInfo(policy.tableName);
+    if (!info || policy.maxAgeDays < 0) {
+        return false;
+    }
+    if (policy.action == RetentionPolicy::Action::DropBlobs && info->jsonColumn.isEmpty()) {
+        return false;
+    }
+    return policy.sessionId < 0 || !info->sessionExpr.isEmpty();
+}
+
+QJsonObject parseJson(const QByteArray& json)
+{
+    return QJsonDocument::fromJson(json).object();
+}
+
+// Снимает ссылки на блобы из JSON; файлы удалит collectGarbage()
+void releaseBlobs(BlobStore& blobs, const QJsonObject& json)
+{
+    for (const QString& hash : BlobStore::blobRefs(json)) {
+        blobs.release(hash);
+    }
+}
+}
+
+
+RetentionEngine::RetentionEngine(SQLiteDb* db, QObject* parent)
+    : QObject(parent), db(db)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, [this] {
+        timer.start(runStep() ? Config::RETENTION_TICK_MS : Config::RETENTION_IDLE_MS);
+    });
+}
+
+
+StatusCode RetentionEngine::addPolicy(const RetentionPolicy& policy, int* insertedId)
+{
+    if (!isValid(policy)) {
+        qWarning() << LogMsg::DB_RETENTION_BAD_POLICY << policy.tableName << actionName(policy.action);
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    return db->exec(
+        "INSERT INTO Retention_policies (table_name, action, max_age_days, session_id) "
+        "VALUES (:table, :action, :days, :session)",
+        {{":table", policy.tableName},
+         {":action", actionName(policy.action)},
+         {":days", policy.maxAgeDays},
+         {":session", policy.sessionId >= 0 ? QVariant(policy.sessionId) : QVariant()}},
+        insertedId);
+}
+
+
+StatusCode RetentionEngine::removePolicy(int policyId)
+{
+    return db->exec("DELETE FROM Retention_policies WHERE id = :id", {{":id", policyId}});
+}
+
+
+QVector<RetentionPolicy> RetentionEngine::policies()
+{
+    QVector<RetentionPolicy> out;
+
+    db->forEachRow(
+        "SELECT id, table_name, action, max_age_days, session_id, last_id FROM Retention_policies ORDER BY id",
+        [&out](const SqlCursor& row) {
+            RetentionPolicy policy;
+            policy.id = row.toInt(0);
+            policy.tableName = row.toString(1);
+            policy.action = row.toString(2) == "delete_rows" ? RetentionPolicy::Action::DeleteRows
+                                                             : RetentionPolicy::Action::DropBlobs;
+            policy.maxAgeDays = row.toInt(3);
+            policy.sessionId = row.isNull(4) ? -1 : row.toInt(4);
+            policy.lastId = row.toInt64(5);
+            out.append(policy);
+            return true;
+        });
+
+    return out;
+}
+
+
+void RetentionEngine::start()
+{
+    timer.start(0);
+}
+
+
+void RetentionEngine::stop()
+{
+    timer.stop();
+}
+
+
+void RetentionEngine::beginCycle()
+{
+    inCycle = true;
+    phase = Phase::Policies;
+    cyclePolicies = policies();
+    policyIndex = 0;
+    rowsProcessed = 0;
+    pagesFreed = 0;
+}
+
+
+void RetentionEngine::finishCycle()
+{
+    inCycle = false;
+    if (rowsProcessed > 0 || pagesFreed > 0) {
+        qDebug() << LogMsg::DB_RETENTION_CYCLE << rowsProcessed << pagesFreed;
+    }
+    emit cycleFinished(rowsProcessed, pagesFreed);
+}
+
+
+bool RetentionEngine::runStep()
+{
+    if (!inCycle) {
+        beginCycle();
+    }
+
+    switch (phase) {
+    case Phase::Policies:
+        if (policyIndex >= cyclePolicies.size()) {
+            phase = Phase::Blobs;
+        }
+        else if (!policyStep(cyclePolicies[policyIndex])) {
+            ++policyIndex;
+        }
+        return true;
+
+    case Phase::Blobs:
+        if (db->blobStore().collectGarbage(Config::RETENTION_GC_BATCH) < Config::RETENTION_GC_BATCH) {
+            phase = Phase::Vacuum;
+        }
+        return true;
+
+    case Phase::Vacuum:
+        if (vacuumStep()) {
+            return true;
+        }
+        finishCycle();
+        return false;
+    }
+    return false;
+}
+
+
+QString RetentionEngine::youngRowQuery(const QString& tableName)
+{
+    const TableInfo* info = tableInfo(tableName);
+    if (!info) {
+        return QString();
+    }
+    return QString("SELECT rowid FROM %1 WHERE created_at >= :cutoff ORDER BY created_at LIMIT 1").arg(info->name);
+}
+
+
+QString RetentionEngine::batchQuery(const QString& tableName, bool bySession, bool dropBlobs)
+{
+    const TableInfo* info = tableInfo(tableName);
+    if (!info) {
+        return QString();
+    }
+
+    // Унарный плюс убирает индексы по времени и сессии из выбора планировщика:
+    // нужен обход по диапазону rowid, ограниченный окном, а не по всем старым строкам сессии
+    QString where = "rowid > :after AND rowid <= :end AND +created_at < :cutoff";
+    if (bySession) {
+        where += QString(" AND %1 = :session").arg(info->sessionExpr);
+    }
+    if (dropBlobs) {
+        where += QString(" AND instr(%1, '_blob\"') > 0").arg(info->jsonColumn);
+    }
+
+    return QString("SELECT rowid, %1 FROM %2 WHERE %3 ORDER BY rowid LIMIT :limit")
+        .arg(info->jsonColumn.isEmpty() ? "NULL" : info->jsonColumn, info->name, where);
+}
+
+
+bool RetentionEngine::policyStep(RetentionPolicy& policy)
+{
+    const TableInfo* info = tableInfo(policy.tableName);
+    if (!info || !isValid(policy)) {
+        qWarning() << LogMsg::DB_RETENTION_BAD_POLICY << policy.tableName << actionName(policy.action);
+        return false;
+    }
+
+    const bool dropBlobs = policy.action == RetentionPolicy::Action::DropBlobs;
+    const QString cutoff = QDateTime::currentDateTimeUtc().addDays(-policy.maxAgeDays)
+                               .toString("yyyy-MM-dd HH:mm:ss");
+
+    // Граница по индексу created_at: первая строка моложе порога. id растут вместе со временем
+    // создания, поэтому дальше неё искать нечего
+    qint64 bound = std::numeric_limits<qint64>::max();
+    {
+        SqlCursor young = db->select(youngRowQuery(info->name), {{":cutoff", cutoff}});
+        if (young.next()) {
+            bound = young.toInt64(0);
+        }
+        else {
+            young.close();
+            SqlCursor last = db->select(QString("SELECT IFNULL(MAX(rowid), 0) + 1 FROM %1").arg(info->name));
+            if (!last.next()) {
+                return false;
+            }
+            bound = last.toInt64(0);
+        }
+    }
+
+    if (policy.lastId >= bound - 1) {
+        return false;
+    }
+
+    const qint64 windowEnd = std::min(bound - 1, policy.lastId + qint64(batchRows) * SCAN_FACTOR);
+
+    QVariantMap binds = {{":after", policy.lastId}, {":end", windowEnd}, {":cutoff", cutoff}, {":limit", batchRows}};
+    if (policy.sessionId >= 0) {
+        binds.insert(":session", policy.sessionId);
+    }
+
+    QVector<qint64> ids;
+    QVector<QByteArray> jsons;
+    {
+        SqlCursor rows = db->select(batchQuery(info->name, policy.sessionId >= 0, dropBlobs), binds);
+        while (rows.next()) {
+            ids.append(rows.toInt64(0));
+            jsons.append(rows.toBytes(1));
+        }
+        if (rows.status() != StatusCode::SUCCESS) {
+            return false;
+        }
+    }
+
+    // Пачка заполнена — продолжим с последней строки, иначе окно просмотрено целиком
+    const qint64 nextId = ids.size() == batchRows ? ids.last() : windowEnd;
+
+    QSqlDatabase conn = QSqlDatabase::database(db->connectionName(), false);
+    QElapsedTimer lockTimer;
+    lockTimer.start();
+
+    if (!conn.transaction()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << conn.lastError().text();
+        return false;
+    }
+
+    StatusCode st = StatusCode::SUCCESS;
+    BlobStore& blobs = db->blobStore();
+
+    if (dropBlobs) {
+        QSqlQuery update(conn);
+        update.prepare(QString("UPDATE %1 SET %2 = :json WHERE rowid = :id").arg(info->name, info->jsonColumn));
+
+        for (int i = 0; i < ids.size() && st == StatusCode::SUCCESS; ++i) {
+            const QJsonObject json = parseJson(jsons[i]);
+            releaseBlobs(blobs, json);
+
+            update.bindValue(":json", QString(QJsonDocument(BlobStore::withoutBlobs(json)).toJson(QJsonDocument::Compact)));
+            update.bindValue(":id", ids[i]);
+            if (!update.exec()) {
+                qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << update.lastError().text();
+                st = StatusCode::DB_QUERY_FAILED;
+            }
+        }
+    }
+    else if (!ids.isEmpty()) {
+        // id — целые из самой БД, подставляются в текст списком
+        QStringList idList;
+        idList.reserve(ids.size());
+        for (qint64 id : std::as_const(ids)) {
+            idList.append(QString::number(id));
+        }
+        const QString in = idList.join(',');
+
+        for (const QByteArray& json : std::as_const(jsons)) {
+            releaseBlobs(blobs, parseJson(json));
+        }
+        if (!info->childBlobs.isEmpty()) {
+            st = db->forEachRow(info->childBlobs.arg(in), [&blobs](const SqlCursor& row) {
+                releaseBlobs(blobs, parseJson(row.toBytes(0)));
+                return true;
+            });
+        }
+
+        for (const QString& sql : info->cascade) {
+            if (st == StatusCode::SUCCESS) {
+                st = db->exec(sql.arg(in));
+            }
+        }
+        if (st == StatusCode::SUCCESS) {
+            st = db->exec(QString("DELETE FROM %1 WHERE rowid IN (%2)").arg(info->name, in));
+        }
+    }
+
+    if (st == StatusCode::SUCCESS && policy.id >= 0) {
+        st = db->exec("UPDATE Retention_policies SET last_id = :last WHERE id = :id",
+                      {{":last", nextId}, {":id", policy.id}});
+    }
+
+    if (st != StatusCode::SUCCESS || !conn.commit()) {
+        conn.rollback();
+        return false;
+    }
+
+    adaptBatch(lockTimer.elapsed());
+    rowsProcessed += ids.size();
+    policy.lastId = nextId;
+    return nextId < bound - 1;
+}
+
+
+// PRAGMA incremental_vacuum(N) освобождает по одной странице за sqlite3_step, а QSqlQuery::exec
+// делает один шаг. Поэтому страницы возвращаются вызовами incremental_vacuum(1) в одной
+// транзакции, пока не выйдет бюджет времени шага
+bool RetentionEngine::vacuumStep()
+{
+    QSqlDatabase conn = QSqlDatabase::database(db->connectionName(), false);
+    QSqlQuery query(conn);
+
+    if (incrementalVacuum < 0) {
+        incrementalVacuum = query.exec("PRAGMA auto_vacuum") && query.next() && query.value(0).toInt() == 2;
+        if (!incrementalVacuum) {
+            qWarning() << LogMsg::DB_AUTOVACUUM_OFF << db->connectionName();
+        }
+    }
+    if (!incrementalVacuum) {
+        return false;
+    }
+
+    if (!query.exec("PRAGMA freelist_count") || !query.next()) {
+        return false;
+    }
+    const qint64 freePages = query.value(0).toLongLong();
+    query.finish();
+
+    if (freePages == 0) {
+        return false;
+    }
+
+    QElapsedTimer lockTimer;
+    lockTimer.start();
+
+    if (!conn.transaction()) {
+        return false;
+    }
+
+    query.prepare("PRAGMA incremental_vacuum(1)");
+
+    qint64 freed = 0;
+    const qint64 limit = std::min<qint64>(freePages, Config::RETENTION_VACUUM_PAGES);
+    while (freed < limit && lockTimer.elapsed() < Config::RETENTION_STEP_BUDGET_MS) {
+        if (!query.exec()) {
+            qWarning() << LogMsg::DB_PRAGMA_FAILED << "incremental_vacuum" << query.lastError().text();
+            break;
+        }
+        ++freed;
+    }
+    query.finish();
+
+    if (!conn.commit()) {
+        conn.rollback();
+        return false;
+    }
+
+    pagesFreed += freed;
+    return freed > 0 && freed < freePages;
+}
+
+
+void RetentionEngine::adaptBatch(qint64 elapsedMs)
+{
+    if (elapsedMs > Config::RETENTION_STEP_BUDGET_MS) {
+        batchRows = std::max(MIN_BATCH_ROWS, batchRows / 2);
+    }
+    else if (elapsedMs * 4 < Config::RETENTION_STEP_BUDGET_MS) {
+        batchRows = std::min(MAX_BATCH_ROWS, batchRows * 2);
+    }
+}
+
+
+StatusCode RetentionEngine::enableIncrementalVacuum(SQLiteDb& db)
+{
+    // Режим auto_vacuum у БД с таблицами меняется только полным VACUUM
+    StatusCode st = db.exec("PRAGMA auto_vacuum = INCREMENTAL");
+    if (st == StatusCode::SUCCESS) {
+        st = db.exec("VACUUM");
+    }
+    return st;
+}
@@ -0,0 +1,97 @@
+#ifndef RETENTIONENGINE_H
+#define RETENTIONENGINE_H
+
+#include "sqlitedb.h"
+#include "statuscodes.h"
+#include "config.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+// Политика хранения: что делать со строками таблицы старше maxAgeDays
+struct RetentionPolicy {
+    enum class Action {
+        DropBlobs,    // убрать из JSON ссылки на изображения и маски (*_blob), строку оставить
+        DeleteRows,   // удалить строки вместе с зависимыми (точка → наблюдения → ML результаты)
+    };
+
+    int id = -1;
+    QString tableName;        // Points, Observations, ML_results, Recommendations, ML_cache
+    Action action = Action::DropBlobs;
+    int maxAgeDays = 30;
+    int sessionId = -1;       // -1 — все сессии
+    qint64 lastId = 0;        // строки с id не больше уже просмотрены
+};
+
+
+// Фоновая очистка по политикам хранения (таблица Retention_policies) и возврат места
+// через PRAGMA incremental_vacuum.
+//
+// Работает маленькими шагами по таймеру в потоке писателя: каждый шаг — отдельная
+// транзакция, размер пачки подстраивается так, чтобы блокировка записи держалась
+// не дольше Config::RETENTION_STEP_BUDGET_MS. Между шагами вставки идут как обычно.
+//
+// Цикл: политики по очереди → сборка мусора в хранилище блобов → incremental_vacuum.
+// Прогресс политики (последний просмотренный id) хранится в таблице, так что после
+// перезапуска уже обработанные строки заново не читаются.
+class RetentionEngine : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RetentionEngine(SQLiteDb* db, QObject* parent = nullptr);
+
+    StatusCode addPolicy(const RetentionPolicy& policy, int* insertedId = nullptr);
+    StatusCode removePolicy(int policyId);
+    QVector<RetentionPolicy> policies();
+
+    // Запуск по таймеру: шаги через Config::RETENTION_TICK_MS, циклы через Config::RETENTION_IDLE_MS
+    void start();
+    void stop();
+    bool isActive() const { return timer.isActive(); }
+
+    // Один шаг цикла; false — цикл закончен
+    bool runStep();
+
+    // Перевод существующей БД на auto_vacuum=INCREMENTAL: полный VACUUM, файл переписывается
+    // целиком. Для обслуживания при остановленном приёме данных, не для фона
+    static StatusCode enableIncrementalVacuum(SQLiteDb& db);
+
+    // Запросы шага политики (их же проверяет QueryPlanCheck); пустая строка — таблица не поддерживается.
+    // Первая строка моложе :cutoff
+    static QString youngRowQuery(const QString& tableName);
+    // Пачка строк окна (:after, :end], старше :cutoff, не больше :limit; bySession — ещё и :session
+    static QString batchQuery(const QString& tableName, bool bySession, bool dropBlobs);
+
+signals:
+    void cycleFinished(qint64 rowsProcessed, qint64 pagesFreed);
+
+private:
+    enum class Phase { Policies, Blobs, Vacuum };
+
+    SQLiteDb* db;
+    QTimer timer;
+
+    bool inCycle = false;
+    Phase phase = Phase::Policies;
+    QVector<RetentionPolicy> cyclePolicies;
+    int policyIndex = 0;
+    int batchRows = Config::RETENTION_BATCH_ROWS;
+    qint64 rowsProcessed = 0;
+    qint64 pagesFreed = 0;
+    int incrementalVacuum = -1;   // -1 — ещё не проверяли PRAGMA auto_vacuum
+
+    void beginCycle();
+    void finishCycle();
+
+    // Шаг политики; false — строк для неё больше нет
+    bool policyStep(RetentionPolicy& policy);
+    bool vacuumStep();
+
+    // Меньше пачку, если шаг вышел за бюджет, больше — если уложился с запасом
+    void adaptBatch(qint64 elapsedMs);
+};
+
+#endif // RETENTIONENGINE_H
@@ -0,0 +1,317 @@
+#include "shardeddb.h"
+#include "config.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+const QString CATALOG_FILE = "catalog.db";
+const QString SESSIONS_DIR = "sessions";
+const QString ARCHIVE_DIR = "archive";
+
+const QString STATE_ACTIVE = "active";
+const QString STATE_ARCHIVED = "archived";
+
+QString schemaName(int sessionId)
+{
+    return QString("s%1").arg(sessionId);
+}
+}
+
+
+ShardedDb::ShardedDb() {}
+
+ShardedDb::~ShardedDb()
+{
+    close();
+}
+
+
+StatusCode ShardedDb::open(const QString& rootDir)
+{
+    close();
+
+    if (!QDir().mkpath(QDir(rootDir).filePath(SESSIONS_DIR)) || !QDir().mkpath(QDir(rootDir).filePath(ARCHIVE_DIR))) {
+        qWarning() << statusToMessage(StatusCode::DB_INIT_FAILED) << rootDir;
+        return StatusCode::DB_INIT_FAILED;
+    }
+
+    dir = rootDir;
+    catalogDb = std::make_unique<SQLiteDb>("agro_catalog");
+
+    StatusCode st = catalogDb->connect(QDir(dir).filePath(CATALOG_FILE));
+    if (st != StatusCode::SUCCESS) {
+        catalogDb.reset();
+        dir.clear();
+    }
+    return st;
+}
+
+
+void ShardedDb::close()
+{
+    openShards.clear();
+    catalogDb.reset();
+    dir.clear();
+}
+
+
+QString ShardedDb::sessionPath(int sessionId, bool archived) const
+{
+    return QDir(dir).filePath(QString("%1/%2.db").arg(archived ? ARCHIVE_DIR : SESSIONS_DIR).arg(sessionId));
+}
+
+
+QString ShardedDb::shardState(int sessionId)
+{
+    QString state;
+    catalogDb->forEachRow("SELECT state FROM Session_shards WHERE session_id = :id",
+                          [&state](const SqlCursor& row) {
+                              state = row.toString(0);
+                              return false;
+                          },
+                          {{":id", sessionId}});
+    return state;
+}
+
+// -------------------- Сессии --------------------
+
+StatusCode ShardedDb::createSession(const QString& description, int& sessionId)
+{
+    sessionId = -1;
+    if (!catalogDb) {
+        return StatusCode::DB_CONNECTION_FAILED;
+    }
+
+    int id = -1;
+    StatusCode st = catalogDb->addSession(description, &id);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    auto shard = std::make_unique<SQLiteDb>(QString("agro_shard_%1").arg(id));
+    shard->setCatalog(catalogDb.get());
+    st = shard->connect(sessionPath(id, false));
+    if (st == StatusCode::SUCCESS) {
+        st = catalogDb->exec("INSERT INTO Session_shards (session_id, file_name) VALUES (:id, :file)",
+                             {{":id", id}, {":file", QFileInfo(sessionPath(id, false)).fileName()}});
+    }
+
+    if (st != StatusCode::SUCCESS) {
+        shard.reset();
+        QFile::remove(sessionPath(id, false));
+        catalogDb->exec("DELETE FROM Sessions WHERE id = :id", {{":id", id}});
+        return st;
+    }
+
+    openShards[id] = std::move(shard);
+    sessionId = id;
+    qDebug() << LogMsg::DB_SESSION_CREATED << id;
+    return StatusCode::SUCCESS;
+}
+
+
+SQLiteDb* ShardedDb::session(int sessionId)
+{
+    auto it = openShards.find(sessionId);
+    if (it != openShards.end()) {
+        return it->second.get();
+    }
+
+    if (!catalogDb || shardState(sessionId) != STATE_ACTIVE) {
+        qWarning() << statusToMessage(StatusCode::DB_SESSION_NOT_FOUND) << sessionId;
+        return nullptr;
+    }
+
+    auto shard = std::make_unique<SQLiteDb>(QString("agro_shard_%1").arg(sessionId));
+    shard->setCatalog(catalogDb.get());
+    if (shard->connect(sessionPath(sessionId, false)) != StatusCode::SUCCESS) {
+        return nullptr;
+    }
+
+    SQLiteDb* db = shard.get();
+    openShards[sessionId] = std::move(shard);
+    return db;
+}
+
+
+void ShardedDb::closeSession(int sessionId)
+{
+    // Закрытие последнего соединения переносит WAL в основной файл и удаляет -wal/-shm
+    openShards.erase(sessionId);
+}
+
+
+QVector<int> ShardedDb::sessionIds(bool includeArchived)
+{
+    QVector<int> ids;
+    if (!catalogDb) {
+        return ids;
+    }
+
+    catalogDb->forEachRow(
+        includeArchived ? "SELECT session_id FROM Session_shards ORDER BY session_id"
+                        : "SELECT session_id FROM Session_shards WHERE state = 'active' ORDER BY session_id",
+        [&ids](const SqlCursor& row) {
+            ids.append(row.toInt(0));
+            return true;
+        });
+    return ids;
+}
+
+// -------------------- Архив --------------------
+
+// Файл БД вместе с WAL и каталогом блобов. Переносится всё или ничего: если одно из
+// переименований не удалось, уже перенесённые части возвращаются на место
+StatusCode ShardedDb::moveShard(const QString& from, const QString& to)
+{
+    if (!QFile::exists(from)) {
+        qWarning() << statusToMessage(StatusCode::FILE_NOT_FOUND) << from;
+        return StatusCode::FILE_NOT_FOUND;
+    }
+
+    QStringList moved;   // суффиксы уже перенесённых частей
+    for (const QString& suffix : {QString(), QString("-wal"), QString("-shm"), QString(".blobs")}) {
+        if (!suffix.isEmpty() && !QFileInfo::exists(from + suffix)) {
+            continue;
+        }
+
+        if (QDir().rename(from + suffix, to + suffix)) {
+            moved.append(suffix);
+            continue;
+        }
+
+        qWarning() << statusToMessage(StatusCode::FILE_MOVE_FAILED) << from + suffix << "->" << to + suffix;
+        for (auto it = moved.crbegin(); it != moved.crend(); ++it) {
+            if (!QDir().rename(to + *it, from + *it)) {
+                qWarning() << statusToMessage(StatusCode::FILE_MOVE_FAILED) << to + *it << "->" << from + *it;
+            }
+        }
+        return StatusCode::FILE_MOVE_FAILED;
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode ShardedDb::archiveSession(int sessionId)
+{
+    if (!catalogDb || shardState(sessionId) != STATE_ACTIVE) {
+        qWarning() << statusToMessage(StatusCode::DB_SESSION_NOT_FOUND) << sessionId;
+        return StatusCode::DB_SESSION_NOT_FOUND;
+    }
+
+    closeSession(sessionId);
+
+    StatusCode st = moveShard(sessionPath(sessionId, false), sessionPath(sessionId, true));
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    qDebug() << LogMsg::DB_SESSION_ARCHIVED << sessionId;
+    return catalogDb->exec(
+        "UPDATE Session_shards SET state = :state, archived_at = CURRENT_TIMESTAMP WHERE session_id = :id",
+        {{":state", STATE_ARCHIVED}, {":id", sessionId}});
+}
+
+
+StatusCode ShardedDb::restoreSession(int sessionId)
+{
+    if (!catalogDb || shardState(sessionId) != STATE_ARCHIVED) {
+        qWarning() << statusToMessage(StatusCode::DB_SESSION_NOT_FOUND) << sessionId;
+        return StatusCode::DB_SESSION_NOT_FOUND;
+    }
+
+    StatusCode st = moveShard(sessionPath(sessionId, true), sessionPath(sessionId, false));
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    return catalogDb->exec(
+        "UPDATE Session_shards SET state = :state, archived_at = NULL WHERE session_id = :id",
+        {{":state", STATE_ACTIVE}, {":id", sessionId}});
+}
+
+
+StatusCode ShardedDb::dropSession(int sessionId)
+{
+    const QString state = catalogDb ? shardState(sessionId) : QString();
+    if (state.isEmpty()) {
+        qWarning() << statusToMessage(StatusCode::DB_SESSION_NOT_FOUND) << sessionId;
+        return StatusCode::DB_SESSION_NOT_FOUND;
+    }
+
+    closeSession(sessionId);
+
+    const QString path = sessionPath(sessionId, state == STATE_ARCHIVED);
+    QFile::remove(path);
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+    QDir(path + ".blobs").removeRecursively();
+
+    StatusCode st = catalogDb->exec("DELETE FROM Session_shards WHERE session_id = :id", {{":id", sessionId}});
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+    return catalogDb->exec("DELETE FROM Sessions WHERE id = :id", {{":id", sessionId}});
+}
+
+// -------------------- Запросы по нескольким сессиям --------------------
+
+StatusCode ShardedDb::crossSession(const QVector<int>& ids, const CrossSessionQuery& query)
+{
+    if (!catalogDb) {
+        return StatusCode::DB_CONNECTION_FAILED;
+    }
+
+    for (int begin = 0; begin < ids.size(); begin += Config::SHARD_ATTACH_BATCH) {
+        const int end = std::min<int>(int(ids.size()), begin + Config::SHARD_ATTACH_BATCH);
+        QStringList schemas;
+
+        StatusCode st = StatusCode::SUCCESS;
+        for (int i = begin; i < end && st == StatusCode::SUCCESS; ++i) {
+            const QString state = shardState(ids[i]);
+            if (state.isEmpty()) {
+                qWarning() << statusToMessage(StatusCode::DB_SESSION_NOT_FOUND) << ids[i];
+                continue;
+            }
+
+            // Имя схемы — из id, его нельзя передать параметром; путь передаётся параметром
+            st = catalogDb->exec(QString("ATTACH DATABASE :file AS %1").arg(schemaName(ids[i])),
+                                 {{":file", sessionPath(ids[i], state == STATE_ARCHIVED)}});
+            if (st == StatusCode::SUCCESS) {
+                schemas.append(schemaName(ids[i]));
+            }
+        }
+
+        if (st == StatusCode::SUCCESS && !schemas.isEmpty()) {
+            st = query(*catalogDb, schemas);
+        }
+
+        for (const QString& schema : std::as_const(schemas)) {
+            catalogDb->exec(QString("DETACH DATABASE %1").arg(schema));
+        }
+
+        if (st != StatusCode::SUCCESS) {
+            return st;
+        }
+    }
+
+    return StatusCode::SUCCESS;
+}
+
+
+QString ShardedDb::unionAll(const QString& selectTemplate, const QStringList& schemas)
+{
+    QStringList parts;
+    parts.reserve(schemas.size());
+    for (const QString& schema : schemas) {
+        parts.append(selectTemplate.arg(schema));
+    }
+    return parts.join(" UNION ALL ");
+}
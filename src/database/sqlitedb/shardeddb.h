@@ -0,0 +1,74 @@
+#ifndef SHARDEDDB_H
+#define SHARDEDDB_H
+
+#include "sqlitedb.h"
+#include "statuscodes.h"
+#include "config.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+// Каждая сессия — отдельный файл БД, плюс каталог для общих данных.
+//
+//   <dir>/catalog.db           — Sessions, Session_shards, Sensor_specs, ML_cache
+//   <dir>/sessions/<id>.db     — точки, наблюдения, ML результаты одной сессии (и <id>.db.blobs)
+//   <dir>/archive/<id>.db      — архивные сессии
+//
+// Файл сессии создаётся с полной схемой, но Sessions в нём пуста, а id спецификаций выдаёт
+// каталог (SQLiteDb::setCatalog): в Sensor_specs сессии — копии использованных строк
+// с теми же id, так что Points.spec_id совпадает с каталогом. ML_cache — только в каталоге.
+//
+// Живая сессия маленькая и целиком помещается в кэш страниц, индексы неглубокие.
+// Архивирование и удаление сессии — перемещение или удаление файла вместо DELETE + VACUUM.
+// Запросы по нескольким сессиям подключают их файлы к каталогу через ATTACH.
+class ShardedDb {
+public:
+    // Схемы подключённых сессий: "s<id>", в SQL — s12.Points и т.п.
+    using CrossSessionQuery = std::function<StatusCode(SQLiteDb& catalog, const QStringList& schemas)>;
+
+    ShardedDb();
+    ~ShardedDb();
+
+    StatusCode open(const QString& dir = Config::SHARD_ROOT_DIR);
+    void close();
+
+    SQLiteDb* catalog() { return catalogDb.get(); }
+
+    // Новая сессия: строка в каталоге и свой файл
+    StatusCode createSession(const QString& description, int& sessionId);
+
+    // БД сессии (открывается при первом обращении); nullptr — нет такой или она в архиве.
+    // Через неё пишет Manager (Manager::setSession с тем же id).
+    // Указатель действителен до closeSession / archiveSession / dropSession / close
+    SQLiteDb* session(int sessionId);
+    void closeSession(int sessionId);
+
+    StatusCode archiveSession(int sessionId);
+    StatusCode restoreSession(int sessionId);
+    StatusCode dropSession(int sessionId);
+
+    QVector<int> sessionIds(bool includeArchived = false);
+
+    // Подключает файлы сессий к каталогу пачками (ATTACH ограничен Config::SHARD_ATTACH_BATCH)
+    // и вызывает query для каждой пачки; после неё файлы отключаются
+    StatusCode crossSession(const QVector<int>& sessionIds, const CrossSessionQuery& query);
+
+    // "SELECT ... FROM %1.Points ..." → тот же запрос по всем схемам через UNION ALL
+    static QString unionAll(const QString& selectTemplate, const QStringList& schemas);
+
+private:
+    QString dir;
+    std::unique_ptr<SQLiteDb> catalogDb;
+    std::unordered_map<int, std::unique_ptr<SQLiteDb>> openShards;
+
+    QString sessionPath(int sessionId, bool archived) const;
+    QString shardState(int sessionId);
+    StatusCode moveShard(const QString& from, const QString& to);
+};
+
+#endif // SHARDEDDB_H
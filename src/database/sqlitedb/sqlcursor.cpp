@@ -0,0 +1,100 @@
+#include "sqlcursor.h"
+
+#include <QSqlRecord>
+
+#include <algorithm>
+
+
+SqlCursor::SqlCursor(QSqlQuery query, StatusCode code, int prefetch)
+    : query(std::move(query)), code(code), prefetch(std::max(0, prefetch))
+{
+    if (code != StatusCode::SUCCESS) {
+        return;
+    }
+
+    const QSqlRecord rec = this->query.record();
+    columns = rec.count();
+    names.reserve(columns);
+    for (int i = 0; i < columns; ++i) {
+        names.append(rec.fieldName(i));
+    }
+
+    if (this->prefetch > 0) {
+        buffer.resize(this->prefetch * columns);
+    }
+}
+
+
+bool SqlCursor::next()
+{
+    if (code != StatusCode::SUCCESS || exhausted) {
+        return false;
+    }
+
+    if (prefetch == 0) {
+        if (!query.next()) {
+            close();
+            return false;
+        }
+        ++rows;
+        return true;
+    }
+
+    if (++bufferPos >= bufferedRows && !fillBuffer()) {
+        close();
+        return false;
+    }
+    ++rows;
+    return true;
+}
+
+
+bool SqlCursor::fillBuffer()
+{
+    bufferedRows = 0;
+    bufferPos = 0;
+
+    while (bufferedRows < prefetch && query.next()) {
+        QVariant* dst = buffer.data() + bufferedRows * columns;
+        for (int i = 0; i < columns; ++i) {
+            dst[i] = query.value(i);
+        }
+        ++bufferedRows;
+    }
+
+    return bufferedRows > 0;
+}
+
+
+void SqlCursor::close()
+{
+    exhausted = true;
+    query.finish();
+}
+
+
+int SqlCursor::column(const QString& name) const
+{
+    return int(names.indexOf(name));
+}
+
+
+QString SqlCursor::columnName(int col) const
+{
+    return names.value(col);
+}
+
+
+QVariant SqlCursor::value(int col) const
+{
+    if (col < 0 || col >= columns) {
+        return QVariant();
+    }
+    if (prefetch == 0) {
+        return query.value(col);
+    }
+    if (bufferPos < 0 || bufferPos >= bufferedRows) {
+        return QVariant();
+    }
+    return buffer.at(bufferPos * columns + col);
+}
@@ -0,0 +1,71 @@
+#ifndef SQLCURSOR_H
+#define SQLCURSOR_H
+
+#include "statuscodes.h"
+
+#include <QByteArray>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+// Однонаправленный курсор по результату SELECT.
+//
+// Строки читаются по одной прямо из подготовленного запроса, поэтому память
+// не растёт с размером результата. Индексы колонок берутся один раз через
+// column(), дальше значения читаются по индексу типизированными методами.
+//
+// prefetch > 0 — строки забираются пачками в переиспользуемый буфер
+// (prefetch строк), и запрос не держит позицию между пачками дольше нужного.
+//
+// Курсор привязан к соединению SQLiteDb и должен быть закрыт до disconnect().
+class SqlCursor {
+public:
+    SqlCursor() = default;
+    SqlCursor(QSqlQuery query, StatusCode code, int prefetch = 0);
+
+    SqlCursor(const SqlCursor&) = delete;
+    SqlCursor& operator=(const SqlCursor&) = delete;
+    SqlCursor(SqlCursor&&) = default;
+    SqlCursor& operator=(SqlCursor&&) = default;
+
+    StatusCode status() const { return code; }
+    bool isValid() const { return code == StatusCode::SUCCESS; }
+
+    // Переход к следующей строке; false — строки кончились или ошибка
+    bool next();
+    void close();
+
+    int columnCount() const { return columns; }
+    int column(const QString& name) const;   // -1 — нет такой колонки
+    QString columnName(int col) const;
+
+    bool isNull(int col) const { return value(col).isNull(); }
+    int toInt(int col) const { return value(col).toInt(); }
+    qint64 toInt64(int col) const { return value(col).toLongLong(); }
+    double toDouble(int col) const { return value(col).toDouble(); }
+    QString toString(int col) const { return value(col).toString(); }
+    QByteArray toBytes(int col) const { return value(col).toByteArray(); }
+    QVariant value(int col) const;
+
+    qint64 rowsRead() const { return rows; }
+
+private:
+    QSqlQuery query;
+    StatusCode code = StatusCode::DB_QUERY_FAILED;
+    QStringList names;
+    int columns = 0;
+    qint64 rows = 0;
+
+    // Буфер пачки: prefetch строк по columns значений подряд
+    int prefetch = 0;
+    QVector<QVariant> buffer;
+    int bufferedRows = 0;
+    int bufferPos = -1;
+    bool exhausted = false;
+
+    bool fillBuffer();
+};
+
+#endif // SQLCURSOR_H
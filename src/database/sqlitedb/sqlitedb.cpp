@@ -1,30 +1,50 @@
 #include "sqlitedb.h"
+#include "contenthash.h"
 #include "logmessages.h"
 #include "statusmapper.h"
 #include "config.h"
+#include "migrations.h"
+#include "sqlqueries.h"
 
 
 #include <QSqlError>
-#include <QFile>
-#include <QTextStream>
 #include <QRegularExpression>
 #include <QDebug>
 #include <QSqlRecord>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QJsonValue>
+#include <QJsonArray>
+#include <QDateTime>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
 
 
 
-SQLiteDb::SQLiteDb() {}
+
+SQLiteDb::SQLiteDb(const QString& connectionName, bool readOnly)
+    : name(connectionName), readOnly(readOnly)
+{}
 
 SQLiteDb::~SQLiteDb() {
     disconnect();
+
+    // Соединение больше никому не нужно — убираем его из реестра Qt
+    db = QSqlDatabase();
+    if (QSqlDatabase::contains(name)) {
+        QSqlDatabase::removeDatabase(name);
+    }
 }
 
 void SQLiteDb::disconnect()
 {
+    // Запросы держат ссылки на соединение — освобождаем до закрытия
+    statements.clear();
+    blobs.close();
+
     if (db.isOpen()) {
         db.close();
         qDebug() << LogMsg::DB_DISCONNECTED;
@@ -34,22 +54,39 @@ void SQLiteDb::disconnect()
 StatusCode SQLiteDb::connect(const QString &connectionInfo)
 {
     try {
-        if (QSqlDatabase::contains(Config::DB_CONNECTION_NAME)){
-            db = QSqlDatabase::database(Config::DB_CONNECTION_NAME);
+        statements.clear();
+
+        if (QSqlDatabase::contains(name)){
+            db = QSqlDatabase::database(name, false);
         }
         else {
-            db = QSqlDatabase::addDatabase("QSQLITE", Config::DB_CONNECTION_NAME);
+            db = QSqlDatabase::addDatabase("QSQLITE", name);
         }
 
         db.setDatabaseName(connectionInfo);
 
+        // Писатель держит блокировку недолго (WAL), поэтому ждём её, а не падаем с "database is locked"
+        QString options = QString("QSQLITE_BUSY_TIMEOUT=%1").arg(Config::DB_BUSY_TIMEOUT_MS);
+        if (readOnly) {
+            options += ";QSQLITE_OPEN_READONLY";
+        }
+        db.setConnectOptions(options);
+
         if (!db.open()) {
             qWarning() << LogMsg::DB_CONNECT_FAILED << db.lastError().text();
             return StatusCode::DB_CONNECTION_FAILED;
         }
 
         qDebug() << LogMsg::DB_CONNECTED;
-        return initDatabase();
+        applyProfile();
+
+        StatusCode st = readOnly ? initReader() : initDatabase();
+        if (st == StatusCode::SUCCESS && Config::BLOB_STORE_ENABLED && connectionInfo != ":memory:") {
+            if (blobs.open(connectionInfo + ".blobs", db) == StatusCode::SUCCESS) {
+                qDebug() << LogMsg::BLOB_STORE_OPENED << connectionInfo + ".blobs";
+            }
+        }
+        return st;
     }
     catch (...) {
         qWarning() << statusToMessage(StatusCode::UNKNOWN_ERROR);
@@ -58,59 +95,85 @@ StatusCode SQLiteDb::connect(const QString &connectionInfo)
 }
 
 
-// Вспомогательная функция для выполнения команды с логированием
-bool SQLiteDb::createTable(QSqlQuery &query, const QString &sql, const QString &tableName)
+// PRAGMA профиля производительности. Ошибка отдельной PRAGMA не мешает работе —
+// БД просто остаётся с настройкой SQLite по умолчанию.
+void SQLiteDb::applyProfile()
 {
-    if (!query.exec(sql)) {
-        qWarning() << "Ошибка создания таблицы" << tableName << ":" << query.lastError().text();
-        return false;
+    QStringList pragmas = {
+        QString("PRAGMA mmap_size=%1").arg(profile.mmapSize),
+        QString("PRAGMA cache_size=-%1").arg(profile.cacheSizeKb),
+        QString("PRAGMA temp_store=%1").arg(profile.tempStore),
+    };
+
+    // Режим журнала и checkpoint — забота писателя; читатель только запрещает себе запись
+    if (readOnly) {
+        pragmas << "PRAGMA query_only=1";
+    }
+    else {
+        // auto_vacuum действует только на новую БД (до первой таблицы и до включения WAL);
+        // у существующей — RetentionEngine::enableIncrementalVacuum
+        pragmas << "PRAGMA auto_vacuum=INCREMENTAL"
+                << QString("PRAGMA journal_mode=%1").arg(profile.journalMode)
+                << QString("PRAGMA synchronous=%1").arg(profile.synchronous)
+                << QString("PRAGMA wal_autocheckpoint=%1").arg(profile.walAutocheckpoint);
     }
-    return true;
-}
 
+    QSqlQuery query(db);
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qWarning() << LogMsg::DB_PRAGMA_FAILED << pragma << query.lastError().text();
+        }
+    }
 
+    // journal_mode возвращает режим, который реально включился (у :memory: WAL не бывает)
+    if (query.exec("PRAGMA journal_mode") && query.next()) {
+        qDebug() << LogMsg::DB_PROFILE_APPLIED << profile.name << query.value(0).toString();
+    }
+}
 
 
+// Схема встроена в программу (Migrations): для актуальной БД здесь нет ни одного DDL
 StatusCode SQLiteDb::initDatabase()
 {
-    QFile file(Config::DB_SCHEMA_PATH);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << statusToMessage(StatusCode::DB_INIT_FAILED);
-        return StatusCode::DB_INIT_FAILED;
+    StatusCode st = Migrations::migrate(db);
+    if (st != StatusCode::SUCCESS) {
+        return st;
     }
 
-    QTextStream in(&file);
-    QString sql = in.readAll();
-    file.close();
+    detectSpatialIndex();
+    loadSensorFields();
+    loadSpecIds();
 
-    QSqlQuery query(db);
-
-    QStringList commands = sql.split(';', Qt::SkipEmptyParts);
-
-    for (QString cmd : commands) {
-        cmd = cmd.trimmed();
-        if (cmd.isEmpty()){
-            continue;
-        }
+    qDebug() << LogMsg::DB_INIT_SUCCESS;
+    return StatusCode::SUCCESS;
+}
 
-        // Получаем имя таблицы для логирования
-        QString tableName;
-        QRegularExpression re(R"(CREATE TABLE IF NOT EXISTS\s+['\"\[]?([\w_]+)['\"\]]?)",
-                              QRegularExpression::CaseInsensitiveOption);
-        QRegularExpressionMatch match = re.match(cmd);
-        tableName = match.hasMatch() ? match.captured(1) : "unknown";
 
-        if (!createTable(query, cmd, tableName)) {
-            qWarning() << statusToMessage(StatusCode::DB_TABLE_CREATE_FAILED) << tableName;
-            return StatusCode::DB_TABLE_CREATE_FAILED;
-        }
+StatusCode SQLiteDb::initReader()
+{
+    if (Migrations::currentVersion(db) <= 0) {
+        qWarning() << statusToMessage(StatusCode::DB_INIT_FAILED);
+        return StatusCode::DB_INIT_FAILED;
     }
 
-    qDebug() << LogMsg::DB_INIT_SUCCESS;
+    detectSpatialIndex();
+    loadSensorFields();
     return StatusCode::SUCCESS;
 }
 
 
+// R*Tree создаётся миграцией; его может не быть, если SQLite собран без модуля rtree
+void SQLiteDb::detectSpatialIndex()
+{
+    QSqlQuery query(db);
+    hasSpatialIndex = query.exec("SELECT 1 FROM sqlite_master WHERE name = 'Points_rtree'") && query.next();
+
+    if (!hasSpatialIndex && !readOnly) {
+        qWarning() << LogMsg::DB_RTREE_UNAVAILABLE;
+    }
+}
+
+
 SQLResult SQLiteDb::executeSQL(const QString &queryText)
 {
     SQLResult result;
@@ -123,6 +186,7 @@ SQLResult SQLiteDb::executeSQL(const QString &queryText)
     }
 
     QSqlQuery query(db);
+    query.setForwardOnly(true);
 
     if (!query.exec(queryText)) {
         qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
@@ -130,14 +194,21 @@ SQLResult SQLiteDb::executeSQL(const QString &queryText)
         return result;
     }
 
+    // Результат целиком в памяти — для больших выборок есть select()
     if (queryText.trimmed().startsWith("SELECT", Qt::CaseInsensitive)) {
         QVector<QVariantMap> rows;
 
+        const QSqlRecord rec = query.record();
+        const int columns = rec.count();
+        QStringList names;
+        for (int i = 0; i < columns; ++i) {
+            names.append(rec.fieldName(i));
+        }
+
         while (query.next()) {
             QVariantMap row;
-            QSqlRecord rec = query.record();
-            for (int i = 0; i < rec.count(); ++i) {
-                row.insert(rec.fieldName(i), query.value(i));
+            for (int i = 0; i < columns; ++i) {
+                row.insert(names.at(i), query.value(i));
             }
             rows.append(row);
         }
@@ -147,6 +218,59 @@ SQLResult SQLiteDb::executeSQL(const QString &queryText)
     return result;
 }
 
+
+SqlCursor SQLiteDb::select(const QString& sql, const QVariantMap& binds, int prefetch)
+{
+    // Отдельный запрос, а не из кэша: курсоров по одному SQL может быть открыто несколько
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    if (!query.prepare(sql)) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return SqlCursor(query, StatusCode::DB_QUERY_FAILED);
+    }
+
+    for (auto it = binds.cbegin(); it != binds.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
+
+    StatusCode st = execQuery(query);
+    return SqlCursor(query, st, prefetch);
+}
+
+
+StatusCode SQLiteDb::exec(const QString& sql, const QVariantMap& binds, int* insertedId)
+{
+    QSqlQuery query(db);
+
+    if (!query.prepare(sql)) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    for (auto it = binds.cbegin(); it != binds.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
+
+    return execInsert(query, insertedId);
+}
+
+
+StatusCode SQLiteDb::forEachRow(const QString& sql, const std::function<bool(const SqlCursor&)>& visit,
+                                const QVariantMap& binds)
+{
+    SqlCursor cursor = select(sql, binds);
+
+    while (cursor.next()) {
+        if (!visit(cursor)) {
+            break;
+        }
+    }
+
+    cursor.close();
+    return cursor.status();
+}
+
 // -------------------- Основные функции добавления --------------------
 
 
@@ -160,20 +284,74 @@ StatusCode SQLiteDb::execQuery(QSqlQuery &query, StatusCode errCode)
 }
 
 
-StatusCode SQLiteDb::addSession(const QString& description)
+// Выполняет INSERT и сразу отдаёт id новой строки.
+// lastInsertId() драйвера QSQLITE берёт sqlite3_last_insert_rowid() без отдельного запроса.
+StatusCode SQLiteDb::execInsert(QSqlQuery &query, int* insertedId)
+{
+    StatusCode st = execQuery(query);
+    if (insertedId) {
+        *insertedId = st == StatusCode::SUCCESS ? query.lastInsertId().toInt() : -1;
+    }
+    return st;
+}
+
+
+// Вставка в Points с номером записи журнала: при повторе той же записи строка не добавляется,
+// insertedId получает id уже сохранённой точки
+StatusCode SQLiteDb::execPointInsert(QSqlQuery &query, quint64 journalSeq, int* insertedId)
 {
+    StatusCode st = execInsert(query, insertedId);
+    if (st != StatusCode::SUCCESS || journalSeq == 0 || query.numRowsAffected() > 0) {
+        return st;
+    }
+
+    QSqlQuery& existing = preparedQuery("SELECT id FROM Points WHERE journal_seq = :journal_seq");
+    existing.bindValue(":journal_seq", qint64(journalSeq));
+    if (!existing.exec() || !existing.next()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << existing.lastError().text();
+        if (insertedId) {
+            *insertedId = -1;
+        }
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    if (insertedId) {
+        *insertedId = existing.value(0).toInt();
+    }
+    existing.finish();
+    return StatusCode::JOURNAL_ALREADY_APPLIED;
+}
+
+
+// Подготовленные запросы живут всё время подключения: SQL разбирается один раз,
+// дальше меняются только параметры
+QSqlQuery& SQLiteDb::preparedQuery(const QString& sql)
+{
+    auto it = statements.find(sql);
+    if (it != statements.end()) {
+        return it->second;
+    }
+
     QSqlQuery query(db);
-    query.prepare("INSERT INTO Sessions (description) VALUES (:description)");
+    if (!query.prepare(sql)) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+    }
+    return statements.emplace(sql, query).first->second;
+}
+
+
+StatusCode SQLiteDb::addSession(const QString& description, int* insertedId)
+{
+    QSqlQuery& query = preparedQuery("INSERT INTO Sessions (description) VALUES (:description)");
     query.bindValue(":description", description);
 
-    return execQuery(query);
+    return execInsert(query, insertedId);
 }
 
 
-StatusCode SQLiteDb::addField(const QString& name, const QJsonObject& boundary, int sessionId)
+StatusCode SQLiteDb::addField(const QString& name, const QJsonObject& boundary, int sessionId, int* insertedId)
 {
-    QSqlQuery query(db);
-    query.prepare(
+    QSqlQuery& query = preparedQuery(
         "INSERT INTO Fields (name, boundary_json, session_id) "
         "VALUES (:name, :boundary, :session_id)"
         );
@@ -182,74 +360,219 @@ StatusCode SQLiteDb::addField(const QString& name, const QJsonObject& boundary,
     query.bindValue(":boundary", QString(QJsonDocument(boundary).toJson(QJsonDocument::Compact)));
     query.bindValue(":session_id", sessionId);
 
-    return execQuery(query);
+    return execInsert(query, insertedId);
 }
 
 
-StatusCode SQLiteDb::addSensorSpec(const QJsonObject& spec)
+StatusCode SQLiteDb::addSensorSpec(const QJsonObject& spec, int* insertedId)
 {
-    QSqlQuery query(db);
-    query.prepare(
-        "INSERT INTO Sensor_specs (spec_json) VALUES (:spec_json)"
+    // Роботы шлют спецификацию при каждом переподключении — обычно она уже есть
+    const QString hash = specHash(spec);
+    auto known = specIds.constFind(hash);
+    if (known != specIds.constEnd()) {
+        if (insertedId) {
+            *insertedId = known.value();
+        }
+        return StatusCode::SUCCESS;
+    }
+
+    // Могла записать другая программа с этой же БД
+    QSqlQuery& find = preparedQuery("SELECT id FROM Sensor_specs WHERE spec_hash = :hash");
+    find.bindValue(":hash", hash);
+    if (execQuery(find) == StatusCode::SUCCESS && find.next()) {
+        const int id = find.value(0).toInt();
+        find.finish();
+        specIds.insert(hash, id);
+        if (insertedId) {
+            *insertedId = id;
+        }
+        return StatusCode::SUCCESS;
+    }
+    find.finish();
+
+    // id выдаёт каталог; строка с тем же id остаётся и здесь, чтобы файл сессии
+    // читался (воспроизведение, выгрузка) и без каталога
+    int specId = -1;
+    if (catalog) {
+        StatusCode st = catalog->addSensorSpec(spec, &specId);
+        if (st != StatusCode::SUCCESS) {
+            if (insertedId) {
+                *insertedId = -1;
+            }
+            return st;
+        }
+    }
+
+    QSqlQuery& query = preparedQuery(
+        "INSERT INTO Sensor_specs (id, spec_json, spec_hash) VALUES (:id, :spec_json, :spec_hash)"
         );
 
+    query.bindValue(":id", specId > 0 ? QVariant(specId) : QVariant());
     query.bindValue(":spec_json", QString(QJsonDocument(spec).toJson(QJsonDocument::Compact)));
+    query.bindValue(":spec_hash", hash);
 
-    return execQuery(query);
+    StatusCode st = catalog ? execQuery(query) : execInsert(query, &specId);
+    if (insertedId) {
+        *insertedId = st == StatusCode::SUCCESS ? specId : -1;
+    }
+
+    if (st == StatusCode::SUCCESS) {
+        specIds.insert(hash, specId);
+        materializeSpecFields(spec, specId);
+    }
+    return st;
 }
 
 
-StatusCode SQLiteDb::addPoint(int fieldId, int sessionId, double latitude, double longitude, const QJsonObject& data)
+QString SQLiteDb::specHash(const QJsonObject& spec)
 {
-    QSqlQuery query(db);
-    query.prepare(
-        "INSERT INTO Points (field_id, session_id, latitude, longitude, data_json) "
-        "VALUES (:field_id, :session_id, :lat, :lon, :data_json)"
+    // QJsonObject хранит ключи упорядоченными, так что порядок полей в сообщении не важен
+    return ContentHash::toHex(ContentHash::hash64(QJsonDocument(spec).toJson(QJsonDocument::Compact), 0));
+}
+
+
+StatusCode SQLiteDb::addPoint(int fieldId, int sessionId, double latitude, double longitude, const QJsonObject& data,
+                              int specId, int* insertedId, quint64 journalSeq)
+{
+    QSqlQuery& query = preparedQuery(
+        "INSERT INTO Points (field_id, session_id, spec_id, latitude, longitude, data_json, journal_seq) "
+        "VALUES (:field_id, :session_id, :spec_id, :lat, :lon, :data_json, :journal_seq) "
+        "ON CONFLICT(journal_seq) WHERE journal_seq IS NOT NULL DO NOTHING"
         );
 
     query.bindValue(":field_id", fieldId);
     query.bindValue(":session_id", sessionId);
+    query.bindValue(":spec_id", specId > 0 ? QVariant(specId) : QVariant());
     query.bindValue(":lat", latitude);
     query.bindValue(":lon", longitude);
-    query.bindValue(":data_json", QString(QJsonDocument(data).toJson(QJsonDocument::Compact)));
+    query.bindValue(":journal_seq", journalSeq > 0 ? QVariant(qint64(journalSeq)) : QVariant());
 
-    return execQuery(query);
+    // Точка, её блобы и вклад в агрегаты фиксируются вместе
+    const bool ownTransaction = db.transaction();
+
+    query.bindValue(":data_json", QString(QJsonDocument(blobs.externalize(data)).toJson(QJsonDocument::Compact)));
+
+    StatusCode st = execPointInsert(query, journalSeq, insertedId);
+    if (st == StatusCode::SUCCESS) {
+        st = updateRollups(sessionId, latitude, longitude, data, QDateTime::currentSecsSinceEpoch());
+    }
+
+    // Повтор записи журнала: точка уже есть, ссылки на блобы этой попытки не нужны
+    if (st == StatusCode::JOURNAL_ALREADY_APPLIED) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return st;
+    }
+
+    if (ownTransaction) {
+        if (st != StatusCode::SUCCESS || !db.commit()) {
+            db.rollback();
+            if (insertedId) {
+                *insertedId = -1;
+            }
+            return StatusCode::DB_QUERY_FAILED;
+        }
+    }
+    return st;
 }
 
 
-StatusCode SQLiteDb::addObservation(int pointId)
+// Байты сообщения идут в data_json как есть (блобы вырезаются на месте), числа для агрегатов
+// берутся из разметки полей — ни разбора в QJsonObject, ни сериализации обратно
+StatusCode SQLiteDb::addPointRaw(int fieldId, int sessionId, double latitude, double longitude,
+                                 const RawJson::Document& data, int specId, int* insertedId,
+                                 quint64 journalSeq)
 {
-    QSqlQuery query(db);
-    query.prepare(
+    QSqlQuery& query = preparedQuery(
+        "INSERT INTO Points (field_id, session_id, spec_id, latitude, longitude, data_json, journal_seq) "
+        "VALUES (:field_id, :session_id, :spec_id, :lat, :lon, :data_json, :journal_seq) "
+        "ON CONFLICT(journal_seq) WHERE journal_seq IS NOT NULL DO NOTHING"
+        );
+
+    query.bindValue(":field_id", fieldId);
+    query.bindValue(":session_id", sessionId);
+    query.bindValue(":spec_id", specId > 0 ? QVariant(specId) : QVariant());
+    query.bindValue(":lat", latitude);
+    query.bindValue(":lon", longitude);
+    query.bindValue(":journal_seq", journalSeq > 0 ? QVariant(qint64(journalSeq)) : QVariant());
+
+    const bool ownTransaction = db.transaction();
+
+    // Текстом, а не QByteArray: BLOB в data_json не читается функциями json_*
+    query.bindValue(":data_json", QString::fromUtf8(blobs.externalize(data)));
+
+    StatusCode st = execPointInsert(query, journalSeq, insertedId);
+    if (st == StatusCode::SUCCESS) {
+        st = updateRollups(sessionId, latitude, longitude, data, QDateTime::currentSecsSinceEpoch());
+    }
+
+    // Повтор записи журнала: точка уже есть, ссылки на блобы этой попытки не нужны
+    if (st == StatusCode::JOURNAL_ALREADY_APPLIED) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return st;
+    }
+
+    if (ownTransaction) {
+        if (st != StatusCode::SUCCESS || !db.commit()) {
+            db.rollback();
+            if (insertedId) {
+                *insertedId = -1;
+            }
+            return StatusCode::DB_QUERY_FAILED;
+        }
+    }
+    return st;
+}
+
+
+StatusCode SQLiteDb::addObservation(int pointId, int* insertedId)
+{
+    QSqlQuery& query = preparedQuery(
         "INSERT INTO Observations (point_id) VALUES (:point_id)"
         );
 
     query.bindValue(":point_id", pointId);
 
-    return execQuery(query);
+    return execInsert(query, insertedId);
 }
 
 
-StatusCode SQLiteDb::addMLResult(int observationId, const QString& moduleName, const QJsonObject& result)
+StatusCode SQLiteDb::addMLResult(int observationId, const QString& moduleName, const QJsonObject& result, int* insertedId)
 {
-    QSqlQuery query(db);
-    query.prepare(
+    QSqlQuery& query = preparedQuery(
         "INSERT INTO ML_results (observation_id, module_name, results_json) "
         "VALUES (:obs, :module, :json)"
         );
 
     query.bindValue(":obs", observationId);
     query.bindValue(":module", moduleName);
-    query.bindValue(":json", QString(QJsonDocument(result).toJson(QJsonDocument::Compact)));
 
-    return execQuery(query);
+    // Маски уходят в хранилище блобов в той же транзакции, что и результат
+    const bool ownTransaction = db.transaction();
+
+    query.bindValue(":json", QString(QJsonDocument(blobs.externalize(result)).toJson(QJsonDocument::Compact)));
+
+    StatusCode st = execInsert(query, insertedId);
+
+    if (ownTransaction) {
+        if (st != StatusCode::SUCCESS || !db.commit()) {
+            db.rollback();
+            if (insertedId) {
+                *insertedId = -1;
+            }
+            return StatusCode::DB_QUERY_FAILED;
+        }
+    }
+    return st;
 }
 
 
-StatusCode SQLiteDb::addRecommendation(int observationId, const QString& text)
+StatusCode SQLiteDb::addRecommendation(int observationId, const QString& text, int* insertedId)
 {
-    QSqlQuery query(db);
-    query.prepare(
+    QSqlQuery& query = preparedQuery(
         "INSERT INTO Recommendations (observation_id, text) "
         "VALUES (:obs, :text)"
         );
@@ -257,10 +580,834 @@ StatusCode SQLiteDb::addRecommendation(int observationId, const QString& text)
     query.bindValue(":obs", observationId);
     query.bindValue(":text", text);
 
+    return execInsert(query, insertedId);
+}
+
+
+// -------------------- Поля сенсоров --------------------
+
+void SQLiteDb::loadSensorFields()
+{
+    sensorColumns.clear();
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT name, column_name FROM Sensor_fields")) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return;
+    }
+    while (query.next()) {
+        sensorColumns.insert(query.value(0).toString(), query.value(1).toString());
+    }
+}
+
+
+// Карта хеш → id для дедупликации. Строкам, записанным до появления spec_hash, хеш
+// проставляется здесь; повторы старых спецификаций (хеш уже занят) остаются без хеша
+void SQLiteDb::loadSpecIds()
+{
+    specIds.clear();
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT id, spec_json, spec_hash FROM Sensor_specs ORDER BY id")) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return;
+    }
+
+    QVector<QPair<int, QString>> missing;
+    while (query.next()) {
+        const int id = query.value(0).toInt();
+        const QString hash = query.value(2).isNull()
+            ? specHash(QJsonDocument::fromJson(query.value(1).toByteArray()).object())
+            : query.value(2).toString();
+
+        if (specIds.contains(hash)) {
+            continue;
+        }
+        specIds.insert(hash, id);
+        if (query.value(2).isNull()) {
+            missing.append({id, hash});
+        }
+    }
+    query.finish();
+
+    if (missing.isEmpty()) {
+        return;
+    }
+
+    const bool ownTransaction = db.transaction();
+    query.prepare("UPDATE Sensor_specs SET spec_hash = :hash WHERE id = :id");
+    for (const auto& row : std::as_const(missing)) {
+        query.bindValue(":hash", row.second);
+        query.bindValue(":id", row.first);
+        execQuery(query);
+    }
+    if (ownTransaction && !db.commit()) {
+        db.rollback();
+    }
+}
+
+
+// Поля спецификации выносятся из data_json в генерируемые колонки Points с индексами.
+// Формат: "fields": ["temperature", {"name": "soil_ph", "type": "float", "indexed": true}, ...]
+// Колонка VIRTUAL, а не STORED: ALTER TABLE умеет добавлять только VIRTUAL,
+// а индекс всё равно хранит вычисленное значение, так что выборки по нему json не разбирают.
+void SQLiteDb::materializeSpecFields(const QJsonObject& spec, int specId)
+{
+    static const QRegularExpression validName("^[A-Za-z][A-Za-z0-9_]{0,62}$");
+
+    const QJsonArray fields = spec.value("fields").toArray();
+
+    for (const QJsonValue& value : fields) {
+        QString name;
+        QString type = "REAL";
+        bool indexed = true;
+
+        if (value.isString()) {
+            name = value.toString();
+        }
+        else {
+            const QJsonObject field = value.toObject();
+            name = field.value("name").toString();
+            indexed = field.value("indexed").toBool(true);
+
+            const QString t = field.value("type").toString().toLower();
+            if (t == "int" || t == "integer" || t == "bool") {
+                type = "INTEGER";
+            }
+            else if (t == "string" || t == "text") {
+                type = "TEXT";
+            }
+        }
+
+        if (!indexed || sensorColumns.contains(name)) {
+            continue;
+        }
+
+        // Имя попадает в текст DDL — пропускаем только безопасные идентификаторы
+        if (!validName.match(name).hasMatch()) {
+            qWarning() << LogMsg::DB_BAD_SENSOR_FIELD << name;
+            continue;
+        }
+
+        addSensorColumn(name, type, specId);
+    }
+}
+
+
+StatusCode SQLiteDb::addSensorColumn(const QString& name, const QString& sqlType, int specId)
+{
+    const QString column = "s_" + name.toLower();
+
+    const QStringList statements = {
+        QString("ALTER TABLE Points ADD COLUMN %1 %2 "
+                "GENERATED ALWAYS AS (json_extract(data_json, '$.%3')) VIRTUAL").arg(column, sqlType, name),
+        QString("CREATE INDEX IF NOT EXISTS idx_points_%1 ON Points(%1)").arg(column),
+        QString("CREATE INDEX IF NOT EXISTS idx_points_session_%1 ON Points(session_id, %1)").arg(column),
+    };
+
+    // DDL в SQLite транзакционна: колонка, индексы и запись в Sensor_fields — всё или ничего
+    const bool ownTransaction = db.transaction();
+
+    QSqlQuery query(db);
+    for (const QString& sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << statusToMessage(StatusCode::DB_TABLE_CREATE_FAILED) << column << query.lastError().text();
+            if (ownTransaction) {
+                db.rollback();
+            }
+            return StatusCode::DB_TABLE_CREATE_FAILED;
+        }
+    }
+
+    query.prepare("INSERT INTO Sensor_fields (name, column_name, sql_type, spec_id) "
+                  "VALUES (:name, :column, :type, :spec)");
+    query.bindValue(":name", name);
+    query.bindValue(":column", column);
+    query.bindValue(":type", sqlType);
+    query.bindValue(":spec", specId);
+
+    if (execQuery(query) != StatusCode::SUCCESS || (ownTransaction && !db.commit())) {
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    sensorColumns.insert(name, column);
+    qDebug() << LogMsg::DB_SENSOR_FIELD_ADDED << name << "->" << column;
+    return StatusCode::SUCCESS;
+}
+
+
+// Точки со значением поля в [min, max]; sessionId < 0 — по всем сессиям (например, за сезон)
+StatusCode SQLiteDb::sensorRange(int sessionId, const QString& field, double min, double max,
+                                 QVector<PointRecord>& out, int limit)
+{
+    out.clear();
+
+    const QString column = sensorColumns.value(field);
+    if (column.isEmpty()) {
+        qWarning() << LogMsg::DB_UNKNOWN_SENSOR_FIELD << field;
+        return StatusCode::DB_UNKNOWN_SENSOR_FIELD;
+    }
+
+    QSqlQuery& query = preparedQuery(QString(
+        "SELECT id, session_id, latitude, longitude, data_json FROM Points "
+        "WHERE %1 %2 BETWEEN :min AND :max LIMIT :limit")
+        .arg(sessionId >= 0 ? "session_id = :session AND" : "", column));
+
+    if (sessionId >= 0) {
+        query.bindValue(":session", sessionId);
+    }
+    query.bindValue(":min", min);
+    query.bindValue(":max", max);
+    query.bindValue(":limit", limit);
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    while (query.next()) {
+        PointRecord rec;
+        rec.id = query.value(0).toInt();
+        rec.sessionId = query.value(1).toInt();
+        rec.latitude = query.value(2).toDouble();
+        rec.longitude = query.value(3).toDouble();
+        rec.dataJson = query.value(4).toByteArray();
+        out.append(rec);
+    }
+
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode SQLiteDb::sensorAggregate(int sessionId, const QString& field, SensorAggregate& out)
+{
+    out = SensorAggregate();
+
+    const QString column = sensorColumns.value(field);
+    if (column.isEmpty()) {
+        qWarning() << LogMsg::DB_UNKNOWN_SENSOR_FIELD << field;
+        return StatusCode::DB_UNKNOWN_SENSOR_FIELD;
+    }
+
+    QSqlQuery& query = preparedQuery(QString(
+        "SELECT COUNT(%1), MIN(%1), MAX(%1), AVG(%1), AVG(%1 * %1) FROM Points %2")
+        .arg(column, sessionId >= 0 ? "WHERE session_id = :session" : ""));
+
+    if (sessionId >= 0) {
+        query.bindValue(":session", sessionId);
+    }
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    if (query.next()) {
+        out.count = query.value(0).toLongLong();
+        out.min = query.value(1).toDouble();
+        out.max = query.value(2).toDouble();
+        out.mean = query.value(3).toDouble();
+        out.variance = std::max(0.0, query.value(4).toDouble() - out.mean * out.mean);
+    }
+
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+// -------------------- Агрегаты (rollup) --------------------
+
+namespace {
+// Числовые поля верхнего уровня data_json, кроме координат
+bool isRollupField(const QString& key, const QJsonValue& value)
+{
+    return value.isDouble() && key != "latitude" && key != "longitude";
+}
+
+qint64 timeBucket(qint64 timeSec)
+{
+    return timeSec - timeSec % Config::ROLLUP_BUCKET_SEC;
+}
+
+qint64 spatialCell(double degrees)
+{
+    return qint64(std::floor(degrees / Config::ROLLUP_CELL_DEG));
+}
+
+void bindRollupValue(QSqlQuery& query, double v)
+{
+    query.bindValue(":min", v);
+    query.bindValue(":max", v);
+    query.bindValue(":sum", v);
+    query.bindValue(":sum_sq", v * v);
+}
+
+// floor() для SQL: математические функции SQLite есть не во всех сборках
+QString sqlFloor(const QString& expr)
+{
+    return QString("(CAST(%1 AS INTEGER) - (%1 < CAST(%1 AS INTEGER)))").arg(expr);
+}
+
+void readRollup(const QSqlQuery& query, int col, SensorAggregate& agg)
+{
+    agg.count = query.value(col).toLongLong();
+    agg.min = query.value(col + 1).toDouble();
+    agg.max = query.value(col + 2).toDouble();
+
+    const double sum = query.value(col + 3).toDouble();
+    const double sumSq = query.value(col + 4).toDouble();
+    if (agg.count > 0) {
+        agg.mean = sum / agg.count;
+        agg.variance = std::max(0.0, sumSq / agg.count - agg.mean * agg.mean);
+    }
+}
+}
+
+
+// Вклад точки в агрегаты по времени и по ячейкам; вызывается в транзакции вставки точки
+StatusCode SQLiteDb::updateRollups(int sessionId, double latitude, double longitude,
+                                   const QJsonObject& data, qint64 timeSec)
+{
+    QVector<QPair<QString, double>> values;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (isRollupField(it.key(), it.value())) {
+            values.append({it.key(), it.value().toDouble()});
+        }
+    }
+    return updateRollupValues(sessionId, latitude, longitude, values, timeSec);
+}
+
+
+StatusCode SQLiteDb::updateRollups(int sessionId, double latitude, double longitude,
+                                   const RawJson::Document& data, qint64 timeSec)
+{
+    QVector<QPair<QString, double>> values;
+    for (const RawJson::Field& f : data.fields()) {
+        if (f.kind != RawJson::Kind::Number
+            || data.keyIs(f, QLatin1String("latitude")) || data.keyIs(f, QLatin1String("longitude"))) {
+            continue;
+        }
+        values.append({data.key(f), data.number(f)});
+    }
+    return updateRollupValues(sessionId, latitude, longitude, values, timeSec);
+}
+
+
+StatusCode SQLiteDb::updateRollupValues(int sessionId, double latitude, double longitude,
+                                        const QVector<QPair<QString, double>>& values, qint64 timeSec)
+{
+    QSqlQuery& byTime = preparedQuery(
+        "INSERT INTO Rollup_time (session_id, field, bucket, count, min, max, sum, sum_sq) "
+        "VALUES (:session_id, :field, :bucket, 1, :min, :max, :sum, :sum_sq) "
+        "ON CONFLICT(session_id, field, bucket) DO UPDATE SET "
+        "count = count + 1, min = MIN(min, excluded.min), max = MAX(max, excluded.max), "
+        "sum = sum + excluded.sum, sum_sq = sum_sq + excluded.sum_sq");
+
+    QSqlQuery& byCell = preparedQuery(
+        "INSERT INTO Rollup_cell (session_id, field, cell_y, cell_x, count, min, max, sum, sum_sq) "
+        "VALUES (:session_id, :field, :cell_y, :cell_x, 1, :min, :max, :sum, :sum_sq) "
+        "ON CONFLICT(session_id, field, cell_y, cell_x) DO UPDATE SET "
+        "count = count + 1, min = MIN(min, excluded.min), max = MAX(max, excluded.max), "
+        "sum = sum + excluded.sum, sum_sq = sum_sq + excluded.sum_sq");
+
+    const qint64 bucket = timeBucket(timeSec);
+    const qint64 cellY = spatialCell(latitude);
+    const qint64 cellX = spatialCell(longitude);
+
+    for (const auto& value : values) {
+        const double v = value.second;
+
+        byTime.bindValue(":session_id", sessionId);
+        byTime.bindValue(":field", value.first);
+        byTime.bindValue(":bucket", bucket);
+        bindRollupValue(byTime, v);
+
+        byCell.bindValue(":session_id", sessionId);
+        byCell.bindValue(":field", value.first);
+        byCell.bindValue(":cell_y", cellY);
+        byCell.bindValue(":cell_x", cellX);
+        bindRollupValue(byCell, v);
+
+        if (execQuery(byTime) != StatusCode::SUCCESS || execQuery(byCell) != StatusCode::SUCCESS) {
+            return StatusCode::DB_QUERY_FAILED;
+        }
+    }
+
+    return StatusCode::SUCCESS;
+}
+
+
+// Пересчёт агрегатов сессии по Points — для данных, записанных до появления rollup-таблиц
+StatusCode SQLiteDb::rebuildRollups(int sessionId)
+{
+    const QStringList statements = {
+        "DELETE FROM Rollup_time WHERE session_id = :session_id",
+        "DELETE FROM Rollup_cell WHERE session_id = :session_id",
+
+        QString("INSERT INTO Rollup_time (session_id, field, bucket, count, min, max, sum, sum_sq) "
+                "SELECT p.session_id, j.key, "
+                "CAST(strftime('%s', p.created_at) AS INTEGER) / %1 * %1 AS bucket, "
+                "COUNT(*), MIN(j.value), MAX(j.value), SUM(j.value), SUM(j.value * j.value) "
+                "FROM Points p, json_each(p.data_json) j "
+                "WHERE p.session_id = :session_id AND j.type IN ('integer', 'real') "
+                "AND j.key NOT IN ('latitude', 'longitude') "
+                "GROUP BY j.key, bucket").arg(Config::ROLLUP_BUCKET_SEC),
+
+        QString("INSERT INTO Rollup_cell (session_id, field, cell_y, cell_x, count, min, max, sum, sum_sq) "
+                "SELECT p.session_id, j.key, %1 AS cell_y, %2 AS cell_x, "
+                "COUNT(*), MIN(j.value), MAX(j.value), SUM(j.value), SUM(j.value * j.value) "
+                "FROM Points p, json_each(p.data_json) j "
+                "WHERE p.session_id = :session_id AND j.type IN ('integer', 'real') "
+                "AND j.key NOT IN ('latitude', 'longitude') "
+                "GROUP BY j.key, cell_y, cell_x")
+            .arg(sqlFloor(QString("(p.latitude / %1)").arg(Config::ROLLUP_CELL_DEG, 0, 'g', 17)),
+                 sqlFloor(QString("(p.longitude / %1)").arg(Config::ROLLUP_CELL_DEG, 0, 'g', 17))),
+    };
+
+    const bool ownTransaction = db.transaction();
+
+    QSqlQuery query(db);
+    for (const QString& sql : statements) {
+        query.prepare(sql);
+        query.bindValue(":session_id", sessionId);
+        if (execQuery(query) != StatusCode::SUCCESS) {
+            if (ownTransaction) {
+                db.rollback();
+            }
+            return StatusCode::DB_QUERY_FAILED;
+        }
+    }
+
+    if (ownTransaction && !db.commit()) {
+        db.rollback();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+    return StatusCode::SUCCESS;
+}
+
+
+// Агрегаты поля по корзинам времени [fromSec, toSec); каждая корзина — Config::ROLLUP_BUCKET_SEC
+StatusCode SQLiteDb::rollupByTime(int sessionId, const QString& field, qint64 fromSec, qint64 toSec,
+                                  QVector<RollupBucket>& out)
+{
+    out.clear();
+
+    QSqlQuery& query = preparedQuery(SqlQueries::ROLLUP_TIME);
+
+    query.bindValue(":session_id", sessionId);
+    query.bindValue(":field", field);
+    query.bindValue(":from", timeBucket(fromSec));
+    query.bindValue(":to", toSec);
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    while (query.next()) {
+        RollupBucket bucket;
+        bucket.bucketStart = query.value(0).toLongLong();
+        readRollup(query, 1, bucket.aggregate);
+        out.append(bucket);
+    }
+
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+
+// Агрегаты поля по ячейкам Config::ROLLUP_CELL_DEG, пересекающим прямоугольник
+StatusCode SQLiteDb::rollupByCell(int sessionId, const QString& field, const GeoRect& rect,
+                                  QVector<RollupBucket>& out)
+{
+    out.clear();
+
+    QSqlQuery& query = preparedQuery(SqlQueries::ROLLUP_CELL);
+
+    query.bindValue(":session_id", sessionId);
+    query.bindValue(":field", field);
+    query.bindValue(":y_min", spatialCell(rect.latMin));
+    query.bindValue(":y_max", spatialCell(rect.latMax));
+    query.bindValue(":x_min", spatialCell(rect.lonMin));
+    query.bindValue(":x_max", spatialCell(rect.lonMax));
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    while (query.next()) {
+        RollupBucket cell;
+        cell.cellY = query.value(0).toLongLong();
+        cell.cellX = query.value(1).toLongLong();
+        readRollup(query, 2, cell.aggregate);
+        out.append(cell);
+    }
+
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+
+// Итог по полю за всю сессию — сумма корзин времени, без чтения Points
+StatusCode SQLiteDb::rollupTotal(int sessionId, const QString& field, SensorAggregate& out)
+{
+    out = SensorAggregate();
+
+    QSqlQuery& query = preparedQuery(
+        "SELECT SUM(count), MIN(min), MAX(max), SUM(sum), SUM(sum_sq) FROM Rollup_time "
+        "WHERE session_id = :session_id AND field = :field");
+
+    query.bindValue(":session_id", sessionId);
+    query.bindValue(":field", field);
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    if (query.next()) {
+        readRollup(query, 0, out);
+    }
+
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+// -------------------- Пространственные выборки --------------------
+
+// Точки сессии внутри прямоугольника. R*Tree хранит float-координаты с округлением наружу,
+// поэтому после него координаты ещё раз сверяются по самой таблице Points.
+StatusCode SQLiteDb::pointsInRect(int sessionId, const GeoRect& rect, QVector<PointRecord>& out, int limit)
+{
+    return selectPointsInRect(hasSpatialIndex ? SqlQueries::POINTS_IN_RECT : SqlQueries::POINTS_IN_RECT_FALLBACK,
+                              sessionId, rect, 0, out, limit);
+}
+
+
+// Прямоугольник расширяется до границ ячеек: представитель ячейки не зависит от того,
+// какая её часть попала в запрос, и при сдвиге карты остаётся тем же
+StatusCode SQLiteDb::pointsInRectThinned(int sessionId, const GeoRect& rect, double cellDeg,
+                                         QVector<PointRecord>& out, int limit)
+{
+    if (cellDeg <= 0) {
+        return pointsInRect(sessionId, rect, out, limit);
+    }
+
+    GeoRect cells;
+    cells.latMin = std::floor((rect.latMin + 90) / cellDeg) * cellDeg - 90;
+    cells.latMax = std::ceil((rect.latMax + 90) / cellDeg) * cellDeg - 90;
+    cells.lonMin = std::floor((rect.lonMin + 180) / cellDeg) * cellDeg - 180;
+    cells.lonMax = std::ceil((rect.lonMax + 180) / cellDeg) * cellDeg - 180;
+
+    return selectPointsInRect(hasSpatialIndex ? SqlQueries::POINTS_IN_RECT_THINNED
+                                              : SqlQueries::POINTS_IN_RECT_THINNED_FALLBACK,
+                              sessionId, cells, cellDeg, out, limit);
+}
+
+
+StatusCode SQLiteDb::selectPointsInRect(const QString& sql, int sessionId, const GeoRect& rect, double cellDeg,
+                                        QVector<PointRecord>& out, int limit)
+{
+    out.clear();
+
+    QSqlQuery& query = preparedQuery(sql);
+
+    if (hasSpatialIndex) {
+        query.bindValue(":lat_min", rect.latMin);
+        query.bindValue(":lat_max", rect.latMax);
+        query.bindValue(":lon_min", rect.lonMin);
+        query.bindValue(":lon_max", rect.lonMax);
+    }
+    query.bindValue(":exact_lat_min", rect.latMin);
+    query.bindValue(":exact_lat_max", rect.latMax);
+    query.bindValue(":exact_lon_min", rect.lonMin);
+    query.bindValue(":exact_lon_max", rect.lonMax);
+    query.bindValue(":session", sessionId);
+    query.bindValue(":limit", limit);
+    if (cellDeg > 0) {
+        query.bindValue(":cell_lat", cellDeg);
+        query.bindValue(":cell_lon", cellDeg);
+    }
+
+    StatusCode st = execQuery(query);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    while (query.next()) {
+        PointRecord rec;
+        rec.id = query.value(0).toInt();
+        rec.sessionId = query.value(1).toInt();
+        rec.latitude = query.value(2).toDouble();
+        rec.longitude = query.value(3).toDouble();
+        rec.dataJson = query.value(4).toByteArray();
+        out.append(rec);
+    }
+
+    // Кэшированный запрос держит курсор, пока его не сбросить
+    query.finish();
+    return StatusCode::SUCCESS;
+}
+
+StatusCode SQLiteDb::explainQueryPlan(const QString& sql, QStringList& details, const QVariantMap& binds)
+{
+    details.clear();
+
+    QSqlQuery query(db);
+    bool ok = query.prepare("EXPLAIN QUERY PLAN " + sql);
+    for (auto it = binds.cbegin(); ok && it != binds.cend(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
+    if (!ok || !query.exec()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << query.lastError().text();
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    // Колонки: id, parent, notused, detail
+    while (query.next()) {
+        details.append(query.value(3).toString());
+    }
+    return StatusCode::SUCCESS;
+}
+
+// -------------------- Пакетная вставка --------------------
+
+// Все строки пакета идут через один подготовленный запрос в одной транзакции.
+// QSQLITE выполняет execBatch() тем же циклом по строкам, но без статуса каждой строки,
+// поэтому цикл здесь явный: ошибочная строка не откатывает остальные.
+template <typename Row, typename Bind>
+BulkResult SQLiteDb::bulkInsert(const QString& sql, const QVector<Row>& rows, Bind bind)
+{
+    return bulkInsert(sql, rows, bind, nullptr);
+}
+
+
+// after(row, id) вызывается после каждой успешной вставки в той же транзакции.
+// Строка с after вставляется в своей точке сохранения: если after не удался, откатывается
+// и сама вставка, так что в БД не остаётся строки, о которой вызывающий узнал как о неудаче
+template <typename Row, typename Bind, typename After>
+BulkResult SQLiteDb::bulkInsert(const QString& sql, const QVector<Row>& rows, Bind bind, After after)
+{
+    BulkResult result;
+    result.rowStatus.fill(StatusCode::DB_QUERY_FAILED, rows.size());
+    result.ids.fill(-1, rows.size());
+
+    if (rows.isEmpty()) {
+        return result;
+    }
+
+    // Если транзакция уже открыта вызывающим кодом — работаем внутри неё
+    const bool ownTransaction = db.transaction();
+
+    QSqlQuery& query = preparedQuery(sql);
+
+    for (int i = 0; i < rows.size(); ++i) {
+        if constexpr (std::is_same_v<After, std::nullptr_t>) {
+            bind(query, rows[i]);
+            result.rowStatus[i] = execInsert(query, &result.ids[i]);
+        }
+        else {
+            QSqlQuery& savepoint = preparedQuery("SAVEPOINT bulk_row");
+            if (execQuery(savepoint) != StatusCode::SUCCESS) {
+                continue;
+            }
+
+            bind(query, rows[i]);
+            result.rowStatus[i] = execInsert(query, &result.ids[i]);
+            if (result.rowStatus[i] == StatusCode::SUCCESS) {
+                result.rowStatus[i] = after(rows[i], result.ids[i]);
+            }
+
+            if (result.rowStatus[i] != StatusCode::SUCCESS) {
+                execQuery(preparedQuery("ROLLBACK TO bulk_row"));
+                result.ids[i] = -1;
+            }
+            execQuery(preparedQuery("RELEASE bulk_row"));
+        }
+
+        if (result.rowStatus[i] == StatusCode::SUCCESS) {
+            ++result.inserted;
+        }
+    }
+
+    if (ownTransaction && !db.commit()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << db.lastError().text();
+        db.rollback();
+        result.rowStatus.fill(StatusCode::DB_QUERY_FAILED);
+        result.ids.fill(-1);
+        result.inserted = 0;
+    }
+
+    if (result.inserted != rows.size()) {
+        result.code = StatusCode::DB_QUERY_FAILED;
+    }
+    return result;
+}
+
+
+BulkResult SQLiteDb::addPoints(const QVector<PointRow>& rows)
+{
+    return bulkInsert(
+        "INSERT INTO Points (field_id, session_id, spec_id, latitude, longitude, data_json) "
+        "VALUES (:field_id, :session_id, :spec_id, :lat, :lon, :data_json)",
+        rows,
+        [this](QSqlQuery& query, const PointRow& row) {
+            query.bindValue(":field_id", row.fieldId);
+            query.bindValue(":session_id", row.sessionId);
+            query.bindValue(":spec_id", row.specId > 0 ? QVariant(row.specId) : QVariant());
+            query.bindValue(":lat", row.latitude);
+            query.bindValue(":lon", row.longitude);
+            query.bindValue(":data_json", QString(QJsonDocument(blobs.externalize(row.data)).toJson(QJsonDocument::Compact)));
+        },
+        [this, now = QDateTime::currentSecsSinceEpoch()](const PointRow& row, int) {
+            return updateRollups(row.sessionId, row.latitude, row.longitude, row.data, now);
+        });
+}
+
+
+BulkResult SQLiteDb::addObservations(const QVector<int>& pointIds)
+{
+    return bulkInsert(
+        "INSERT INTO Observations (point_id) VALUES (:point_id)",
+        pointIds,
+        [](QSqlQuery& query, int pointId) {
+            query.bindValue(":point_id", pointId);
+        });
+}
+
+
+BulkResult SQLiteDb::addMLResults(const QVector<MLResultRow>& rows)
+{
+    return bulkInsert(
+        "INSERT INTO ML_results (observation_id, module_name, results_json) "
+        "VALUES (:obs, :module, :json)",
+        rows,
+        [this](QSqlQuery& query, const MLResultRow& row) {
+            query.bindValue(":obs", row.observationId);
+            query.bindValue(":module", row.moduleName);
+            query.bindValue(":json", QString(QJsonDocument(blobs.externalize(row.result)).toJson(QJsonDocument::Compact)));
+        });
+}
+
+
+// -------------------- Журнал сообщений --------------------
+
+// В WAL с synchronous=NORMAL фиксация не ждёт fsync: после сбоя питания строки могут пропасть,
+// хотя журнал уже отметил их применёнными
+StatusCode SQLiteDb::requireDurableCommits()
+{
+    profile.synchronous = "FULL";
+
+    if (!db.isOpen()) {
+        return StatusCode::SUCCESS;
+    }
+    return exec("PRAGMA synchronous=FULL");
+}
+
+
+StatusCode SQLiteDb::lastJournalSeq(quint64& seq)
+{
+    seq = 0;
+    return forEachRow("SELECT MAX(journal_seq) FROM Points WHERE journal_seq IS NOT NULL",
+                      [&seq](const SqlCursor& row) {
+                          seq = quint64(row.toInt64(0));
+                          return false;
+                      });
+}
+
+// -------------------- Кэш ML --------------------
+
+StatusCode SQLiteDb::addMLCacheEntry(const QString& contentHash, const QString& moduleName, const QJsonObject& result)
+{
+    // Одинаковые кадры встречаются в разных сессиях — кэш общий
+    if (catalog) {
+        return catalog->addMLCacheEntry(contentHash, moduleName, result);
+    }
+
+    QSqlQuery& query = preparedQuery(
+        "INSERT OR REPLACE INTO ML_cache (content_hash, module_name, results_json) "
+        "VALUES (:hash, :module, :json)"
+        );
+
+    query.bindValue(":hash", contentHash);
+    query.bindValue(":module", moduleName);
+    query.bindValue(":json", QString(QJsonDocument(result).toJson(QJsonDocument::Compact)));
+
     return execQuery(query);
 }
 
 
+// Последние записи кэша — для прогрева кэша в памяти при старте
+QVector<MLCacheRow> SQLiteDb::loadMLCache(int limit)
+{
+    if (catalog) {
+        return catalog->loadMLCache(limit);
+    }
+
+    QVector<MLCacheRow> rows;
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(SqlQueries::ML_CACHE_PRELOAD);
+    query.bindValue(":limit", limit);
+
+    if (execQuery(query) != StatusCode::SUCCESS) {
+        return rows;
+    }
+
+    while (query.next()) {
+        MLCacheRow row;
+        row.contentHash = query.value(0).toString();
+        row.moduleName = query.value(1).toString();
+        row.result = QJsonDocument::fromJson(query.value(2).toByteArray()).object();
+        rows.append(row);
+    }
+
+    return rows;
+}
+
+
+// -------------------- Миниатюры --------------------
+
+StatusCode SQLiteDb::thumbnails(const QStringList& blobHashes, QHash<QString, QVector<ThumbnailRow>>& out)
+{
+    // Параметров в одном запросе не больше SQLITE_MAX_VARIABLE_NUMBER (999 в старых сборках)
+    const int CHUNK = 500;
+
+    out.clear();
+
+    for (int from = 0; from < blobHashes.size(); from += CHUNK) {
+        QStringList names;
+        QVariantMap binds;
+        for (int i = from; i < std::min(from + CHUNK, int(blobHashes.size())); ++i) {
+            const QString name = QString(":h%1").arg(i - from);
+            names.append(name);
+            binds.insert(name, blobHashes[i]);
+        }
+
+        const StatusCode st = forEachRow(
+            SqlQueries::THUMBNAILS_OF_BLOBS.arg(names.join(',')),
+            [&out](const SqlCursor& row) {
+                ThumbnailRow thumb;
+                thumb.size = row.toInt(1);
+                thumb.hash = row.toString(2);
+                thumb.width = row.toInt(3);
+                thumb.height = row.toInt(4);
+                out[row.toString(0)].append(thumb);
+                return true;
+            },
+            binds);
+
+        if (st != StatusCode::SUCCESS) {
+            return st;
+        }
+    }
+    return StatusCode::SUCCESS;
+}
 
 int SQLiteDb::lastInsertId()
 {
@@ -2,42 +2,167 @@
 #define SQLITEDB_H
 
 #include "dbinterface.h"
+#include "dbrows.h"
+#include "sqlcursor.h"
+#include "blobstore.h"
 #include "statuscodes.h"
+#include "config.h"
 
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
+#include <QHash>
+#include <QJsonObject>
+#include <QVariantMap>
+
+#include <functional>
+#include <unordered_map>
 
 class SQLiteDb : public DbInterface
 {
 public:
-    SQLiteDb();
+    // connectionName — имя соединения Qt; у каждого потока должно быть своё.
+    // readOnly — соединение только для чтения (схему создаёт и меняет писатель)
+    explicit SQLiteDb(const QString& connectionName = Config::DB_CONNECTION_NAME, bool readOnly = false);
     ~SQLiteDb();
 
+    const QString& connectionName() const { return name; }
+    bool isReadOnly() const { return readOnly; }
+
     StatusCode connect(const QString &connectionInfo) override;
     SQLResult executeSQL(const QString &query) override;
     void disconnect() override;
 
-    // Методы для безопасного добавления данных
-    StatusCode addSession(const QString& description);
-    StatusCode addField(const QString& name,const QJsonObject& boundary,int sessionId);
-    StatusCode addSensorSpec(const QJsonObject& spec);
-    StatusCode addPoint(int fieldId, int sessionId,double latitude,double longitude, const QJsonObject& data);
-    StatusCode addObservation(int pointId);
-    StatusCode addMLResult(int observationId, const QString& moduleName,const QJsonObject& result);
-    StatusCode addRecommendation(int observationId,const QString& text);
+    // Потоковое чтение SELECT: строки по одной, память не зависит от размера результата.
+    // binds — значения именованных параметров (":name" → значение)
+    SqlCursor select(const QString& sql, const QVariantMap& binds = QVariantMap(), int prefetch = 0);
+
+    // Обходит строки результата; visit возвращает false, чтобы остановиться
+    StatusCode forEachRow(const QString& sql, const std::function<bool(const SqlCursor&)>& visit,
+                          const QVariantMap& binds = QVariantMap());
+
+    // Изображения и маски вне data_json (открыто, если БД в файле и Config::BLOB_STORE_ENABLED)
+    BlobStore& blobStore() { return blobs; }
+
+    // Команда без результата (ATTACH, DDL, служебные UPDATE) с именованными параметрами.
+    // insertedId (если передан) — id строки, вставленной этой командой
+    StatusCode exec(const QString& sql, const QVariantMap& binds = QVariantMap(), int* insertedId = nullptr);
+
+    // Общие таблицы в другой БД (каталог ShardedDb): id спецификаций выдаёт каталог, здесь
+    // хранится копия строки Sensor_specs с тем же id; ML_cache целиком в каталоге
+    void setCatalog(SQLiteDb* catalog) { this->catalog = catalog; }
+
+    // Профиль производительности (Config::DB_PROFILE_*); применяется при следующем connect()
+    void setProfile(const QString& name) { profile = Config::dbProfile(name); }
+    const DbProfile& currentProfile() const { return profile; }
+
+    // Методы для безопасного добавления данных.
+    // insertedId (если передан) получает id новой строки без отдельного запроса.
+    // Одинаковая спецификация сенсоров хранится один раз; addSensorSpec отдаёт её id
+    StatusCode addSession(const QString& description, int* insertedId = nullptr) override;
+    StatusCode addField(const QString& name,const QJsonObject& boundary,int sessionId, int* insertedId = nullptr) override;
+    StatusCode addSensorSpec(const QJsonObject& spec, int* insertedId = nullptr) override;
+    StatusCode addPoint(int fieldId, int sessionId,double latitude,double longitude, const QJsonObject& data,
+                        int specId = -1, int* insertedId = nullptr, quint64 journalSeq = 0) override;
+    StatusCode addPointRaw(int fieldId, int sessionId, double latitude, double longitude,
+                           const RawJson::Document& data, int specId = -1, int* insertedId = nullptr,
+                           quint64 journalSeq = 0) override;
+    StatusCode addObservation(int pointId, int* insertedId = nullptr) override;
+    StatusCode addMLResult(int observationId, const QString& moduleName,const QJsonObject& result, int* insertedId = nullptr) override;
+    StatusCode addRecommendation(int observationId,const QString& text, int* insertedId = nullptr) override;
+
+    // Точки сессии в прямоугольнике (limit < 0 — без ограничения)
+    StatusCode pointsInRect(int sessionId, const GeoRect& rect, QVector<PointRecord>& out, int limit = -1) override;
+    // Не больше одной точки на ячейку cellDeg × cellDeg градусов (всегда одна и та же — с наименьшим id):
+    // обзор большой области, где точек больше limit. cellDeg <= 0 — как pointsInRect
+    StatusCode pointsInRectThinned(int sessionId, const GeoRect& rect, double cellDeg,
+                                   QVector<PointRecord>& out, int limit = -1);
+
+    // Выборки по полям сенсоров, вынесенным из data_json (sessionId < 0 — все сессии)
+    StatusCode sensorRange(int sessionId, const QString& field, double min, double max,
+                           QVector<PointRecord>& out, int limit = -1);
+    StatusCode sensorAggregate(int sessionId, const QString& field, SensorAggregate& out);
+    bool hasSensorField(const QString& field) const { return sensorColumns.contains(field); }
 
+    // Агрегаты по корзинам времени и пространственным ячейкам (таблицы Rollup_*),
+    // обновляются при вставке точек
+    StatusCode rollupByTime(int sessionId, const QString& field, qint64 fromSec, qint64 toSec,
+                            QVector<RollupBucket>& out);
+    StatusCode rollupByCell(int sessionId, const QString& field, const GeoRect& rect,
+                            QVector<RollupBucket>& out);
+    StatusCode rollupTotal(int sessionId, const QString& field, SensorAggregate& out);
+    StatusCode rebuildRollups(int sessionId);
+
+    // Строки EXPLAIN QUERY PLAN (колонка detail) для запроса; binds — значения всех его параметров
+    StatusCode explainQueryPlan(const QString& sql, QStringList& details,
+                                const QVariantMap& binds = QVariantMap());
+
+    // Пакетная вставка: одна транзакция и один подготовленный запрос на весь пакет
+    BulkResult addPoints(const QVector<PointRow>& rows) override;
+    BulkResult addObservations(const QVector<int>& pointIds) override;
+    BulkResult addMLResults(const QVector<MLResultRow>& rows) override;
+
+    // С журналом — synchronous=FULL до отключения (и в профиле для следующего connect())
+    StatusCode requireDurableCommits() override;
+    StatusCode lastJournalSeq(quint64& seq) override;
+
+    // Кэш ML результатов
+    StatusCode addMLCacheEntry(const QString& contentHash, const QString& moduleName, const QJsonObject& result) override;
+    QVector<MLCacheRow> loadMLCache(int limit) override;
+
+    // Готовые миниатюры изображений по хешам исходных блобов (по возрастанию размера).
+    // Блобы без миниатюр в out не попадают
+    StatusCode thumbnails(const QStringList& blobHashes, QHash<QString, QVector<ThumbnailRow>>& out);
+
+    // Канонический вид спецификации (ключи JSON упорядочены) → хеш для дедупликации
+    static QString specHash(const QJsonObject& spec);
+
+    // Отдельный запрос SELECT last_insert_rowid(); в горячем пути лучше insertedId
     int lastInsertId();
 
 
 private:
+    QString name;
+    bool readOnly = false;
     QSqlDatabase db;
+    DbProfile profile = Config::dbProfile(Config::DB_PROFILE);
+    bool hasSpatialIndex = false;   // есть ли R*Tree Points_rtree
+    QHash<QString, QString> sensorColumns;   // поле сенсора → генерируемая колонка Points
+    QHash<QString, int> specIds;             // хеш спецификации → id в Sensor_specs
+    BlobStore blobs;                         // изображения и маски вне data_json
+    SQLiteDb* catalog = nullptr;             // Sensor_specs и ML_cache (nullptr — свои)
 
+    // Кэш подготовленных запросов (ключ — текст SQL).
+    // unordered_map: ссылки на запросы не меняются при добавлении новых
+    std::unordered_map<QString, QSqlQuery> statements;
+
+    QSqlQuery& preparedQuery(const QString& sql);
     StatusCode execQuery(QSqlQuery &query, StatusCode errCode = StatusCode::DB_QUERY_FAILED);
+    StatusCode execInsert(QSqlQuery &query, int* insertedId);
+    StatusCode execPointInsert(QSqlQuery &query, quint64 journalSeq, int* insertedId);
+    StatusCode selectPointsInRect(const QString& sql, int sessionId, const GeoRect& rect, double cellDeg,
+                                  QVector<PointRecord>& out, int limit);
+
+    template <typename Row, typename Bind>
+    BulkResult bulkInsert(const QString& sql, const QVector<Row>& rows, Bind bind);
+    template <typename Row, typename Bind, typename After>
+    BulkResult bulkInsert(const QString& sql, const QVector<Row>& rows, Bind bind, After after);
     StatusCode initDatabase(); // создаёт таблицы, если их нет
-    bool createTable(QSqlQuery &query, const QString &sql, const QString &tableName);
+    StatusCode initReader();   // для соединения только для чтения: схема уже есть
+    void applyProfile();
+    void detectSpatialIndex();
+    void loadSensorFields();
+    void loadSpecIds();
+    StatusCode updateRollups(int sessionId, double latitude, double longitude,
+                             const QJsonObject& data, qint64 timeSec);
+    StatusCode updateRollups(int sessionId, double latitude, double longitude,
+                             const RawJson::Document& data, qint64 timeSec);
+    StatusCode updateRollupValues(int sessionId, double latitude, double longitude,
+                                  const QVector<QPair<QString, double>>& values, qint64 timeSec);
+    void materializeSpecFields(const QJsonObject& spec, int specId);
+    StatusCode addSensorColumn(const QString& name, const QString& sqlType, int specId);
 
 };
 
@@ -0,0 +1,116 @@
+#ifndef SQLQUERIES_H
+#define SQLQUERIES_H
+
+#include <QString>
+
+// Текст горячих запросов. Один и тот же текст выполняется в месте вызова и проверяется
+// QueryPlanCheck, поэтому план проверяется у того запроса, который реально работает.
+// %1 — список id или параметров, подставляемый перед выполнением.
+namespace SqlQueries {
+
+// SessionReplayer::loadFromDb: сессия → точки (со спецификацией) → наблюдения → ML результаты
+const QString SESSION_REPLAY =
+    "SELECT p.id AS point_id, p.data_json, p.created_at, p.spec_id, s.spec_json, "
+    "m.module_name, m.results_json, m.created_at AS ml_created_at "
+    "FROM Points p "
+    "LEFT JOIN Sensor_specs s ON s.id = p.spec_id "
+    "LEFT JOIN Observations o ON o.point_id = p.id "
+    "LEFT JOIN ML_results m ON m.observation_id = o.id "
+    "WHERE p.session_id = :session "
+    "ORDER BY p.id, m.id";
+
+// SessionExporter: точки сессии (%1 — колонки полей сенсоров "p.<колонка>," или пусто)
+// и ML результаты её наблюдений
+const QString EXPORT_POINTS =
+    "SELECT p.id, p.session_id, p.spec_id, CAST(strftime('%s', p.created_at) AS INTEGER) * 1000, "
+    "p.latitude, p.longitude, json_extract(p.data_json, '$.img_blob'), %1 p.data_json "
+    "FROM Points p WHERE p.session_id = :session ORDER BY p.id";
+
+const QString EXPORT_ML_RESULTS =
+    "SELECT m.id, m.observation_id, o.point_id, m.module_name, "
+    "CAST(strftime('%s', m.created_at) AS INTEGER) * 1000, m.results_json "
+    "FROM Points p "
+    "JOIN Observations o ON o.point_id = p.id "
+    "JOIN ML_results m ON m.observation_id = o.id "
+    "WHERE p.session_id = :session ORDER BY m.id";
+
+// SQLiteDb::pointsInRect: через R*Tree и без него (БД без пространственного индекса)
+const QString POINTS_IN_RECT =
+    "SELECT p.id, p.session_id, p.latitude, p.longitude, p.data_json "
+    "FROM Points_rtree r JOIN Points p ON p.id = r.id "
+    "WHERE r.max_lat >= :lat_min AND r.min_lat <= :lat_max "
+    "AND r.max_lon >= :lon_min AND r.min_lon <= :lon_max "
+    "AND r.session_id = :session "
+    "AND p.latitude BETWEEN :exact_lat_min AND :exact_lat_max "
+    "AND p.longitude BETWEEN :exact_lon_min AND :exact_lon_max "
+    "LIMIT :limit";
+
+const QString POINTS_IN_RECT_FALLBACK =
+    "SELECT id, session_id, latitude, longitude, data_json FROM Points "
+    "WHERE session_id = :session "
+    "AND latitude BETWEEN :exact_lat_min AND :exact_lat_max "
+    "AND longitude BETWEEN :exact_lon_min AND :exact_lon_max "
+    "LIMIT :limit";
+
+// SQLiteDb::pointsInRectThinned: одна точка (с наименьшим id) на ячейку сетки :cell_lat × :cell_lon
+// градусов, отсчитанной от (-90, -180); сдвиг делает номер ячейки неотрицательным,
+// и CAST совпадает с floor
+const QString POINTS_IN_RECT_THINNED =
+    "SELECT MIN(p.id), p.session_id, p.latitude, p.longitude, p.data_json "
+    "FROM Points_rtree r JOIN Points p ON p.id = r.id "
+    "WHERE r.max_lat >= :lat_min AND r.min_lat <= :lat_max "
+    "AND r.max_lon >= :lon_min AND r.min_lon <= :lon_max "
+    "AND r.session_id = :session "
+    "AND p.latitude BETWEEN :exact_lat_min AND :exact_lat_max "
+    "AND p.longitude BETWEEN :exact_lon_min AND :exact_lon_max "
+    "GROUP BY CAST((p.latitude + 90) / :cell_lat AS INTEGER), CAST((p.longitude + 180) / :cell_lon AS INTEGER) "
+    "LIMIT :limit";
+
+const QString POINTS_IN_RECT_THINNED_FALLBACK =
+    "SELECT MIN(id), session_id, latitude, longitude, data_json FROM Points "
+    "WHERE session_id = :session "
+    "AND latitude BETWEEN :exact_lat_min AND :exact_lat_max "
+    "AND longitude BETWEEN :exact_lon_min AND :exact_lon_max "
+    "GROUP BY CAST((latitude + 90) / :cell_lat AS INTEGER), CAST((longitude + 180) / :cell_lon AS INTEGER) "
+    "LIMIT :limit";
+
+// SQLiteDb::rollupByTime / rollupByCell
+const QString ROLLUP_TIME =
+    "SELECT bucket, count, min, max, sum, sum_sq FROM Rollup_time "
+    "WHERE session_id = :session_id AND field = :field AND bucket >= :from AND bucket < :to "
+    "ORDER BY bucket";
+
+const QString ROLLUP_CELL =
+    "SELECT cell_y, cell_x, count, min, max, sum, sum_sq FROM Rollup_cell "
+    "WHERE session_id = :session_id AND field = :field "
+    "AND cell_y BETWEEN :y_min AND :y_max AND cell_x BETWEEN :x_min AND :x_max";
+
+// SQLiteDb::loadMLCache
+const QString ML_CACHE_PRELOAD =
+    "SELECT content_hash, module_name, results_json FROM ML_cache "
+    "ORDER BY created_at DESC LIMIT :limit";
+
+// SQLiteDb::thumbnails: %1 — параметры хэшей через запятую
+const QString THUMBNAILS_OF_BLOBS =
+    "SELECT blob_hash, size, thumb_hash, width, height FROM Thumbnails "
+    "WHERE blob_hash IN (%1) AND thumb_hash IS NOT NULL "
+    "ORDER BY blob_hash, size";
+
+// DbObservationSource: ML результаты видимых точек, %1 — id точек через запятую
+const QString ML_RESULTS_OF_POINTS =
+    "SELECT o.point_id, m.results_json FROM ML_results m "
+    "JOIN Observations o ON o.id = m.observation_id "
+    "WHERE o.point_id IN (%1) ORDER BY m.id";
+
+// ThumbnailPipeline::scanBacklog: блобы без миниатюр, кроме самих миниатюр,
+// по порядку хэша после :after
+const QString THUMBNAIL_BACKLOG =
+    "SELECT b.hash FROM Blobs b "
+    "WHERE b.hash > :after AND b.refcount > 0 "
+    "AND NOT EXISTS (SELECT 1 FROM Thumbnails t WHERE t.blob_hash = b.hash) "
+    "AND NOT EXISTS (SELECT 1 FROM Thumbnails t WHERE t.thumb_hash = b.hash) "
+    "ORDER BY b.hash LIMIT :limit";
+
+}
+
+#endif // SQLQUERIES_H
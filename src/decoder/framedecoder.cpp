@@ -0,0 +1,265 @@
+#include "framedecoder.h"
+#include "logmessages.h"
+#include "statusmapper.h"
+#include "config.h"
+
+#include <QJsonArray>
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstring>
+
+namespace {
+
+struct WireType {
+    const char* name;
+    int bytes;
+    FramePlan::ValueType valueType;
+};
+
+const WireType WIRE_TYPES[] = {
+    {"u8",   1, FramePlan::ValueType::Integer},
+    {"i8",   1, FramePlan::ValueType::Integer},
+    {"bool", 1, FramePlan::ValueType::Bool},
+    {"u16",  2, FramePlan::ValueType::Integer},
+    {"i16",  2, FramePlan::ValueType::Integer},
+    {"u32",  4, FramePlan::ValueType::Integer},
+    {"i32",  4, FramePlan::ValueType::Integer},
+    {"u64",  8, FramePlan::ValueType::Integer},
+    {"i64",  8, FramePlan::ValueType::Integer},
+    {"f32",  4, FramePlan::ValueType::Real},
+    {"f64",  8, FramePlan::ValueType::Real},
+};
+
+template <typename T>
+inline T load(const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+inline T loadSwapped(const char* p)
+{
+    return qbswap(load<T>(p));
+}
+
+template <>
+inline float loadSwapped<float>(const char* p)
+{
+    const quint32 bits = qbswap(load<quint32>(p));
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+template <>
+inline double loadSwapped<double>(const char* p)
+{
+    const quint64 bits = qbswap(load<quint64>(p));
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Целые до 2^53 по модулю double хранит точно
+const qint64 MAX_EXACT_JSON_INT = qint64(1) << 53;
+
+StatusCode badSpec(const QString& detail)
+{
+    qWarning() << LogMsg::DECODER_BAD_SPEC << detail;
+    return StatusCode::DECODER_BAD_SPEC;
+}
+
+}
+
+
+StatusCode FramePlan::compile(const QJsonObject& spec, FramePlan& plan)
+{
+    plan = FramePlan();
+
+    const QJsonObject frame = spec.value("frame").toObject();
+    const QString byteOrder = frame.value("byte_order").toString("little").toLower();
+    if (byteOrder != "little" && byteOrder != "big") {
+        return badSpec("byte_order " + byteOrder);
+    }
+
+    // Порядок байт кадра не совпадает с порядком машины — чтение с перестановкой байт
+    const bool swap = (byteOrder == "big") != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+
+    const QJsonArray channels = frame.value("channels").toArray();
+    if (channels.isEmpty() || channels.size() > Config::FRAME_MAX_CHANNELS) {
+        return badSpec(QString("channels %1").arg(channels.size()));
+    }
+
+    FramePlan result;
+    int at = 0;
+
+    for (const QJsonValue& value : channels) {
+        const QJsonObject ch = value.toObject();
+        const QString type = ch.value("type").toString().toLower();
+
+        if (type == "pad") {
+            const int padBytes = ch.value("size").toInt(0);
+            if (padBytes <= 0) {
+                return badSpec("pad size");
+            }
+            at += padBytes;
+            continue;
+        }
+
+        const WireType* wire = nullptr;
+        for (const WireType& t : WIRE_TYPES) {
+            if (type == QLatin1String(t.name)) {
+                wire = &t;
+                break;
+            }
+        }
+
+        const QString name = ch.value("name").toString();
+        if (!wire || name.isEmpty() || result.channelIds.contains(name)) {
+            return badSpec(name + ":" + type);
+        }
+
+        Step step;
+        step.op = Op(int(wire - WIRE_TYPES));
+        if (swap && wire->bytes > 1) {
+            step.op = Op(int(step.op) + int(Op::U16Swap) - int(Op::U16));
+        }
+        step.at = at;
+        step.scale = ch.value("scale").toDouble(1.0);
+        step.offset = ch.value("offset").toDouble(0.0);
+        step.affine = step.scale != 1.0 || step.offset != 0.0;
+
+        // Целое с масштабом — уже дробное значение
+        ValueType valueType = wire->valueType;
+        if (step.affine && valueType != ValueType::Real) {
+            valueType = ValueType::Real;
+        }
+
+        step.wide = !step.affine && wire->bytes == 8 && wire->valueType == ValueType::Integer;
+        if (step.wide) {
+            valueType = wire->name[0] == 'u' ? ValueType::UInt64 : ValueType::Int64;
+        }
+
+        result.channelIds.insert(name, result.channels.size());
+        result.channels.append({name, valueType});
+        result.steps.append(step);
+        at += wire->bytes;
+    }
+
+    result.size = at;
+    plan = std::move(result);
+    return StatusCode::SUCCESS;
+}
+
+
+bool FramePlan::decode(const char* frame, int length, double* values) const
+{
+    if (length != size) {
+        return false;
+    }
+
+    const Step* step = steps.constData();
+    const int count = steps.size();
+
+    for (int i = 0; i < count; ++i, ++step) {
+        const char* p = frame + step->at;
+
+        if (step->wide) {
+            quint64 bits = load<quint64>(p);
+            if (step->op == Op::U64Swap || step->op == Op::I64Swap) {
+                bits = qbswap(bits);
+            }
+            std::memcpy(&values[i], &bits, sizeof(bits));
+            continue;
+        }
+
+        double v;
+
+        switch (step->op) {
+        case Op::U8:      v = double(quint8(*p)); break;
+        case Op::I8:      v = double(qint8(*p)); break;
+        case Op::Bool:    v = *p != 0 ? 1.0 : 0.0; break;
+        case Op::U16:     v = double(load<quint16>(p)); break;
+        case Op::I16:     v = double(load<qint16>(p)); break;
+        case Op::U32:     v = double(load<quint32>(p)); break;
+        case Op::I32:     v = double(load<qint32>(p)); break;
+        case Op::U64:     v = double(load<quint64>(p)); break;
+        case Op::I64:     v = double(load<qint64>(p)); break;
+        case Op::F32:     v = double(load<float>(p)); break;
+        case Op::F64:     v = load<double>(p); break;
+        case Op::U16Swap: v = double(loadSwapped<quint16>(p)); break;
+        case Op::I16Swap: v = double(loadSwapped<qint16>(p)); break;
+        case Op::U32Swap: v = double(loadSwapped<quint32>(p)); break;
+        case Op::I32Swap: v = double(loadSwapped<qint32>(p)); break;
+        case Op::U64Swap: v = double(loadSwapped<quint64>(p)); break;
+        case Op::I64Swap: v = double(loadSwapped<qint64>(p)); break;
+        case Op::F32Swap: v = double(loadSwapped<float>(p)); break;
+        case Op::F64Swap: v = loadSwapped<double>(p); break;
+        default:          v = 0.0; break;
+        }
+
+        values[i] = step->affine ? v * step->scale + step->offset : v;
+    }
+    return true;
+}
+
+
+bool FramePlan::decode(const QByteArray& frame, QVector<double>& values) const
+{
+    values.resize(steps.size());
+    return decode(frame.constData(), int(frame.size()), values.data());
+}
+
+
+QJsonObject FramePlan::toJson(const double* values) const
+{
+    QJsonObject json;
+    for (int i = 0; i < channels.size(); ++i) {
+        switch (channels[i].valueType) {
+        case ValueType::Integer: json.insert(channels[i].name, qint64(values[i])); break;
+        case ValueType::Bool:    json.insert(channels[i].name, values[i] != 0.0); break;
+        case ValueType::Real:    json.insert(channels[i].name, values[i]); break;
+
+        case ValueType::Int64: {
+            const qint64 v = int64Value(values[i]);
+            if (v >= -MAX_EXACT_JSON_INT && v <= MAX_EXACT_JSON_INT) {
+                json.insert(channels[i].name, v);
+            } else {
+                json.insert(channels[i].name, QString::number(v));
+            }
+            break;
+        }
+        case ValueType::UInt64: {
+            const quint64 v = uint64Value(values[i]);
+            if (v <= quint64(MAX_EXACT_JSON_INT)) {
+                json.insert(channels[i].name, qint64(v));
+            } else {
+                json.insert(channels[i].name, QString::number(v));
+            }
+            break;
+        }
+        }
+    }
+    return json;
+}
+
+
+std::shared_ptr<const FramePlan> FramePlanCache::compile(int specId, const QJsonObject& spec)
+{
+    auto it = plans.constFind(specId);
+    if (it != plans.constEnd()) {
+        return it.value();
+    }
+
+    auto plan = std::make_shared<FramePlan>();
+    if (FramePlan::compile(spec, *plan) != StatusCode::SUCCESS) {
+        return nullptr;
+    }
+
+    qDebug() << LogMsg::DECODER_PLAN_COMPILED << specId << plan->channelCount() << plan->frameSize();
+    plans.insert(specId, plan);
+    return plan;
+}
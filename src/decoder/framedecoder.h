@@ -0,0 +1,118 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include "statuscodes.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include <cstring>
+#include <memory>
+
+// План разбора двоичного кадра сенсоров, собранный из спецификации робота.
+//
+// Формат описания в спецификации (Sensor_specs.spec_json):
+//   "frame": {
+//       "byte_order": "little",                 // или "big"; по умолчанию little
+//       "channels": [
+//           {"name": "latitude",    "type": "f64"},
+//           {"name": "temperature", "type": "i16", "scale": 0.01, "offset": -40},
+//           {"type": "pad", "size": 2},
+//           {"name": "pump_on",     "type": "bool"}
+//       ]
+//   }
+// Каналы идут подряд без выравнивания; типы u8/i8/u16/i16/u32/i32/u64/i64/f32/f64/bool,
+// pad — пропуск size байт. Значение канала = сырое * scale + offset.
+//
+// Разбор идёт без промежуточного JSON: значения пишутся в массив double по номеру канала.
+// u64/i64 без масштаба в double не помещаются (точность теряется выше 2^53), поэтому их
+// ячейка хранит сами 64 бита (ValueType Int64/UInt64, читать через int64Value/uint64Value).
+// u64/i64 с масштабом — обычное дробное значение (Real).
+class FramePlan {
+public:
+    enum class ValueType { Integer, Real, Bool, Int64, UInt64 };
+
+    struct Channel {
+        QString name;
+        ValueType valueType;
+    };
+
+    // Собирает план; при ошибке в описании план остаётся пустым
+    static StatusCode compile(const QJsonObject& spec, FramePlan& plan);
+
+    // Спецификация описывает двоичный кадр
+    static bool hasFrame(const QJsonObject& spec) { return spec.value("frame").isObject(); }
+
+    bool isEmpty() const { return steps.isEmpty(); }
+    int frameSize() const { return size; }
+    int channelCount() const { return channels.size(); }
+    const Channel& channel(int i) const { return channels[i]; }
+    int channelIndex(const QString& name) const { return channelIds.value(name, -1); }
+
+    // values — не меньше channelCount() элементов. false — длина кадра не совпала
+    bool decode(const char* frame, int length, double* values) const;
+    bool decode(const QByteArray& frame, QVector<double>& values) const;
+
+    // Для записи в Points.data_json и для Manager: целые каналы без масштаба остаются целыми.
+    // 64-битные целые больше 2^53 по модулю идут строкой с десятичным числом: число JSON
+    // (double) их не передаёт точно
+    QJsonObject toJson(const double* values) const;
+
+    // Ячейка канала Int64 / UInt64 → значение без потерь
+    static qint64 int64Value(double cell)
+    {
+        qint64 v;
+        std::memcpy(&v, &cell, sizeof(v));
+        return v;
+    }
+    static quint64 uint64Value(double cell)
+    {
+        quint64 v;
+        std::memcpy(&v, &cell, sizeof(v));
+        return v;
+    }
+
+private:
+    // Тип и порядок байт сведены в один код, чтобы в цикле разбора был один switch
+    enum class Op : quint8 {
+        U8, I8, Bool,
+        U16, I16, U32, I32, U64, I64, F32, F64,
+        U16Swap, I16Swap, U32Swap, I32Swap, U64Swap, I64Swap, F32Swap, F64Swap,
+    };
+
+    struct Step {
+        Op op;
+        bool affine;        // scale != 1 или offset != 0
+        bool wide;          // u64/i64 без масштаба: в ячейку копируются сами 64 бита
+        int at;             // смещение в кадре
+        double scale;
+        double offset;
+    };
+
+    QVector<Step> steps;    // номер шага = номер канала
+    QVector<Channel> channels;
+    QHash<QString, int> channelIds;
+    int size = 0;
+};
+
+
+// Планы по id спецификации. Спецификации интернированы (одна строка Sensor_specs на
+// различное содержимое), так что id однозначно задаёт формат и план собирается один раз
+class FramePlanCache {
+public:
+    // Уже собранный план для specId или новый из spec; nullptr — описание кадра неверно
+    std::shared_ptr<const FramePlan> compile(int specId, const QJsonObject& spec);
+
+    std::shared_ptr<const FramePlan> plan(int specId) const { return plans.value(specId); }
+    bool contains(int specId) const { return plans.contains(specId); }
+    int size() const { return plans.size(); }
+    void clear() { plans.clear(); }
+
+private:
+    QHash<int, std::shared_ptr<const FramePlan>> plans;
+};
+
+#endif // FRAMEDECODER_H
@@ -0,0 +1,38 @@
+// Выгрузка сессии в Arrow IPC для обучения моделей.
+//
+//   AgroExport --db agro.db --session 3 --out export/session3
+
+#include "dbconnectionpool.h"
+#include "sessionexporter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroExport");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"db", "Database to export from.", "path"},
+        {"session", "Session id.", "id"},
+        {"out", "Output directory for points.arrow and ml_results.arrow.", "dir"},
+        {"batch", "Rows per record batch.", "rows", QString::number(Config::EXPORT_BATCH_ROWS)},
+    });
+    parser.process(app);
+
+    if (!parser.isSet("db") || !parser.isSet("session") || !parser.isSet("out")) {
+        parser.showHelp(1);
+    }
+
+    DbConnectionPool pool;
+    pool.open(parser.value("db"), false);
+
+    SessionExporter exporter;
+    const StatusCode st = exporter.exportSession(&pool, parser.value("session").toInt(),
+                                                 parser.value("out"), parser.value("batch").toInt());
+    return st == StatusCode::SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+#include "sessionexporter.h"
+#include "dbconnectionpool.h"
+#include "logmessages.h"
+#include "sqlitedb.h"
+#include "sqlqueries.h"
+#include "statusmapper.h"
+
+#include <QDir>
+#include <QDebug>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+enum class ColumnType { Int64, Double, Utf8, TimestampMs };
+
+// Колонка результата запроса → колонка Arrow
+struct Column {
+    QString name;
+    ColumnType type;
+    bool nullable = true;
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+};
+
+std::shared_ptr<arrow::DataType> arrowType(ColumnType type)
+{
+    switch (type) {
+    case ColumnType::Int64:       return arrow::int64();
+    case ColumnType::Double:      return arrow::float64();
+    case ColumnType::Utf8:        return arrow::utf8();
+    case ColumnType::TimestampMs: return arrow::timestamp(arrow::TimeUnit::MILLI, "UTC");
+    }
+    return arrow::utf8();
+}
+
+ColumnType columnTypeFor(const QString& sqlType)
+{
+    if (sqlType == "INTEGER") return ColumnType::Int64;
+    if (sqlType == "TEXT")    return ColumnType::Utf8;
+    return ColumnType::Double;
+}
+
+void fail(const arrow::Status& status, const QString& path)
+{
+    qWarning() << statusToMessage(StatusCode::EXPORT_FAILED) << path << QString::fromStdString(status.ToString());
+}
+
+
+// Пишет результат курсора в файл Arrow IPC пачками по batchRows строк.
+// Порядок колонок в columns совпадает с порядком колонок в SELECT.
+// progress получает общее число записанных строк после каждой пачки
+StatusCode writeTable(SqlCursor& cursor, std::vector<Column>& columns, const QString& path,
+                      int batchRows, const std::atomic<bool>& cancelled, std::atomic<qint64>& rowsWritten,
+                      const std::function<void(qint64)>& progress)
+{
+    if (!cursor.isValid()) {
+        return cursor.status();
+    }
+
+    arrow::FieldVector fields;
+    for (Column& col : columns) {
+        fields.push_back(arrow::field(col.name.toStdString(), arrowType(col.type), col.nullable));
+        if (!arrow::MakeBuilder(arrow::default_memory_pool(), arrowType(col.type), &col.builder).ok()) {
+            return StatusCode::EXPORT_FAILED;
+        }
+    }
+    const std::shared_ptr<arrow::Schema> schema = arrow::schema(fields);
+
+    auto out = arrow::io::FileOutputStream::Open(path.toStdString());
+    if (!out.ok()) {
+        fail(out.status(), path);
+        return StatusCode::EXPORT_FAILED;
+    }
+
+    auto writer = arrow::ipc::MakeFileWriter(*out, schema);
+    if (!writer.ok()) {
+        fail(writer.status(), path);
+        return StatusCode::EXPORT_FAILED;
+    }
+
+    auto flush = [&](int rows) -> arrow::Status {
+        std::vector<std::shared_ptr<arrow::Array>> arrays;
+        arrays.reserve(columns.size());
+        for (Column& col : columns) {
+            std::shared_ptr<arrow::Array> array;
+            ARROW_RETURN_NOT_OK(col.builder->Finish(&array));
+            arrays.push_back(std::move(array));
+        }
+        return (*writer)->WriteRecordBatch(*arrow::RecordBatch::Make(schema, rows, std::move(arrays)));
+    };
+
+    int rows = 0;
+    arrow::Status st;
+
+    while (st.ok() && cursor.next()) {
+        for (int i = 0; i < int(columns.size()) && st.ok(); ++i) {
+            arrow::ArrayBuilder* builder = columns[i].builder.get();
+
+            if (cursor.isNull(i)) {
+                st = builder->AppendNull();
+                continue;
+            }
+
+            switch (columns[i].type) {
+            case ColumnType::Int64:
+                st = static_cast<arrow::Int64Builder*>(builder)->Append(cursor.toInt64(i));
+                break;
+            case ColumnType::TimestampMs:
+                st = static_cast<arrow::TimestampBuilder*>(builder)->Append(cursor.toInt64(i));
+                break;
+            case ColumnType::Double:
+                st = static_cast<arrow::DoubleBuilder*>(builder)->Append(cursor.toDouble(i));
+                break;
+            case ColumnType::Utf8: {
+                const QByteArray bytes = cursor.toBytes(i);
+                st = static_cast<arrow::StringBuilder*>(builder)->Append(bytes.constData(), int32_t(bytes.size()));
+                break;
+            }
+            }
+        }
+
+        if (++rows == batchRows) {
+            st = flush(rows);
+            rowsWritten += rows;
+            rows = 0;
+            progress(rowsWritten.load());
+
+            if (cancelled) {
+                break;
+            }
+        }
+    }
+
+    if (st.ok() && rows > 0 && !cancelled) {
+        st = flush(rows);
+        rowsWritten += rows;
+        progress(rowsWritten.load());
+    }
+    if (st.ok()) {
+        st = (*writer)->Close();
+    }
+
+    cursor.close();
+
+    if (!st.ok()) {
+        fail(st, path);
+        return StatusCode::EXPORT_FAILED;
+    }
+    return cancelled ? StatusCode::DB_QUERY_CANCELLED : cursor.status();
+}
+}
+
+
+SessionExporter::SessionExporter(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<StatusCode>("StatusCode");
+}
+
+SessionExporter::~SessionExporter()
+{
+    cancel();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+
+bool SessionExporter::start(DbConnectionPool* pool, int sessionId, const QString& outDir, int batchRows)
+{
+    if (running.exchange(true)) {
+        return false;
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    cancelled = false;
+    worker = std::thread([this, pool, sessionId, outDir, batchRows] {
+        const StatusCode st = run(pool, sessionId, outDir, batchRows);
+        running = false;
+        emit finished(st, rowsWritten.load());
+    });
+    return true;
+}
+
+
+void SessionExporter::cancel()
+{
+    cancelled = true;
+}
+
+
+StatusCode SessionExporter::exportSession(DbConnectionPool* pool, int sessionId, const QString& outDir, int batchRows)
+{
+    // Отмена прошлой выгрузки к этой не относится
+    cancelled = false;
+    return run(pool, sessionId, outDir, batchRows);
+}
+
+
+StatusCode SessionExporter::run(DbConnectionPool* pool, int sessionId, const QString& outDir, int batchRows)
+{
+    rowsWritten = 0;
+
+    if (!QDir().mkpath(outDir)) {
+        qWarning() << statusToMessage(StatusCode::EXPORT_FAILED) << outDir;
+        return StatusCode::EXPORT_FAILED;
+    }
+
+    // Читатель потока выгрузки; закрывается пулом, когда поток завершится
+    SQLiteDb* db = pool->reader();
+    if (!db) {
+        return StatusCode::DB_CONNECTION_FAILED;
+    }
+
+    // Точки: фиксированные колонки + поля сенсоров, вынесенные в генерируемые колонки
+    std::vector<Column> pointColumns;
+    pointColumns.push_back({"point_id", ColumnType::Int64, false, nullptr});
+    pointColumns.push_back({"session_id", ColumnType::Int64, false, nullptr});
+    pointColumns.push_back({"spec_id", ColumnType::Int64, true, nullptr});
+    pointColumns.push_back({"created_at", ColumnType::TimestampMs, true, nullptr});
+    pointColumns.push_back({"latitude", ColumnType::Double, false, nullptr});
+    pointColumns.push_back({"longitude", ColumnType::Double, false, nullptr});
+    pointColumns.push_back({"img_blob", ColumnType::Utf8, true, nullptr});
+
+    QStringList sensorSelect;
+    db->forEachRow("SELECT name, column_name, sql_type FROM Sensor_fields ORDER BY name",
+                  [&](const SqlCursor& row) {
+                      pointColumns.push_back({row.toString(0), columnTypeFor(row.toString(2)), true, nullptr});
+                      sensorSelect.append("p." + row.toString(1));
+                      return true;
+                  });
+
+    pointColumns.push_back({"data_json", ColumnType::Utf8, false, nullptr});
+
+    SqlCursor points = db->select(
+        SqlQueries::EXPORT_POINTS.arg(sensorSelect.isEmpty() ? QString() : sensorSelect.join(", ") + ","),
+        {{":session", sessionId}});
+
+    const auto onFlush = [this](qint64 rows) { emit progress(rows); };
+
+    StatusCode st = writeTable(points, pointColumns, QDir(outDir).filePath("points.arrow"), batchRows,
+                               cancelled, rowsWritten, onFlush);
+    if (st != StatusCode::SUCCESS) {
+        return st;
+    }
+
+    std::vector<Column> mlColumns;
+    mlColumns.push_back({"ml_result_id", ColumnType::Int64, false, nullptr});
+    mlColumns.push_back({"observation_id", ColumnType::Int64, false, nullptr});
+    mlColumns.push_back({"point_id", ColumnType::Int64, false, nullptr});
+    mlColumns.push_back({"module_name", ColumnType::Utf8, false, nullptr});
+    mlColumns.push_back({"created_at", ColumnType::TimestampMs, true, nullptr});
+    mlColumns.push_back({"results_json", ColumnType::Utf8, false, nullptr});
+
+    SqlCursor ml = db->select(SqlQueries::EXPORT_ML_RESULTS, {{":session", sessionId}});
+
+    st = writeTable(ml, mlColumns, QDir(outDir).filePath("ml_results.arrow"), batchRows,
+                    cancelled, rowsWritten, onFlush);
+
+    if (st == StatusCode::SUCCESS) {
+        qDebug() << LogMsg::EXPORT_FINISHED << sessionId << rowsWritten.load() << outDir;
+    }
+    return st;
+}
@@ -0,0 +1,56 @@
+#ifndef SESSIONEXPORTER_H
+#define SESSIONEXPORTER_H
+
+#include "statuscodes.h"
+#include "config.h"
+
+class DbConnectionPool;
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <thread>
+
+// Выгрузка сессии для обучения ML в Arrow IPC (файловый формат, .arrow / Feather v2).
+//
+//   <out>/points.arrow      — точки: координаты, время, ссылка на кадр (img_blob),
+//                             поля сенсоров из Sensor_fields отдельными колонками, data_json
+//   <out>/ml_results.arrow  — ML результаты с привязкой к точке
+//
+// Строки читаются курсором и пишутся пачками по Config::EXPORT_BATCH_ROWS,
+// так что память ограничена одной пачкой при любом размере сессии.
+// Работает в своём потоке с читателем из DbConnectionPool; сигналы приходят
+// в поток владельца. Пул должен жить дольше выгрузки.
+class SessionExporter : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SessionExporter(QObject* parent = nullptr);
+    ~SessionExporter();
+
+    // Запускает выгрузку в фоне; false — уже идёт другая
+    bool start(DbConnectionPool* pool, int sessionId, const QString& outDir,
+               int batchRows = Config::EXPORT_BATCH_ROWS);
+    void cancel();
+    bool isRunning() const { return running; }
+
+    // Синхронная выгрузка в текущем потоке (для утилиты командной строки)
+    StatusCode exportSession(DbConnectionPool* pool, int sessionId, const QString& outDir,
+                             int batchRows = Config::EXPORT_BATCH_ROWS);
+
+signals:
+    // После каждой записанной пачки
+    void progress(qint64 rowsWritten);
+    void finished(StatusCode code, qint64 rowsWritten);
+
+private:
+    StatusCode run(DbConnectionPool* pool, int sessionId, const QString& outDir, int batchRows);
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> cancelled{false};
+    std::atomic<qint64> rowsWritten{0};
+};
+
+#endif // SESSIONEXPORTER_H
@@ -0,0 +1,436 @@
+#include "ingestjournal.h"
+#include "logjournal.h"
+#include "config.h"
+#include "statusmapper.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr quint32 SEGMENT_MAGIC = 0x314A4741;  // "AGJ1"
+constexpr quint32 RECORD_MAGIC  = 0x31434552;  // "REC1"
+constexpr quint32 FORMAT_VERSION = 1;
+
+struct SegmentHeader {
+    quint32 magic;
+    quint32 version;
+    quint64 firstSeq;
+    quint64 appliedSeq;   // последний применённый номер на момент записи
+    quint8 reserved[40];
+};
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader layout");
+
+struct RecordHeader {
+    quint32 magic;
+    quint32 length;       // тип + данные
+    quint64 seq;
+    quint64 checksum;
+    quint16 typeLength;
+    quint16 reserved0;
+    quint32 reserved1;
+};
+static_assert(sizeof(RecordHeader) == 32, "RecordHeader layout");
+
+constexpr qint64 align8(qint64 v) { return (v + 7) & ~qint64(7); }
+
+// Контрольная сумма в духе Fletcher-64: работает со скоростью чтения памяти,
+// чтобы журнал стоил микросекунды даже на сообщениях с изображениями
+quint64 checksum(const uchar* data, qint64 size)
+{
+    quint64 a = 0x9E3779B97F4A7C15ull;
+    quint64 b = 0;
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 w;
+        std::memcpy(&w, data + i, 8);
+        a += w;
+        b += a;
+    }
+    quint64 tail = 0;
+    std::memcpy(&tail, data + i, size_t(size - i));
+    a += tail;
+    b += a;
+    return a ^ (b << 1) ^ quint64(size);
+}
+
+bool syncRange(QFile& file, uchar* base, qint64 length)
+{
+#ifdef Q_OS_WIN
+    if (!FlushViewOfFile(base, SIZE_T(length))) {
+        return false;
+    }
+    return FlushFileBuffers(HANDLE(_get_osfhandle(file.handle()))) != 0;
+#else
+    Q_UNUSED(file);
+    return msync(base, size_t(length), MS_SYNC) == 0;
+#endif
+}
+
+// Обходит корректные записи сегмента; останавливается на первой пустой или повреждённой
+template <typename Visitor>
+void scanSegment(const uchar* base, qint64 size, Visitor visit)
+{
+    qint64 pos = sizeof(SegmentHeader);
+    while (pos + qint64(sizeof(RecordHeader)) <= size) {
+        RecordHeader h;
+        std::memcpy(&h, base + pos, sizeof(h));
+
+        if (h.magic != RECORD_MAGIC) {
+            break;
+        }
+
+        const qint64 recSize = align8(sizeof(RecordHeader) + h.length);
+        if (pos + recSize > size || h.typeLength > h.length) {
+            break;
+        }
+
+        const uchar* body = base + pos + sizeof(RecordHeader);
+        if (!visit(h, body)) {
+            break;
+        }
+        pos += recSize;
+    }
+}
+}
+
+
+IngestJournal::IngestJournal(QObject* parent)
+    : QObject(parent)
+{
+    commitTimer.setSingleShot(true);
+    commitTimer.setInterval(Config::JOURNAL_GROUP_COMMIT_MS);
+    QObject::connect(&commitTimer, &QTimer::timeout, this, &IngestJournal::sync);
+}
+
+IngestJournal::~IngestJournal()
+{
+    close();
+}
+
+
+StatusCode IngestJournal::open(const QString& journalDir)
+{
+    close();
+    dir = journalDir;
+
+    if (!QDir().mkpath(dir)) {
+        qWarning() << statusToMessage(StatusCode::JOURNAL_OPEN_FAILED) << dir;
+        return StatusCode::JOURNAL_OPEN_FAILED;
+    }
+
+    // Сегменты прошлого запуска: узнаём последний номер и последний применённый
+    recoverFiles = QDir(dir).entryList({"*.seg"}, QDir::Files, QDir::Name);
+    nextSeq = 1;
+    applied = 0;
+
+    for (QString& name : recoverFiles) {
+        name = QDir(dir).filePath(name);
+
+        QFile file(name);
+        if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(SegmentHeader))) {
+            continue;
+        }
+
+        const uchar* base = file.map(0, file.size());
+        if (!base) {
+            continue;
+        }
+
+        SegmentHeader sh;
+        std::memcpy(&sh, base, sizeof(sh));
+        if (sh.magic == SEGMENT_MAGIC) {
+            applied = std::max(applied, sh.appliedSeq);
+            nextSeq = std::max(nextSeq, sh.firstSeq);
+            scanSegment(base, file.size(), [this](const RecordHeader& h, const uchar*) {
+                nextSeq = std::max(nextSeq, h.seq + 1);
+                return true;
+            });
+        }
+        file.unmap(const_cast<uchar*>(base));
+    }
+
+    // Сегмент без записей (запуск без сообщений) не двигает номер, но применённые номера
+    // повторяться не должны: иначе markApplied и recover() примут новые записи за старые
+    nextSeq = std::max(nextSeq, applied + 1);
+
+    if (!recoverFiles.isEmpty()) {
+        qDebug() << LogMsg::JOURNAL_FOUND_SEGMENTS << recoverFiles.size()
+                 << "last" << nextSeq - 1 << "applied" << applied;
+    }
+
+    return openSegment(0);
+}
+
+
+void IngestJournal::close()
+{
+    if (!current) {
+        return;
+    }
+
+    sync();
+    closeSegment(*current);
+    current.reset();
+
+    // Неприменённые сегменты остаются на диске до следующего recover()
+    for (auto& seg : retired) {
+        closeSegment(*seg);
+    }
+    retired.clear();
+}
+
+
+StatusCode IngestJournal::openSegment(qint64 minSize)
+{
+    auto seg = std::make_unique<Segment>();
+    seg->size = std::max(Config::JOURNAL_SEGMENT_SIZE, minSize);
+    seg->firstSeq = nextSeq;
+    seg->file.setFileName(segmentPath(nextSeq));
+
+    if (!seg->file.open(QIODevice::ReadWrite) || !seg->file.resize(seg->size)) {
+        qWarning() << statusToMessage(StatusCode::JOURNAL_OPEN_FAILED) << seg->file.errorString();
+        return StatusCode::JOURNAL_OPEN_FAILED;
+    }
+
+    seg->base = seg->file.map(0, seg->size);
+    if (!seg->base) {
+        qWarning() << statusToMessage(StatusCode::JOURNAL_OPEN_FAILED) << seg->file.errorString();
+        return StatusCode::JOURNAL_OPEN_FAILED;
+    }
+
+    SegmentHeader sh{};
+    sh.magic = SEGMENT_MAGIC;
+    sh.version = FORMAT_VERSION;
+    sh.firstSeq = seg->firstSeq;
+    sh.appliedSeq = applied;
+    std::memcpy(seg->base, &sh, sizeof(sh));
+
+    seg->writePos = sizeof(SegmentHeader);
+    current = std::move(seg);
+    return StatusCode::SUCCESS;
+}
+
+
+void IngestJournal::closeSegment(Segment& segment)
+{
+    if (segment.base) {
+        segment.file.unmap(segment.base);
+        segment.base = nullptr;
+    }
+    segment.file.close();
+}
+
+
+QString IngestJournal::segmentPath(quint64 firstSeq) const
+{
+    return QDir(dir).filePath(QString("%1.seg").arg(firstSeq, 20, 10, QChar('0')));
+}
+
+// -------------------- Запись --------------------
+
+quint64 IngestJournal::append(const QString& type, const QByteArray& payload)
+{
+    if (!current) {
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QByteArray typeUtf8 = type.toUtf8();
+    const qint64 length = typeUtf8.size() + payload.size();
+    const qint64 recSize = align8(sizeof(RecordHeader) + length);
+
+    // Ротация: текущий сегмент заполнен
+    if (current->writePos + recSize > current->size) {
+        sync();
+        if (current->lastSeq != 0 && current->lastSeq > applied) {
+            retired.push_back(std::move(current));
+        }
+        else {
+            closeSegment(*current);
+            QFile::remove(current->file.fileName());
+            current.reset();
+        }
+
+        if (openSegment(recSize + qint64(sizeof(SegmentHeader))) != StatusCode::SUCCESS) {
+            qWarning() << statusToMessage(StatusCode::JOURNAL_WRITE_FAILED);
+            return 0;
+        }
+    }
+
+    uchar* dst = current->base + current->writePos;
+    uchar* body = dst + sizeof(RecordHeader);
+
+    std::memcpy(body, typeUtf8.constData(), size_t(typeUtf8.size()));
+    std::memcpy(body + typeUtf8.size(), payload.constData(), size_t(payload.size()));
+
+    RecordHeader h{};
+    h.length = quint32(length);
+    h.seq = nextSeq;
+    h.checksum = checksum(body, length);
+    h.typeLength = quint16(typeUtf8.size());
+    std::memcpy(dst, &h, sizeof(h));
+
+    // magic пишется последним: недописанная запись при падении не видна
+    std::atomic_thread_fence(std::memory_order_release);
+    const quint32 magic = RECORD_MAGIC;
+    std::memcpy(dst, &magic, sizeof(magic));
+
+    current->writePos += recSize;
+    current->lastSeq = nextSeq;
+
+    if (++pendingRecords >= Config::JOURNAL_GROUP_COMMIT_RECORDS) {
+        sync();
+    }
+    else if (!commitTimer.isActive()) {
+        commitTimer.start();
+    }
+
+    appendNs += timer.nsecsElapsed();
+    ++appendCount;
+
+    return nextSeq++;
+}
+
+
+void IngestJournal::markApplied(quint64 seq)
+{
+    if (seq <= applied) {
+        return;
+    }
+    applied = seq;
+
+    if (current) {
+        std::memcpy(current->base + offsetof(SegmentHeader, appliedSeq), &applied, sizeof(applied));
+    }
+
+    if (!retired.empty()) {
+        dropAppliedSegments();
+    }
+}
+
+
+void IngestJournal::continueAfter(quint64 seq)
+{
+    if (seq < nextSeq) {
+        return;
+    }
+    nextSeq = seq + 1;
+    markApplied(seq);
+}
+
+
+void IngestJournal::sync()
+{
+    commitTimer.stop();
+
+    if (!current || current->syncedPos == current->writePos) {
+        pendingRecords = 0;
+        return;
+    }
+
+    if (!syncRange(current->file, current->base, current->writePos)) {
+        qWarning() << LogMsg::JOURNAL_SYNC_FAILED << current->file.fileName();
+        return;
+    }
+
+    current->syncedPos = current->writePos;
+    pendingRecords = 0;
+}
+
+
+void IngestJournal::dropAppliedSegments()
+{
+    while (!retired.empty() && retired.front()->lastSeq <= applied) {
+        Segment& seg = *retired.front();
+        closeSegment(seg);
+        QFile::remove(seg.file.fileName());
+        retired.pop_front();
+    }
+}
+
+// -------------------- Восстановление --------------------
+
+int IngestJournal::recover(const ReplayHandler& handler)
+{
+    int replayed = 0;
+    QStringList done;   // сегменты, все читаемые записи которых применены
+
+    const QString currentPath = current ? QFileInfo(current->file.fileName()).absoluteFilePath() : QString();
+
+    for (const QString& path : std::as_const(recoverFiles)) {
+        // Пустой сегмент прошлого запуска мог стать текущим (тот же первый номер)
+        if (QFileInfo(path).absoluteFilePath() == currentPath) {
+            continue;
+        }
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << LogMsg::JOURNAL_SEGMENT_UNREADABLE << path;
+            continue;
+        }
+
+        const uchar* base = file.map(0, file.size());
+        if (!base) {
+            qWarning() << LogMsg::JOURNAL_SEGMENT_UNREADABLE << path;
+            continue;
+        }
+
+        quint64 lastSeq = 0;
+        scanSegment(base, file.size(), [&](const RecordHeader& h, const uchar* body) {
+            if (h.seq <= applied) {
+                lastSeq = std::max(lastSeq, h.seq);
+                return true;
+            }
+
+            if (checksum(body, h.length) != h.checksum) {
+                qWarning() << LogMsg::JOURNAL_TORN_RECORD << h.seq;
+                return false;  // хвост сегмента повреждён
+            }
+
+            const char* bytes = reinterpret_cast<const char*>(body);
+            handler(h.seq, QString::fromUtf8(bytes, h.typeLength),
+                    QByteArray(bytes + h.typeLength, qsizetype(h.length - h.typeLength)));
+
+            markApplied(h.seq);
+            lastSeq = std::max(lastSeq, h.seq);
+            ++replayed;
+            return true;
+        });
+
+        file.unmap(const_cast<uchar*>(base));
+        file.close();
+
+        if (lastSeq <= applied) {
+            done.append(path);
+        }
+    }
+
+    sync();
+
+    // Удаляются только полностью применённые сегменты прошлого запуска
+    for (const QString& path : std::as_const(done)) {
+        QFile::remove(path);
+    }
+    recoverFiles.clear();
+
+    if (replayed > 0) {
+        qDebug() << LogMsg::JOURNAL_RECOVERED << replayed;
+    }
+    return replayed;
+}
@@ -0,0 +1,96 @@
+#ifndef INGESTJOURNAL_H
+#define INGESTJOURNAL_H
+
+#include "statuscodes.h"
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Журнал входящих сообщений: только дозапись, сегменты отображены в память.
+//
+// Каждое сообщение, пришедшее в Manager::handle, сначала попадает сюда
+// (memcpy в отображённый сегмент), потом обрабатывается. После обработки
+// Manager отмечает номер как применённый. При старте всё, что записано
+// после последнего применённого номера, проигрывается заново.
+//
+// Отметка пишется в заголовок сегмента и доходит до диска со следующей групповой
+// фиксацией, поэтому БД должна фиксировать вставки надёжно (DbInterface::requireDurableCommits),
+// а повтор уже записанного сообщения — не создавать вторую точку (номер записи хранится
+// в Points.journal_seq).
+//
+// Формат сегмента: заголовок SegmentHeader, затем записи RecordHeader + тип + данные,
+// выровненные по 8 байт. Нулевой magic — конец записей в сегменте.
+class IngestJournal : public QObject {
+    Q_OBJECT
+
+public:
+    using ReplayHandler = std::function<void(quint64 seq, const QString& type, const QByteArray& payload)>;
+
+    explicit IngestJournal(QObject* parent = nullptr);
+    ~IngestJournal();
+
+    // Открывает каталог журнала и начинает новый сегмент
+    StatusCode open(const QString& dir);
+    void close();
+
+    bool isOpen() const { return current != nullptr; }
+
+    // Дописывает сообщение в исходных байтах, возвращает его номер (0 — ошибка)
+    quint64 append(const QString& type, const QByteArray& payload);
+
+    // Сообщение обработано и сохранено в БД
+    void markApplied(quint64 seq);
+
+    // Номера до seq включительно уже есть в БД (журнал потерян или заменён): новые записи
+    // продолжают нумерацию после него, чтобы не совпасть с Points.journal_seq
+    void continueAfter(quint64 seq);
+
+    // Проигрывает записи, не отмеченные как применённые; возвращает их количество
+    int recover(const ReplayHandler& handler);
+
+    // Принудительная фиксация на диск (обычно вызывается групповой фиксацией)
+    void sync();
+
+    quint64 lastSeq() const { return nextSeq - 1; }
+    quint64 appliedSeq() const { return applied; }
+
+    // Среднее время append (мкс) — накладные расходы журнала на сообщение
+    double averageAppendUs() const { return appendCount ? appendNs / 1000.0 / appendCount : 0; }
+
+private:
+    struct Segment {
+        QFile file;
+        uchar* base = nullptr;
+        qint64 size = 0;
+        qint64 writePos = 0;
+        qint64 syncedPos = 0;
+        quint64 firstSeq = 0;
+        quint64 lastSeq = 0;
+    };
+
+    QString dir;
+    std::unique_ptr<Segment> current;
+    std::deque<std::unique_ptr<Segment>> retired;   // закрытые сегменты, ещё не полностью применённые
+    QStringList recoverFiles;                    // сегменты прошлого запуска
+
+    quint64 nextSeq = 1;
+    quint64 applied = 0;
+
+    int pendingRecords = 0;
+    QTimer commitTimer;
+
+    qint64 appendNs = 0;
+    qint64 appendCount = 0;
+
+    StatusCode openSegment(qint64 minSize);
+    void closeSegment(Segment& segment);
+    void dropAppliedSegments();
+    QString segmentPath(quint64 firstSeq) const;
+};
+
+#endif // INGESTJOURNAL_H
@@ -0,0 +1,14 @@
+#ifndef LOGJOURNAL_H
+#define LOGJOURNAL_H
+
+#include <QString>
+
+namespace LogMsg {
+const QString JOURNAL_FOUND_SEGMENTS      = "[Journal] Segments from previous run:";
+const QString JOURNAL_SEGMENT_UNREADABLE  = "[Journal] Cannot read segment:";
+const QString JOURNAL_TORN_RECORD         = "[Journal] Torn record, stopping scan at seq";
+const QString JOURNAL_SYNC_FAILED         = "[Journal] Sync failed:";
+const QString JOURNAL_RECOVERED           = "[Journal] Replayed uncommitted messages:";
+}
+
+#endif // LOGJOURNAL_H
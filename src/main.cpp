@@ -0,0 +1,120 @@
+// Основной процесс: БД, журнал входящих сообщений, Manager и, если собраны, миниатюры.
+// Сообщения робота передаёт сетевой модуль в Manager::handle / handleRaw.
+//
+//   AgroScout --shards sessions --journal journal
+//
+// Каждая сессия пишется в свой файл (ShardedDb): по умолчанию продолжается последняя
+// активная сессия (туда же проигрывается журнал прошлого запуска), --new-session начинает
+// новую, --session выбирает по id.
+//
+//   AgroScout --db agro.db --journal journal
+//
+// Всё в одном файле БД, как до разделения по сессиям.
+
+#include "config.h"
+#include "ingestjournal.h"
+#include "manager.h"
+#include "retentionengine.h"
+#include "shardeddb.h"
+#include "sqlitedb.h"
+#include "statusmapper.h"
+
+#ifdef AGRO_THUMBNAILS
+#include "thumbnailpipeline.h"
+#endif
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroScout");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"shards", "Directory with the session catalog and per-session files.", "path", Config::SHARD_ROOT_DIR},
+        {"session", "Session to continue.", "id"},
+        {"new-session", "Start a new session instead of continuing the last one."},
+        {"db", "Single database file instead of per-session files.", "path"},
+        {"journal", "Ingest journal directory.", "path", Config::JOURNAL_DIR},
+    });
+    parser.process(app);
+
+    SQLiteDb single;
+    ShardedDb sharded;
+    SQLiteDb* db = nullptr;
+    int sessionId = 1;
+
+    if (parser.isSet("db")) {
+        if (single.connect(parser.value("db")) != StatusCode::SUCCESS) {
+            return 1;
+        }
+        db = &single;
+    }
+    else {
+        if (sharded.open(parser.value("shards")) != StatusCode::SUCCESS) {
+            return 1;
+        }
+
+        const QVector<int> active = sharded.sessionIds();
+        if (parser.isSet("session")) {
+            sessionId = parser.value("session").toInt();
+        }
+        else if (!parser.isSet("new-session") && !active.isEmpty()) {
+            sessionId = active.last();
+        }
+        else {
+            const StatusCode st = sharded.createSession(
+                QDateTime::currentDateTime().toString(Qt::ISODate), sessionId);
+            if (st != StatusCode::SUCCESS) {
+                qWarning() << statusToMessage(st);
+                return 1;
+            }
+        }
+
+        db = sharded.session(sessionId);
+        if (!db) {
+            return 1;
+        }
+    }
+
+    Manager manager(db);
+    manager.setSession(sessionId);
+    manager.loadMlCache();
+
+#ifdef AGRO_THUMBNAILS
+    // Миниатюры новых изображений и тех, что сохранены до запуска
+    ThumbnailPipeline thumbnails(db);
+    thumbnails.start();
+#endif
+
+    // Сначала то, что не дошло до БД при прошлом запуске, затем приём новых сообщений
+    IngestJournal journal;
+    if (journal.open(parser.value("journal")) == StatusCode::SUCCESS) {
+        manager.setJournal(&journal);
+        manager.recoverFromJournal();
+    }
+
+    // Политики хранения (таблица Retention_policies) и сборка мусора блобов — в фоне,
+    // маленькими шагами между вставками
+    RetentionEngine retention(db);
+    retention.start();
+
+    const int rc = app.exec();
+
+    retention.stop();
+
+#ifdef AGRO_THUMBNAILS
+    thumbnails.stop();
+    thumbnails.flush();
+#endif
+
+    journal.close();
+    sharded.close();
+    single.disconnect();
+    return rc;
+}
@@ -9,7 +9,12 @@ const QString MANAGER_NEW_DATA        = "New DATA point...";
 const QString MANAGER_FAILED_POINT    = "Failed to create point";
 const QString MANAGER_FAILED_OBS      = "Failed to create observation";
 const QString MANAGER_ML_BEFORE_OBS   = "ML result received before any observation!";
+const QString MANAGER_ML_UNKNOWN_HASH = "ML result for a frame nobody is waiting for, image_hash:";
+const QString MANAGER_ML_PENDING_DROPPED = "Too many frames waiting for ML, dropped:";
 const QString MANAGER_UNKNOWN_TYPE    = "Unknown manager message type:";
+const QString MANAGER_ML_CACHE_HIT    = "ML result taken from cache,";
+const QString MANAGER_ML_CACHE_LOADED = "ML cache entries loaded:";
+const QString MANAGER_NO_FRAME_PLAN   = "Binary frame without a frame spec, spec id:";
 }
 
 #endif // LOGMANAGER_H
@@ -1,34 +1,143 @@
 #include "manager.h"
 #include "logmanager.h"
+#include "logmessages.h"
+#include "ingestjournal.h"
+#include "contenthash.h"
+#include "statusmapper.h"
+
+#include <QJsonDocument>
+
+
+void Manager::setJournal(IngestJournal* journal)
+{
+    this->journal = journal;
+    if (!journal) {
+        return;
+    }
+
+    const StatusCode st = db->requireDurableCommits();
+    if (st != StatusCode::SUCCESS) {
+        qWarning() << statusToMessage(st);
+    }
+
+    // Журнал новее БД не бывает; если он потерян, номера не должны совпасть с уже записанными
+    quint64 lastSeq = 0;
+    if (db->lastJournalSeq(lastSeq) == StatusCode::SUCCESS) {
+        journal->continueAfter(lastSeq);
+    }
+}
 
 
 void Manager::handle(const QString& type, const QJsonObject& json)
+{
+    if (!journal) {
+        dispatch(type, json);
+        return;
+    }
+
+    // Объект уже разобран — для журнала его приходится сериализовать. Сообщения из сети
+    // лучше передавать в handleRaw: там в журнал идут исходные байты без копии JSON
+    journalSeq = journal->append(type, QJsonDocument(json).toJson(QJsonDocument::Compact));
+    dispatch(type, json);
+    journal->markApplied(journalSeq);
+    journalSeq = 0;
+}
+
+
+void Manager::handleFrame(const QByteArray& frame)
+{
+    const std::shared_ptr<const FramePlan> plan = framePlans.plan(specId);
+    if (!plan) {
+        qWarning() << LogMsg::MANAGER_NO_FRAME_PLAN << specId;
+        return;
+    }
+
+    frameValues.resize(plan->channelCount());
+    if (!plan->decode(frame.constData(), int(frame.size()), frameValues.data())) {
+        qWarning() << LogMsg::DECODER_BAD_FRAME << specId << frame.size();
+        return;
+    }
+
+    // Журнал и БД хранят JSON, поэтому объект собирается один раз уже из готовых значений
+    handle("data", plan->toJson(frameValues.constData()));
+}
+
+
+void Manager::handleRaw(const QString& type, const QByteArray& payload)
+{
+    auto process = [&] {
+        if (type == "data") {
+            dispatchRaw(payload);
+        } else {
+            dispatch(type, QJsonDocument::fromJson(payload).object());
+        }
+    };
+
+    if (!journal) {
+        process();
+        return;
+    }
+
+    journalSeq = journal->append(type, payload);
+    process();
+    journal->markApplied(journalSeq);
+    journalSeq = 0;
+}
+
+
+int Manager::recoverFromJournal()
+{
+    if (!journal) {
+        return 0;
+    }
+
+    const int replayed = journal->recover([this](quint64 seq, const QString& type, const QByteArray& payload) {
+        journalSeq = seq;
+        if (type == "data") {
+            dispatchRaw(payload);
+        } else {
+            dispatch(type, QJsonDocument::fromJson(payload).object());
+        }
+    });
+    journalSeq = 0;
+    return replayed;
+}
+
+
+void Manager::dispatch(const QString& type, const QJsonObject& json)
 {
     if (type == "spec") {
         qDebug() << "[Manager]" << LogMsg::MANAGER_NEW_SPEC;
-        db->addSensorSpec(json);
+        // Повторная спецификация не пишется заново — приходит id уже сохранённой
+        db->addSensorSpec(json, &specId);
+        if (FramePlan::hasFrame(json)) {
+            framePlans.compile(specId, json);
+        }
         return;
     }
 
     if (type == "data") {
         qDebug() << "[Manager]" << LogMsg::MANAGER_NEW_DATA;
 
-        lastPointId = createPointFromJson(json);
+        const StatusCode st = createPointFromJson(json, &lastPointId);
 
-        if (lastPointId < 0) {
+        // Повтор записи журнала, которая уже дошла до БД до сбоя
+        if (st == StatusCode::JOURNAL_ALREADY_APPLIED) {
+            qDebug() << "[Manager]" << statusToMessage(st) << journalSeq;
+            return;
+        }
+        if (st != StatusCode::SUCCESS) {
+            lastPointId = -1;
             qWarning() << LogMsg::MANAGER_FAILED_POINT;
             return;
         }
 
-        // создаём observation
-        if (db->addObservation(lastPointId) != StatusCode::SUCCESS) {
+        // создаём observation, ID приходит сразу из вставки
+        if (db->addObservation(lastPointId, &lastObservationId) != StatusCode::SUCCESS) {
             qWarning() << LogMsg::MANAGER_FAILED_OBS;
             return;
         }
 
-        // получим ID observation (последняя вставка)
-        lastObservationId = db->lastInsertId();
-
         if (!robotInitialized) {
             emit updateRobotPos(json);
             robotInitialized = true;
@@ -36,23 +145,52 @@ void Manager::handle(const QString& type, const QJsonObject& json)
             emit updateRobotPos(json);
         }
 
-        emit sendCommand("ml", json);  // отправка на ML
+        // тот же кадр уже обрабатывался — берём результат из кэша
+        const quint64 imageHash = MLResultCache::imageHash(json);
+        if (imageHash != 0 && applyCachedMlResult(json, imageHash)) {
+            return;
+        }
+
+        requestMl(json, imageHash);  // отправка на ML
         return;
     }
 
     if (type == "ml_res") {
         qDebug() << "[Manager] ML RESULT:" << json;
 
-        if (lastObservationId < 0) {
-            qWarning() << LogMsg::MANAGER_ML_BEFORE_OBS;
-            return;
-        }
-
-        QString module = json["module"].toString("ml");
+        QString module = json["module"].toString(mlModule);
         QJsonObject res = json["data"].toObject();
 
+        // Кадр, для которого посчитан результат, — из image_hash запроса, который ML сервис
+        // возвращает в ответе: пока он считал, могли прийти следующие кадры
+        bool hashOk = false;
+        const quint64 imageHash = json.value("image_hash").toString().toULongLong(&hashOk, 16);
+        hashOk = hashOk && imageHash != 0;
+
+        const QVector<int> observations = hashOk ? pendingMl.take(imageHash) : QVector<int>{lastObservationId};
+        if (hashOk && observations.isEmpty()) {
+            qWarning() << LogMsg::MANAGER_ML_UNKNOWN_HASH << json.value("image_hash").toString();
+        }
+        for (int observationId : observations) {
+            if (observationId < 0) {
+                qWarning() << LogMsg::MANAGER_ML_BEFORE_OBS;
+                continue;
+            }
+            db->addMLResult(observationId, module, res);
+        }
 
-        db->addMLResult(lastObservationId, module, res);
+        // В кэше результат лежит под mlModule — тем же именем, под которым его ищут
+        if (hashOk) {
+            if (mlRequestTimer.isValid()) {
+                mlCache.recordMlLatency(mlRequestTimer.elapsed());
+                mlRequestTimer.invalidate();
+            }
+
+            mlCache.insert(imageHash, mlModule, res);
+            if (Config::ML_CACHE_PERSIST) {
+                db->addMLCacheEntry(ContentHash::toHex(imageHash), mlModule, res);
+            }
+        }
 
         emit newMlResults(res);
         return;
@@ -69,23 +207,131 @@ void Manager::handle(const QString& type, const QJsonObject& json)
     qWarning() << LogMsg::MANAGER_UNKNOWN_TYPE << type;
 }
 
+// Прогрев кэша из таблицы ML_cache
+void Manager::loadMlCache()
+{
+    const QVector<MLCacheRow> rows = db->loadMLCache(Config::ML_CACHE_PRELOAD_ROWS);
+
+    // Строки идут от новых к старым: вставляем с конца, чтобы новые оказались в начале LRU
+    for (auto it = rows.crbegin(); it != rows.crend(); ++it) {
+        bool ok = false;
+        quint64 hash = it->contentHash.toULongLong(&ok, 16);
+        if (ok) {
+            mlCache.insert(hash, it->moduleName, it->result);
+        }
+    }
+
+    qDebug() << "[Manager]" << LogMsg::MANAGER_ML_CACHE_LOADED << mlCache.size();
+}
+
+
+void Manager::requestMl(QJsonObject request, quint64 imageHash)
+{
+    // ML сервис возвращает image_hash в ответе — по нему результат находит своё наблюдение
+    // и ложится в кэш. Одинаковые кадры ждут один ответ
+    if (imageHash != 0) {
+        request["image_hash"] = ContentHash::toHex(imageHash);
+
+        // Сервис, потерявший ответы, не должен копить наблюдения без конца
+        if (pendingMl.size() >= Config::ML_PENDING_MAX && !pendingMl.contains(imageHash)) {
+            qWarning() << LogMsg::MANAGER_ML_PENDING_DROPPED << pendingMl.size();
+            pendingMl.clear();
+        }
+        pendingMl[imageHash].append(lastObservationId);
+    }
+
+    mlRequestTimer.start();
+    emit sendCommand("ml", request);
+}
+
+
+bool Manager::applyCachedMlResult(const QJsonObject& json, quint64 imageHash)
+{
+    QJsonObject cached;
+    if (!mlCache.lookup(imageHash, mlModule, cached)) {
+        return false;
+    }
+
+    // Карта ищет точку по координатам: подставляем текущие, а не координаты первого снимка
+    if (cached.contains("latitude") || cached.contains("longitude")) {
+        cached["latitude"] = json.value("latitude");
+        cached["longitude"] = json.value("longitude");
+    }
+
+    db->addMLResult(lastObservationId, mlModule, cached);
+    mlRequestTimer.invalidate();
+
+    const MLCacheStats& st = mlCache.stats();
+    qDebug() << "[Manager]" << LogMsg::MANAGER_ML_CACHE_HIT
+             << "hit rate" << st.hitRate() << "saved ms" << st.savedMs;
+
+    emit newMlResults(cached);
+    return true;
+}
+
+
+// "data" без полного разбора: координаты из разметки полей, в БД — исходные байты.
+// Карте и ML уходит объект без изображения; изображение добавляется, только если кадр
+// действительно пойдёт в ML (нет результата в кэше)
+void Manager::dispatchRaw(const QByteArray& payload)
+{
+    RawJson::Document doc;
+    if (!doc.parse(payload)) {
+        dispatch("data", QJsonDocument::fromJson(payload).object());
+        return;
+    }
+
+    qDebug() << "[Manager]" << LogMsg::MANAGER_NEW_DATA;
+
+    const double lat = doc.number(QLatin1String("latitude"));
+    const double lon = doc.number(QLatin1String("longitude"));
+
+    // field_id = 1 (пока статично), как в createPointFromJson
+    const StatusCode st = db->addPointRaw(1, sessionId, lat, lon, doc, specId, &lastPointId, journalSeq);
+    if (st == StatusCode::JOURNAL_ALREADY_APPLIED) {
+        qDebug() << "[Manager]" << statusToMessage(st) << journalSeq;
+        return;
+    }
+    if (st != StatusCode::SUCCESS) {
+        lastPointId = -1;
+        qWarning() << LogMsg::MANAGER_FAILED_POINT;
+        return;
+    }
+
+    if (db->addObservation(lastPointId, &lastObservationId) != StatusCode::SUCCESS) {
+        qWarning() << LogMsg::MANAGER_FAILED_OBS;
+        return;
+    }
+
+    const QJsonObject json = doc.toObject(false);
+    emit updateRobotPos(json);
+    robotInitialized = true;
+
+    const quint64 imageHash = MLResultCache::imageHash(doc);
+    if (imageHash != 0 && applyCachedMlResult(json, imageHash)) {
+        return;
+    }
+
+    // В ML — все поля "*_base64", а не только img_base64, по которому считается хеш
+    requestMl(doc.hasBase64() ? doc.toObject() : json, imageHash);
+}
+
+
 // Создание точки
-int Manager::createPointFromJson(const QJsonObject& json)
+StatusCode Manager::createPointFromJson(const QJsonObject& json, int* pointId)
 {
     double lat = json.value("latitude").toDouble(0);
     double lon = json.value("longitude").toDouble(0);
 
-    // field_id = 1, session_id = 1 (пока статично)
-    StatusCode st = db->addPoint(
+    // field_id = 1 (пока статично)
+    return db->addPoint(
         1,  // field
-        1,  // session
+        sessionId,
         lat,
         lon,
-        json // сохраняем весь json
+        json, // сохраняем весь json
+        specId,
+        pointId,
+        journalSeq
         );
-
-    if (st != StatusCode::SUCCESS)
-        return -1;
-
-    return db->lastInsertId();
 }
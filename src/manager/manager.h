@@ -2,20 +2,55 @@
 #define MANAGER_H
 
 #include <QObject>
+#include <QHash>
 #include <QJsonObject>
 #include <QDebug>
-#include "sqlitedb.h"
+#include <QElapsedTimer>
+#include "dbinterface.h"
+#include "mlresultcache.h"
+#include "framedecoder.h"
+
+class IngestJournal;
 
 class Manager : public QObject {
     Q_OBJECT
 
 public:
-    explicit Manager(SQLiteDb* db, QObject* parent = nullptr)
+    explicit Manager(DbInterface* db, QObject* parent = nullptr)
         : QObject(parent), db(db) {}
 
     // вызывается сетевым модулем!
     void handle(const QString& type, const QJsonObject& json);
 
+    // Двоичный кадр сенсоров по описанию из последней спецификации ("frame");
+    // разобранные значения идут дальше как сообщение "data"
+    void handleFrame(const QByteArray& frame);
+
+    // Сообщение в исходных байтах: в журнал идут сами байты. Для "data" разбираются
+    // только нужные поля и в БД тоже идут байты; остальные типы обрабатываются как в handle()
+    void handleRaw(const QString& type, const QByteArray& payload);
+
+    // Сессия, к которой относятся новые точки (с ShardedDb — та, чей файл передан как db)
+    void setSession(int sessionId) { this->sessionId = sessionId; }
+
+    // Журнал: каждое сообщение пишется в него до обработки. Вставки в БД с этого момента
+    // фиксируются надёжно (до отметки о применении), точки помечаются номером записи
+    void setJournal(IngestJournal* journal);
+
+    // Проигрывает сообщения, не дошедшие до БД при прошлом запуске
+    int recoverFromJournal();
+
+    // Кэш ML результатов: имя модуля, под которым результаты кладутся в кэш и ищутся
+    // в нём, и прогрев из БД.
+    //
+    // В запросе к ML есть "image_hash" — хеш кадра. ML сервис обязан вернуть его в ответе
+    // ml_res без изменений: по нему результат привязывается к наблюдению этого кадра
+    // (а не к последнему — пока сервис считал, могли прийти следующие кадры) и кладётся в кэш.
+    // Ответ без image_hash привязывается к последнему наблюдению и не кэшируется
+    void setMlModule(const QString& module) { mlModule = module; }
+    void loadMlCache();
+    const MLCacheStats& mlCacheStats() const { return mlCache.stats(); }
+
 signals:
     void sendCommand(const QString& where, const QJsonObject& data);
 
@@ -25,14 +60,29 @@ signals:
     void newMlResults(const QJsonObject& json);
 
 private:
-    SQLiteDb* db;
+    DbInterface* db;
+    IngestJournal* journal = nullptr;
+    quint64 journalSeq = 0;     // номер обрабатываемой записи журнала (0 — не из журнала)
 
+    int sessionId = 1;
+    int specId = -1;            // последняя спецификация сенсоров, для Points.spec_id
     int lastPointId = -1;       // для привязки ML результатов
     int lastObservationId = -1; // для ML
 
     bool robotInitialized = false;
 
-    int createPointFromJson(const QJsonObject& json);
+    MLResultCache mlCache;
+    FramePlanCache framePlans;
+    QVector<double> frameValues;    // буфер разбора кадра, чтобы не выделять память на каждый
+    QString mlModule = "ml";
+    QElapsedTimer mlRequestTimer;   // задержка ответа ML
+    QHash<quint64, QVector<int>> pendingMl;   // хеш кадра → наблюдения, ждущие ответа ML
+
+    void dispatch(const QString& type, const QJsonObject& json);
+    void dispatchRaw(const QByteArray& payload);
+    StatusCode createPointFromJson(const QJsonObject& json, int* pointId);
+    void requestMl(QJsonObject request, quint64 imageHash);
+    bool applyCachedMlResult(const QJsonObject& json, quint64 imageHash);
 };
 
 #endif
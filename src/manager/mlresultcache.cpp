@@ -0,0 +1,102 @@
+#include "mlresultcache.h"
+#include "contenthash.h"
+
+#include <QJsonDocument>
+
+MLResultCache::MLResultCache(qint64 maxBytes)
+    : maxBytes(maxBytes)
+{}
+
+
+quint64 MLResultCache::imageHash(const QJsonObject& robotData)
+{
+    QJsonValue img = robotData.value("img_base64");
+    if (!img.isString()) {
+        return 0;
+    }
+
+    // Хешируем строку base64 как есть: одинаковые кадры дают одинаковую строку,
+    // декодировать изображение ради ключа не нужно
+    const QByteArray bytes = img.toString().toLatin1();
+    return bytes.isEmpty() ? 0 : ContentHash::hash64(bytes);
+}
+
+
+// Тот же хеш по байтам строки прямо из сообщения
+quint64 MLResultCache::imageHash(const RawJson::Document& robotData)
+{
+    const RawJson::Field* img = robotData.find(QLatin1String("img_base64"));
+    if (!img || img->kind != RawJson::Kind::String) {
+        return 0;
+    }
+
+    const QByteArray bytes = robotData.stringBytes(*img);
+    return bytes.isEmpty() ? 0 : ContentHash::hash64(bytes);
+}
+
+
+bool MLResultCache::lookup(quint64 hash, const QString& module, QJsonObject& result)
+{
+    auto it = index.find(Key(hash, module));
+    if (it == index.end()) {
+        ++cacheStats.misses;
+        return false;
+    }
+
+    lru.splice(lru.begin(), lru, it.value());
+    result = it.value()->result;
+
+    ++cacheStats.hits;
+    cacheStats.savedMs += avgLatencyMs;
+    return true;
+}
+
+
+void MLResultCache::insert(quint64 hash, const QString& module, const QJsonObject& result)
+{
+    const Key key(hash, module);
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        usedBytes -= it.value()->bytes;
+        lru.erase(it.value());
+        index.erase(it);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.result = result;
+    entry.bytes = QJsonDocument(result).toJson(QJsonDocument::Compact).size() + module.size() * 2 + sizeof(Entry);
+
+    lru.push_front(entry);
+    index.insert(key, lru.begin());
+    usedBytes += entry.bytes;
+
+    evict();
+}
+
+
+void MLResultCache::clear()
+{
+    lru.clear();
+    index.clear();
+    usedBytes = 0;
+}
+
+
+void MLResultCache::recordMlLatency(double ms)
+{
+    ++latencySamples;
+    avgLatencyMs += (ms - avgLatencyMs) / latencySamples;
+}
+
+
+void MLResultCache::evict()
+{
+    while (usedBytes > maxBytes && lru.size() > 1) {
+        const Entry& last = lru.back();
+        usedBytes -= last.bytes;
+        index.remove(last.key);
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef MLRESULTCACHE_H
+#define MLRESULTCACHE_H
+
+#include "config.h"
+#include "rawjson.h"
+
+#include <QHash>
+#include <QJsonObject>
+#include <QPair>
+#include <QString>
+
+#include <list>
+
+// Статистика кэша ML результатов
+struct MLCacheStats {
+    qint64 hits = 0;
+    qint64 misses = 0;
+    double savedMs = 0;   // сэкономленное время ожидания ML сервиса (по средней задержке)
+
+    double hitRate() const { return hits + misses > 0 ? double(hits) / (hits + misses) : 0; }
+};
+
+// Кэш ML результатов по хешу содержимого изображения и имени модуля.
+// Робот часто снимает одно и то же растение повторно (остановка, разворот) —
+// такой кадр не нужно заново отправлять в ML сервис.
+// Размер ограничен по памяти, вытесняется давно не использованное (LRU).
+class MLResultCache
+{
+public:
+    explicit MLResultCache(qint64 maxBytes = Config::ML_CACHE_MAX_BYTES);
+
+    // Хеш изображения из данных робота; 0 — изображения нет
+    static quint64 imageHash(const QJsonObject& robotData);
+    static quint64 imageHash(const RawJson::Document& robotData);
+
+    bool lookup(quint64 hash, const QString& module, QJsonObject& result);
+    void insert(quint64 hash, const QString& module, const QJsonObject& result);
+    void clear();
+
+    // Задержка ответа ML сервиса — из неё считается сэкономленное время
+    void recordMlLatency(double ms);
+    double averageMlLatencyMs() const { return avgLatencyMs; }
+
+    const MLCacheStats& stats() const { return cacheStats; }
+    int size() const { return index.size(); }
+    qint64 bytes() const { return usedBytes; }
+
+private:
+    using Key = QPair<quint64, QString>;
+
+    struct Entry {
+        Key key;
+        QJsonObject result;
+        qint64 bytes = 0;
+    };
+
+    std::list<Entry> lru;   // в начале — последние использованные
+    QHash<Key, std::list<Entry>::iterator> index;
+
+    qint64 maxBytes;
+    qint64 usedBytes = 0;
+
+    MLCacheStats cacheStats;
+    double avgLatencyMs = 0;
+    qint64 latencySamples = 0;
+
+    void evict();
+};
+
+#endif // MLRESULTCACHE_H
@@ -0,0 +1,15 @@
+#ifndef LOGREPLAY_H
+#define LOGREPLAY_H
+
+#include <QString>
+
+namespace LogMsg {
+const QString REPLAY_LOADED             = "[Replay] Events loaded:";
+const QString REPLAY_EMPTY_SESSION      = "[Replay] Session has no points:";
+const QString REPLAY_BAD_CAPTURE_LINE   = "[Replay] Skipping malformed capture line:";
+const QString REPLAY_NOTHING_TO_PLAY    = "[Replay] Nothing to replay";
+const QString REPLAY_STARTED            = "[Replay] Started, events:";
+const QString REPLAY_FINISHED           = "[Replay] Finished:";
+}
+
+#endif // LOGREPLAY_H
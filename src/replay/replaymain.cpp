@@ -0,0 +1,94 @@
+// Прогон записанной сессии через Manager: нагрузочный тест БД и менеджера.
+//
+//   AgroReplay --source agro.db --session 3 --target replay.db --speed 0
+//   AgroReplay --capture session.jsonl --target replay.db --speed 10
+//   AgroReplay --capture session.jsonl --memory --speed 0 [--target snapshot.db]
+
+#include "manager.h"
+#include "memorydb.h"
+#include "sessionreplayer.h"
+#include "sqlitedb.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include <memory>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("AgroReplay");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOptions({
+        {"source", "Database to read the session from.", "path"},
+        {"session", "Session id in the source database.", "id", "1"},
+        {"capture", "Capture file (JSON Lines) to replay instead of a database.", "path"},
+        {"save-capture", "Save loaded events to a capture file and exit.", "path"},
+        {"target", "Database the replay is written into.", "path"},
+        {"speed", "1 = real time, N = N times faster, 0 = as fast as possible.", "factor", "1"},
+        {"memory", "Replay into an in-memory database; --target (optional) receives a snapshot at exit."},
+    });
+    parser.process(app);
+
+    // В памяти — без файлового ввода-вывода: меряется сам Manager
+    const bool inMemory = parser.isSet("memory");
+    std::unique_ptr<DbInterface> db;
+    if (inMemory) {
+        db = std::make_unique<MemoryDb>();
+    }
+    else {
+        db = std::make_unique<SQLiteDb>();
+    }
+    Manager manager(db.get());
+    SessionReplayer replayer(&manager);
+
+    if (parser.isSet("capture")) {
+        if (replayer.loadCapture(parser.value("capture")) != StatusCode::SUCCESS) {
+            return 1;
+        }
+    }
+    else if (parser.isSet("source")) {
+        // Исходная БД только читается — отдельное соединение без права записи
+        SQLiteDb source("agro_replay_source", true);
+        if (source.connect(parser.value("source")) != StatusCode::SUCCESS) {
+            return 1;
+        }
+        StatusCode st = replayer.loadFromDb(&source, parser.value("session").toInt());
+        source.disconnect();
+        if (st != StatusCode::SUCCESS) {
+            return 1;
+        }
+    }
+    else {
+        parser.showHelp(1);
+    }
+
+    if (parser.isSet("save-capture")) {
+        return SessionReplayer::saveCapture(parser.value("save-capture"), replayer.loadedEvents()) == StatusCode::SUCCESS ? 0 : 1;
+    }
+
+    if ((!inMemory && !parser.isSet("target")) || db->connect(parser.value("target")) != StatusCode::SUCCESS) {
+        qWarning() << "[Replay] Target database is required";
+        return 1;
+    }
+
+    QObject::connect(&replayer, &SessionReplayer::finished, &app, [&app](const ReplayStats& stats) {
+        qInfo().noquote() << QString("events=%1 wall_ms=%2 virtual_ms=%3 events_per_sec=%4 "
+                                     "handle_us avg=%5 p50=%6 p99=%7 max=%8")
+                                 .arg(stats.events)
+                                 .arg(stats.wallMs)
+                                 .arg(stats.virtualMs)
+                                 .arg(stats.eventsPerSec(), 0, 'f', 1)
+                                 .arg(stats.avgHandleUs, 0, 'f', 1)
+                                 .arg(stats.p50HandleUs, 0, 'f', 1)
+                                 .arg(stats.p99HandleUs, 0, 'f', 1)
+                                 .arg(stats.maxHandleUs, 0, 'f', 1);
+        app.quit();
+    });
+
+    replayer.start(parser.value("speed").toDouble());
+    return app.exec();
+}
@@ -0,0 +1,340 @@
+#include "sessionreplayer.h"
+#include "logreplay.h"
+#include "manager.h"
+#include "mlresultcache.h"
+#include "contenthash.h"
+#include "sqlitedb.h"
+#include "sqlqueries.h"
+#include "statusmapper.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+// Сколько событий обрабатывается за один проход цикла событий в режиме «максимально быстро»
+constexpr int ASAP_BATCH = 256;
+
+qint64 parseDbTimestamp(const QVariant& value)
+{
+    QDateTime dt = QDateTime::fromString(value.toString(), "yyyy-MM-dd HH:mm:ss");
+    dt.setTimeSpec(Qt::UTC);
+    return dt.isValid() ? dt.toMSecsSinceEpoch() : 0;
+}
+}
+
+
+SessionReplayer::SessionReplayer(Manager* manager, QObject* parent)
+    : QObject(parent), manager(manager)
+{
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, this, &SessionReplayer::step);
+}
+
+// -------------------- Загрузка записи --------------------
+
+StatusCode SessionReplayer::loadFromDb(SQLiteDb* db, int sessionId)
+{
+    // Сессия читается курсором: в памяти остаются только события, а не копия результата
+    SqlCursor cursor = db->select(SqlQueries::SESSION_REPLAY, {{":session", sessionId}});
+
+    if (!cursor.isValid()) {
+        return cursor.status();
+    }
+
+    const int colPointId = cursor.column("point_id");
+    const int colData = cursor.column("data_json");
+    const int colCreated = cursor.column("created_at");
+    const int colSpecId = cursor.column("spec_id");
+    const int colSpec = cursor.column("spec_json");
+    const int colModule = cursor.column("module_name");
+    const int colResults = cursor.column("results_json");
+    const int colMlCreated = cursor.column("ml_created_at");
+
+    events.clear();
+    int lastPointId = -1;
+    int lastSpecId = -1;
+    quint64 lastImageHash = 0;
+
+    while (cursor.next()) {
+        int pointId = cursor.toInt(colPointId);
+
+        // Точка: одно сообщение data, дальше — её ML результаты
+        if (pointId != lastPointId) {
+            const qint64 timestampMs = parseDbTimestamp(cursor.value(colCreated));
+
+            // Как в живом потоке: спецификация приходит раньше данных, которые она описывает
+            const int specId = cursor.isNull(colSpecId) ? -1 : cursor.toInt(colSpecId);
+            if (specId >= 0 && specId != lastSpecId && !cursor.isNull(colSpec)) {
+                ReplayEvent spec;
+                spec.timestampMs = timestampMs;
+                spec.type = "spec";
+                spec.json = QJsonDocument::fromJson(cursor.toBytes(colSpec)).object();
+                events.append(spec);
+                lastSpecId = specId;
+            }
+
+            ReplayEvent ev;
+            ev.timestampMs = timestampMs;
+            ev.type = "data";
+            // Кадры хранятся в блобах — Manager ждёт их в img_base64, как от робота
+            ev.json = db->blobStore().inlineBlobs(QJsonDocument::fromJson(cursor.toBytes(colData)).object());
+            lastImageHash = MLResultCache::imageHash(ev.json);
+            events.append(ev);
+            lastPointId = pointId;
+        }
+
+        if (cursor.isNull(colModule)) {
+            continue;
+        }
+
+        // Результат идёт сразу за своей точкой и, как у ML сервиса, несёт image_hash кадра;
+        // без изображения Manager привязывает его к последнему наблюдению
+        ReplayEvent ml;
+        ml.timestampMs = std::max(events.last().timestampMs, parseDbTimestamp(cursor.value(colMlCreated)));
+        ml.type = "ml_res";
+        ml.json["module"] = cursor.toString(colModule);
+        if (lastImageHash != 0) {
+            ml.json["image_hash"] = ContentHash::toHex(lastImageHash);
+        }
+        ml.json["data"] = db->blobStore().inlineBlobs(QJsonDocument::fromJson(cursor.toBytes(colResults)).object());
+        events.append(ml);
+    }
+
+    if (events.isEmpty()) {
+        qWarning() << LogMsg::REPLAY_EMPTY_SESSION << sessionId;
+        return StatusCode::DB_QUERY_FAILED;
+    }
+
+    // Поздний ML результат не должен обгонять следующую точку
+    for (int i = events.size() - 2; i >= 0; --i) {
+        events[i].timestampMs = std::min(events[i].timestampMs, events[i + 1].timestampMs);
+    }
+
+    // created_at хранится с точностью до секунды
+    spreadEqualTimestamps(events);
+
+    // Время событий — от начала сессии, как в файле записи
+    const qint64 t0 = events.first().timestampMs;
+    for (ReplayEvent& ev : events) {
+        ev.timestampMs -= t0;
+    }
+
+    qDebug() << LogMsg::REPLAY_LOADED << events.size();
+    return StatusCode::SUCCESS;
+}
+
+
+StatusCode SessionReplayer::loadCapture(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << statusToMessage(StatusCode::FILE_NOT_FOUND) << path;
+        return StatusCode::FILE_NOT_FOUND;
+    }
+
+    events.clear();
+
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonObject obj = QJsonDocument::fromJson(line).object();
+        if (!obj.contains("type")) {
+            qWarning() << LogMsg::REPLAY_BAD_CAPTURE_LINE << line.left(80);
+            continue;
+        }
+
+        ReplayEvent ev;
+        ev.timestampMs = qint64(obj.value("t").toDouble());
+        ev.type = obj.value("type").toString();
+        ev.json = obj.value("json").toObject();
+        events.append(ev);
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const ReplayEvent& a, const ReplayEvent& b) { return a.timestampMs < b.timestampMs; });
+
+    qDebug() << LogMsg::REPLAY_LOADED << events.size();
+    return events.isEmpty() ? StatusCode::UNKNOWN_ERROR : StatusCode::SUCCESS;
+}
+
+
+StatusCode SessionReplayer::saveCapture(const QString& path, const QVector<ReplayEvent>& events)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << statusToMessage(StatusCode::FILE_NOT_FOUND) << path;
+        return StatusCode::FILE_NOT_FOUND;
+    }
+
+    const qint64 t0 = events.isEmpty() ? 0 : events.first().timestampMs;
+
+    for (const ReplayEvent& ev : events) {
+        QJsonObject obj;
+        obj["t"] = ev.timestampMs - t0;
+        obj["type"] = ev.type;
+        obj["json"] = ev.json;
+        file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+
+    return StatusCode::SUCCESS;
+}
+
+
+// Равномерно раскладывает события с одинаковой меткой по интервалу до следующей метки.
+// Раскладка зависит только от записи, поэтому прогон остаётся детерминированным.
+void SessionReplayer::spreadEqualTimestamps(QVector<ReplayEvent>& events)
+{
+    int i = 0;
+    while (i < events.size()) {
+        int j = i;
+        while (j < events.size() && events[j].timestampMs == events[i].timestampMs) {
+            ++j;
+        }
+
+        const qint64 begin = events[i].timestampMs;
+        const qint64 end = j < events.size() ? events[j].timestampMs : begin + 1000;
+        const int count = j - i;
+
+        for (int k = 1; k < count; ++k) {
+            events[i + k].timestampMs = begin + (end - begin) * k / count;
+        }
+        i = j;
+    }
+}
+
+// -------------------- Воспроизведение --------------------
+
+void SessionReplayer::start(double speed)
+{
+    if (events.isEmpty() || !manager) {
+        qWarning() << LogMsg::REPLAY_NOTHING_TO_PLAY;
+        return;
+    }
+
+    this->speed = speed;
+    nextIndex = 0;
+    running = true;
+
+    handleNs.clear();
+    handleNs.reserve(events.size());
+
+    virtualClock.reset(events.first().timestampMs);
+    wallTimer.start();
+
+    qDebug() << LogMsg::REPLAY_STARTED << events.size() << "speed" << speed;
+    timer.start(0);
+}
+
+
+void SessionReplayer::stop()
+{
+    if (!running) {
+        return;
+    }
+    timer.stop();
+    finish();
+}
+
+
+void SessionReplayer::step()
+{
+    if (!running) {
+        return;
+    }
+
+    const qint64 t0 = events.first().timestampMs;
+    int processed = 0;
+
+    while (nextIndex < events.size()) {
+        const ReplayEvent& ev = events[nextIndex];
+
+        if (speed > 0) {
+            const qint64 dueMs = qint64((ev.timestampMs - t0) / speed);
+            if (dueMs > wallTimer.elapsed()) {
+                break;
+            }
+        }
+        else if (processed >= ASAP_BATCH) {
+            break;  // отдаём управление циклу событий, чтобы карта успевала перерисовываться
+        }
+
+        virtualClock.advanceTo(ev.timestampMs);
+        dispatch(ev);
+
+        ++nextIndex;
+        ++processed;
+    }
+
+    if (processed > 0) {
+        emit progress(nextIndex, events.size());
+    }
+
+    if (nextIndex >= events.size()) {
+        finish();
+        return;
+    }
+
+    scheduleNext();
+}
+
+
+void SessionReplayer::dispatch(const ReplayEvent& event)
+{
+    QElapsedTimer handleTimer;
+    handleTimer.start();
+
+    manager->handle(event.type, event.json);
+
+    handleNs.append(handleTimer.nsecsElapsed());
+}
+
+
+void SessionReplayer::scheduleNext()
+{
+    if (speed <= 0) {
+        timer.start(0);
+        return;
+    }
+
+    const qint64 t0 = events.first().timestampMs;
+    const qint64 dueMs = qint64((events[nextIndex].timestampMs - t0) / speed);
+    timer.start(int(std::max<qint64>(0, dueMs - wallTimer.elapsed())));
+}
+
+
+void SessionReplayer::finish()
+{
+    running = false;
+
+    ReplayStats stats;
+    stats.events = handleNs.size();
+    stats.wallMs = wallTimer.elapsed();
+    stats.virtualMs = virtualClock.now() - events.first().timestampMs;
+
+    if (!handleNs.isEmpty()) {
+        QVector<qint64> sorted = handleNs;
+        std::sort(sorted.begin(), sorted.end());
+
+        qint64 total = 0;
+        for (qint64 ns : std::as_const(sorted)) {
+            total += ns;
+        }
+
+        stats.avgHandleUs = total / 1000.0 / sorted.size();
+        stats.p50HandleUs = sorted[sorted.size() / 2] / 1000.0;
+        stats.p99HandleUs = sorted[std::min<qsizetype>(sorted.size() - 1, sorted.size() * 99 / 100)] / 1000.0;
+        stats.maxHandleUs = sorted.last() / 1000.0;
+    }
+
+    qDebug() << LogMsg::REPLAY_FINISHED << stats.events << "events in" << stats.wallMs << "ms";
+    emit finished(stats);
+}
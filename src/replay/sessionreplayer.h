@@ -0,0 +1,88 @@
+#ifndef SESSIONREPLAYER_H
+#define SESSIONREPLAYER_H
+
+#include "virtualclock.h"
+#include "statuscodes.h"
+
+#include <QObject>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+
+class Manager;
+class SQLiteDb;
+
+// Одно записанное сообщение сессии
+struct ReplayEvent {
+    qint64 timestampMs = 0;  // время от начала сессии (мс): первое событие — 0
+    QString type;            // тип сообщения для Manager::handle (spec / data / ml_res / command)
+    QJsonObject json;
+};
+
+// Итог прогона: пропускная способность и задержка Manager::handle
+struct ReplayStats {
+    int events = 0;
+    qint64 wallMs = 0;       // реальное время прогона
+    qint64 virtualMs = 0;    // длительность записанной сессии
+
+    double avgHandleUs = 0;
+    double p50HandleUs = 0;
+    double p99HandleUs = 0;
+    double maxHandleUs = 0;
+
+    double eventsPerSec() const { return wallMs > 0 ? events * 1000.0 / wallMs : 0; }
+};
+
+// Воспроизводит записанную сессию через Manager::handle:
+// в реальном времени, с ускорением в N раз или так быстро, как получится.
+class SessionReplayer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SessionReplayer(Manager* manager, QObject* parent = nullptr);
+
+    // Загрузка сессии из таблиц Points / Observations / ML_results
+    StatusCode loadFromDb(SQLiteDb* db, int sessionId);
+
+    // Загрузка / сохранение файла записи (JSON Lines: {"t":..., "type":..., "json":{...}})
+    StatusCode loadCapture(const QString& path);
+    static StatusCode saveCapture(const QString& path, const QVector<ReplayEvent>& events);
+
+    void setEvents(const QVector<ReplayEvent>& events) { this->events = events; }
+    const QVector<ReplayEvent>& loadedEvents() const { return events; }
+
+    // speed = 1 — реальное время, N — ускорение в N раз, 0 — максимально быстро
+    void start(double speed = 1.0);
+    void stop();
+
+    bool isRunning() const { return running; }
+    const VirtualClock& clock() const { return virtualClock; }
+
+signals:
+    void progress(int processed, int total);
+    void finished(const ReplayStats& stats);
+
+private:
+    Manager* manager;
+
+    QVector<ReplayEvent> events;
+    QVector<qint64> handleNs;   // задержка каждого вызова handle
+
+    VirtualClock virtualClock;
+    QElapsedTimer wallTimer;
+    QTimer timer;
+
+    double speed = 1.0;
+    int nextIndex = 0;
+    bool running = false;
+
+    void step();
+    void dispatch(const ReplayEvent& event);
+    void scheduleNext();
+    void finish();
+
+    static void spreadEqualTimestamps(QVector<ReplayEvent>& events);
+};
+
+#endif // SESSIONREPLAYER_H
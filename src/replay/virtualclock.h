@@ -0,0 +1,28 @@
+#ifndef VIRTUALCLOCK_H
+#define VIRTUALCLOCK_H
+
+#include <QtGlobal>
+
+// Детерминированные виртуальные часы для воспроизведения сессий.
+// Время двигается только вперёд и только по меткам событий записи,
+// поэтому повторный прогон одной и той же сессии даёт тот же порядок событий.
+class VirtualClock
+{
+public:
+    void reset(qint64 startMs = 0) { nowMs = startMs; }
+
+    qint64 now() const { return nowMs; }
+
+    // Сдвигает часы к метке события (назад время не идёт)
+    void advanceTo(qint64 timestampMs)
+    {
+        if (timestampMs > nowMs) {
+            nowMs = timestampMs;
+        }
+    }
+
+private:
+    qint64 nowMs = 0;
+};
+
+#endif // VIRTUALCLOCK_H
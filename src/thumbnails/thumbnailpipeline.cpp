@@ -0,0 +1,278 @@
+#include "thumbnailpipeline.h"
+#include "config.h"
+#include "logmessages.h"
+#include "sqlqueries.h"
+#include "statusmapper.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QImage>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSqlError>
+#include <QDebug>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Задач в пуле на поток: пока одна декодируется, следующая уже ждёт
+const int TASKS_PER_WORKER = 2;
+
+// Миниатюры без прозрачности — JPEG (фото с камеры), с прозрачностью (маски) — PNG
+QByteArray encode(const QImage& image)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+
+    const bool alpha = image.hasAlphaChannel();
+    if (!image.save(&buffer, alpha ? "PNG" : "JPG", alpha ? -1 : Config::THUMBNAIL_JPEG_QUALITY)) {
+        return QByteArray();
+    }
+    return bytes;
+}
+}
+
+
+ThumbnailPipeline::ThumbnailPipeline(SQLiteDb* db, QObject* parent)
+    : QObject(parent), db(db)
+{
+    pool.setMaxThreadCount(Config::THUMBNAIL_WORKERS);
+
+    timer.setInterval(Config::THUMBNAIL_TICK_MS);
+    connect(&timer, &QTimer::timeout, this, &ThumbnailPipeline::tick);
+}
+
+
+ThumbnailPipeline::~ThumbnailPipeline()
+{
+    stop();
+    pool.clear();
+    pool.waitForDone();
+}
+
+
+void ThumbnailPipeline::start()
+{
+    db->blobStore().setStoredObserver([this](const QString& hash) { enqueue(hash); });
+    timer.start();
+}
+
+
+void ThumbnailPipeline::stop()
+{
+    db->blobStore().setStoredObserver(nullptr);
+    timer.stop();
+}
+
+
+void ThumbnailPipeline::enqueue(const QString& blobHash)
+{
+    if (queued.contains(blobHash) || inFlight.contains(blobHash)) {
+        return;
+    }
+    queued.insert(blobHash);
+    queue.push_back(blobHash);
+}
+
+
+void ThumbnailPipeline::flush()
+{
+    pool.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+
+void ThumbnailPipeline::tick()
+{
+    if (queue.empty() && !backfillDone) {
+        scanBacklog();
+    }
+
+    const int capacity = pool.maxThreadCount() * TASKS_PER_WORKER;
+
+    while (inFlight.size() < capacity && !queue.empty()) {
+        const QString hash = queue.front();
+        queue.pop_front();
+        queued.remove(hash);
+
+        // Одинаковый кадр мог прийти повторно — миниатюры у него уже есть
+        if (hasThumbnails(hash)) {
+            continue;
+        }
+
+        inFlight.insert(hash);
+        const QString path = db->blobStore().path(hash);
+
+        pool.start(QRunnable::create([this, hash, path] {
+            const Result result = render(hash, path);
+            QMetaObject::invokeMethod(this, [this, result] { store(result); }, Qt::QueuedConnection);
+        }));
+    }
+}
+
+
+// Блобы без строк в Thumbnails, кроме самих миниатюр. Обработанные получают строку
+// (хотя бы отметку size = 0), так что просмотр заканчивается, когда старые блобы разобраны.
+// Пачки идут по первичному ключу с хэша, на котором остановилась предыдущая: таблица
+// Blobs за вызов не читается целиком
+void ThumbnailPipeline::scanBacklog()
+{
+    int rows = 0;
+
+    const StatusCode st = db->forEachRow(
+        SqlQueries::THUMBNAIL_BACKLOG,
+        [this, &rows](const SqlCursor& row) {
+            const QString hash = row.toString(0);
+            backlogAfter = hash;
+            ++rows;
+            if (!inFlight.contains(hash)) {
+                enqueue(hash);
+                ++backlogFound;
+            }
+            return true;
+        },
+        {{":after", backlogAfter}, {":limit", Config::THUMBNAIL_SCAN_BATCH}});
+
+    if (st != StatusCode::SUCCESS || rows == Config::THUMBNAIL_SCAN_BATCH) {
+        return;
+    }
+
+    // Проход дошёл до конца таблицы. Ничего не нашлось и ничего не в работе —
+    // дальше новые блобы приходят только от BlobStore; иначе следующий проход с начала
+    if (backlogFound == 0 && inFlight.isEmpty()) {
+        backfillDone = true;
+    }
+    backlogAfter = QStringLiteral("");
+    backlogFound = 0;
+}
+
+
+bool ThumbnailPipeline::hasThumbnails(const QString& blobHash)
+{
+    bool exists = false;
+    db->forEachRow("SELECT 1 FROM Thumbnails WHERE blob_hash = :hash LIMIT 1",
+                   [&exists](const SqlCursor&) {
+                       exists = true;
+                       return false;
+                   },
+                   {{":hash", blobHash}});
+    return exists;
+}
+
+
+ThumbnailPipeline::Result ThumbnailPipeline::render(const QString& blobHash, const QString& path)
+{
+    Result result;
+    result.blobHash = blobHash;
+
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        return result;
+    }
+    result.image = true;
+
+    // Кадр разбирается один раз; каждый следующий размер уменьшается из предыдущего,
+    // а не из полного кадра
+    const int longest = std::max(image.width(), image.height());
+
+    for (auto it = std::rbegin(Config::THUMBNAIL_SIZES); it != std::rend(Config::THUMBNAIL_SIZES); ++it) {
+        const int size = *it;
+        if (size >= longest) {
+            continue;   // не увеличиваем: для мелкого кадра нужен сам кадр
+        }
+
+        image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+        Rendered thumb;
+        thumb.size = size;
+        thumb.width = image.width();
+        thumb.height = image.height();
+        thumb.bytes = encode(image);
+        if (!thumb.bytes.isEmpty()) {
+            result.thumbnails.prepend(thumb);
+        }
+    }
+
+    return result;
+}
+
+
+void ThumbnailPipeline::store(const Result& result)
+{
+    inFlight.remove(result.blobHash);
+
+    QSqlDatabase conn = QSqlDatabase::database(db->connectionName(), false);
+    if (!conn.transaction()) {
+        qWarning() << statusToMessage(StatusCode::DB_QUERY_FAILED) << conn.lastError().text();
+        return;
+    }
+
+    // Пока шло декодирование, блоб мог потерять последнюю ссылку или получить миниатюры
+    bool alive = false;
+    db->forEachRow("SELECT refcount FROM Blobs WHERE hash = :hash",
+                   [&alive](const SqlCursor& row) {
+                       alive = row.toInt(0) > 0;
+                       return false;
+                   },
+                   {{":hash", result.blobHash}});
+
+    if (!alive || hasThumbnails(result.blobHash)) {
+        conn.rollback();
+        return;
+    }
+
+    StatusCode st = StatusCode::SUCCESS;
+    QVector<ThumbnailRow> rows;
+
+    if (result.thumbnails.isEmpty()) {
+        // Не изображение или кадр меньше наименьшей миниатюры: отметка, чтобы не разбирать снова
+        st = db->exec("INSERT OR IGNORE INTO Thumbnails (blob_hash, size) VALUES (:blob, 0)",
+                      {{":blob", result.blobHash}});
+    }
+
+    for (const Rendered& thumb : result.thumbnails) {
+        if (st != StatusCode::SUCCESS) {
+            break;
+        }
+
+        ThumbnailRow row;
+        row.size = thumb.size;
+        row.width = thumb.width;
+        row.height = thumb.height;
+
+        // Файл пишется до фиксации, как у всех блобов: после сбоя строка не укажет на пустое
+        // место, а файл откаченной транзакции уберёт BlobStore::sweepOrphanFiles
+        st = db->blobStore().put(thumb.bytes, row.hash);
+        if (st == StatusCode::SUCCESS) {
+            st = db->exec(
+                "INSERT INTO Thumbnails (blob_hash, size, thumb_hash, width, height) "
+                "VALUES (:blob, :size, :thumb, :width, :height)",
+                {{":blob", result.blobHash},
+                 {":size", row.size},
+                 {":thumb", row.hash},
+                 {":width", row.width},
+                 {":height", row.height}});
+        }
+        rows.append(row);
+    }
+
+    if (st != StatusCode::SUCCESS || !conn.commit()) {
+        conn.rollback();
+        return;
+    }
+
+    if (!result.image) {
+        qDebug() << LogMsg::THUMBNAIL_NOT_IMAGE << result.blobHash;
+        return;
+    }
+
+    qDebug() << LogMsg::THUMBNAIL_STORED << result.blobHash << rows.size();
+    emit thumbnailsReady(result.blobHash, rows);
+}
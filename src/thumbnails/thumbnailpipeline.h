@@ -0,0 +1,89 @@
+#ifndef THUMBNAILPIPELINE_H
+#define THUMBNAILPIPELINE_H
+
+#include "sqlitedb.h"
+#include "dbrows.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <deque>
+
+// Миниатюры изображений из хранилища блобов (Config::THUMBNAIL_SIZES по длинной стороне).
+//
+// Каждое изображение декодируется один раз в пуле потоков, размеры получаются каскадом
+// от большего к меньшему; миниатюры сохраняются тем же BlobStore и описываются в таблице
+// Thumbnails. Карта и окно точки берут готовый файл нужного размера вместо разбора
+// полного кадра в потоке GUI.
+//
+// Живёт в потоке писателя (того, кто владеет db): запись в БД — только из этого потока,
+// в пул уходят лишь путь к файлу и хеш. О новых блобах узнаёт от BlobStore при вставке,
+// блобы, сохранённые до запуска, находит просмотром таблицы Blobs небольшими пачками.
+class ThumbnailPipeline : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ThumbnailPipeline(SQLiteDb* db, QObject* parent = nullptr);
+    ~ThumbnailPipeline() override;
+
+    // Подписка на BlobStore и обработка по таймеру (Config::THUMBNAIL_TICK_MS)
+    void start();
+    void stop();
+    bool isActive() const { return timer.isActive(); }
+
+    // Поставить блоб в очередь (повторы и уже обработанные отбрасываются)
+    void enqueue(const QString& blobHash);
+
+    int pending() const { return int(queue.size()) + inFlight.size(); }
+
+    // Дождаться пула и сохранить всё готовое (для остановки и обслуживания)
+    void flush();
+
+signals:
+    void thumbnailsReady(const QString& blobHash, const QVector<ThumbnailRow>& thumbnails);
+
+private:
+    struct Rendered {
+        int size = 0;
+        int width = 0;
+        int height = 0;
+        QByteArray bytes;
+    };
+
+    struct Result {
+        QString blobHash;
+        bool image = false;
+        QVector<Rendered> thumbnails;
+    };
+
+    SQLiteDb* db;
+    QThreadPool pool;
+    QTimer timer;
+
+    std::deque<QString> queue;
+    QSet<QString> queued;
+    QSet<QString> inFlight;
+    bool backfillDone = false;
+    // Последний просмотренный хэш текущего прохода. Пустая строка, а не QString():
+    // null привязывается как NULL, и "hash > NULL" не вернёт ни одной строки
+    QString backlogAfter = QStringLiteral("");
+    int backlogFound = 0;      // поставлено в очередь за проход
+
+    // Раздаёт очередь пулу; пустая очередь — следующая пачка старых блобов
+    void tick();
+    void scanBacklog();
+    bool hasThumbnails(const QString& blobHash);
+
+    // В потоке пула: декодирование и масштабирование, без обращения к БД
+    static Result render(const QString& blobHash, const QString& path);
+
+    // В потоке писателя: блобы миниатюр и строки Thumbnails одной транзакцией
+    void store(const Result& result);
+};
+
+#endif // THUMBNAILPIPELINE_H